@@ -0,0 +1,59 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstdint>
+
+// Heap allocations are counted by replacing the global operator new. Builds with
+// ALLOC_TRACKING (CMake Debug builds, make ALLOC_TRACKING=1) also interpose malloc, calloc
+// and realloc on glibc, so C code and libraries are counted too.
+//
+// The frame loop marks which part of the frame it is in, and allocations are counted per
+// phase. Allocations on job threads count toward the phase the frame loop is in.
+enum AllocPhase {
+    ALLOC_PHASE_STARTUP,   // outside the frame loop
+    ALLOC_PHASE_INPUT,     // input, shader reloads, asset uploads
+    ALLOC_PHASE_ANIMATE,   // hero animation and camera
+    ALLOC_PHASE_CULL,      // crowd culling, detail levels and streamed data
+    ALLOC_PHASE_DRAW,      // draw calls
+    ALLOC_PHASE_PRESENT,   // pacing, swap, events and stats
+    ALLOC_PHASE_COUNT
+};
+
+void setAllocPhase(AllocPhase phase);
+const char* allocPhaseName(AllocPhase phase);
+
+// Allocations so far, on any thread: in total or during one phase
+uint64_t heapAllocationCount();
+uint64_t heapAllocationCount(AllocPhase phase);
+
+// True when malloc itself is counted (ALLOC_TRACKING on glibc), not just operator new
+bool allocTrackingCoversMalloc();
+
+// Checks that the frame loop stops allocating (--alloc-guard): the first warmupFrames frames
+// may allocate, then every allocation in the next checkedFrames frames is reported with the
+// phase it happened in, and the run fails. In ALLOC_TRACKING builds the stack of the first
+// one is printed as well.
+class FrameAllocGuard {
+public:
+    FrameAllocGuard();
+
+    void start(int warmupFrames, int checkedFrames);
+    bool active() const { return checkedFrames > 0; }
+
+    void beginFrame();
+    // Returns true once the checked frames are done
+    bool endFrame();
+
+    bool failed() const { return failedFrames > 0; }
+    void printSummary() const;
+
+private:
+    int warmupFrames;
+    int checkedFrames;
+    int frame;
+    int failedFrames;
+    uint64_t frameStart[ALLOC_PHASE_COUNT];
+    uint64_t found[ALLOC_PHASE_COUNT];
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "culling.h"
+#include "robot.h"
+
+// Procedural animation: writes the joints it drives for time t (seconds)
+typedef void (*ProceduralAnim)(float t, RobotPose& pose);
+
+// The procedural animations from the interactive viewer
+void animIdleWalk(float t, RobotPose& pose);
+void animArmWave(float t, RobotPose& pose);
+void animHeadBob(float t, RobotPose& pose);
+void animTorsoSway(float t, RobotPose& pose);
+
+// Periods (seconds) after which each procedural animation repeats
+extern const float IDLE_WALK_PERIOD;
+extern const float ARM_WAVE_PERIOD;
+extern const float HEAD_BOB_PERIOD;
+extern const float TORSO_SWAY_PERIOD;
+
+// Periodic pose table sampled from one or more procedural animations.
+// samples[i] holds the pose at time i / sampleRate; sample count * (1 / sampleRate) == period.
+struct BakedClip {
+    std::string name;
+    float period = 0.0f;
+    float sampleRate = 0.0f;
+    std::vector<RobotPose> samples;
+    Aabb bounds;                 // every part of every sample, relative to the robot's root
+};
+
+// Sample anims (applied in order) over one period at roughly sampleRate Hz.
+// The rate is adjusted so a whole number of samples spans the period.
+BakedClip bakeClip(const char* name,
+                   const ProceduralAnim* anims,
+                   int animCount,
+                   float period,
+                   float sampleRate);
+
+// Table lookup + lerp; time wraps around the period
+void sampleClip(const BakedClip& clip, float time, RobotPose& out);
+
+// Bytes held by a baked clip
+size_t clipMemoryBytes(const BakedClip& clip);
+
+// Bake the standard crowd clips (idle walk, arm wave, everything combined)
+std::vector<BakedClip> bakeStandardClips(float sampleRate);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Packed asset archive: many assets in one file that is memory-mapped once and read in place.
+// Layout (little endian):
+//   header | index (entries sorted by path) | path strings | data, each blob aligned
+// Blobs are aligned to ASSET_ARCHIVE_ALIGNMENT (at least GL_MIN_MAP_BUFFER_ALIGNMENT), so
+// GPU buffers can be filled straight from the mapping.
+static const uint32_t ASSET_ARCHIVE_VERSION = 1;
+static const uint32_t ASSET_ARCHIVE_ALIGNMENT = 64;
+
+struct AssetArchiveHeader {
+    char     magic[4];      // "RPAK"
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t namesOffset;
+    uint64_t dataOffset;
+};
+
+struct AssetArchiveEntry {
+    uint64_t offset;        // from the start of the file
+    uint64_t size;
+    uint32_t nameOffset;    // into the path strings
+    uint32_t nameLength;
+};
+
+// Read side: maps the archive and looks assets up by path (binary search, no allocation)
+class AssetArchive {
+public:
+    AssetArchive();
+
+    // Maps and validates the archive; prints the reason and returns false if it is unusable
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return entries != NULL; }
+
+    // The asset's bytes inside the mapping, valid while the archive is open
+    bool find(const std::string& path, const char*& data, size_t& size) const;
+
+    int entryCount() const { return count; }
+    std::string entryPath(int index) const;
+    size_t fileSize() const { return file.size(); }
+
+private:
+    MappedFile file;
+    const AssetArchiveEntry* entries;
+    const char* names;
+    int count;
+};
+
+// A file to pack: where to read it and the path it is looked up by
+struct AssetArchiveInput {
+    std::string file;
+    std::string path;
+};
+
+// Write side (tools): packs the inputs, written to a temporary file and renamed into place
+bool writeAssetArchive(const std::string& output, std::vector<AssetArchiveInput> inputs);
+
+#endif
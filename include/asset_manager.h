@@ -0,0 +1,154 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "mapped_file.h"
+
+enum class AssetState { LOADING, UPLOADING, READY, FAILED };
+
+// Base of every asset type. An asset's bytes are mapped (or taken from the embedded copy,
+// see mapAsset) and decoded on a worker thread; GPU work runs on the GL thread afterwards.
+class Asset {
+public:
+    Asset();
+    virtual ~Asset() {}
+
+    // Worker thread: turn the bytes into CPU-side data. Move the bytes into the asset to keep
+    // them without a copy (e.g. until upload). Returns false if the data is malformed.
+    virtual bool decode(MappedFile& bytes) = 0;
+
+    // GL thread, within the frame's upload budget: true once the upload is complete, false to
+    // be called again next frame (large uploads go in slices)
+    virtual bool upload() { return true; }
+
+    // GL thread, once no handle refers to the asset any more
+    virtual void release() {}
+
+    AssetState state() const { return (AssetState)stateValue.load(); }
+    const std::string& path() const { return assetPath; }
+
+private:
+    friend class AssetManager;
+    std::string assetPath;
+    std::atomic<int> stateValue;
+};
+
+// Shared, typed reference to an asset. The asset is released once the last handle is gone.
+template<typename T>
+class AssetHandle {
+public:
+    AssetHandle() {}
+    explicit AssetHandle(const std::shared_ptr<T>& asset) : asset(asset) {}
+
+    T* get() const { return asset.get(); }
+    T* operator->() const { return asset.get(); }
+
+    bool valid() const { return asset != nullptr; }
+    bool ready() const { return asset && asset->state() == AssetState::READY; }
+    bool failed() const { return asset && asset->state() == AssetState::FAILED; }
+    long useCount() const { return asset.use_count(); }
+    void reset() { asset.reset(); }
+
+private:
+    std::shared_ptr<T> asset;
+};
+
+// Text file, e.g. a shader or a JSON description
+class TextAsset : public Asset {
+public:
+    bool decode(MappedFile& bytes);
+    const std::string& text() const { return contents; }
+
+private:
+    std::string contents;
+};
+
+// File uploaded as-is into a GL buffer object, in slices of at most sliceBytes per frame.
+// The mapped bytes are kept until the upload is done, then unmapped.
+class BufferAsset : public Asset {
+public:
+    BufferAsset();
+
+    bool decode(MappedFile& bytes);
+    bool upload();
+    void release();
+
+    GLuint buffer() const { return id; }
+    size_t size() const { return length; }
+
+    static const size_t sliceBytes = 1 << 20;
+
+private:
+    MappedFile bytes;
+    GLuint id;
+    size_t length;
+    size_t uploaded;
+};
+
+// Loads assets by repository-relative path. Files are mapped and decoded on the job system,
+// uploads are finished on the GL thread in update() within a time budget per frame.
+// Loading one path twice with the same type returns the same asset while it is in use.
+// The manager must outlive every handle it gave out.
+class AssetManager {
+public:
+    AssetManager();
+    ~AssetManager();
+
+    template<typename T>
+    AssetHandle<T> load(const std::string& path);
+
+    // GL thread, once per frame: uploads decoded assets for up to budgetMs (at least one
+    // upload step, so loading always progresses) and releases assets no longer referenced
+    void update(double budgetMs);
+
+    // Assets requested but not yet ready or failed
+    int pending() const { return pendingCount.load(); }
+
+    // GL thread: wait for in-flight decodes, then release everything (call before the
+    // GL context goes away, after dropping the handles). This is the last GL release: assets
+    // whose handles outlive it are deleted without touching GL.
+    void shutdown();
+
+    // Totals since startup, for reports
+    int loadedCount() const { return loaded.load(); }
+    int failedCount() const { return failed.load(); }
+
+private:
+    // The asset in use under key, or a new one from create() that starts loading
+    std::shared_ptr<Asset> acquire(const std::string& key, const std::string& path,
+                                   const std::function<std::shared_ptr<Asset>()>& create);
+    void decode(std::shared_ptr<Asset>& asset);
+    void retire(Asset* asset);
+    void releaseRetired();
+
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<Asset> > assets;   // type + path -> asset in use
+    std::deque<std::shared_ptr<Asset> > uploads;           // decoded, waiting for the GL thread
+    std::vector<Asset*> retired;                            // no handles left, to release
+    bool closed;                                            // shutdown() ran, no more GL calls
+    std::atomic<int> pendingCount;
+    std::atomic<int> decoding;
+    std::atomic<int> loaded;
+    std::atomic<int> failed;
+};
+
+template<typename T>
+AssetHandle<T> AssetManager::load(const std::string& path) {
+    std::shared_ptr<Asset> asset = acquire(std::string(typeid(T).name()) + ":" + path, path, [this]() {
+        // The last handle hands the asset back, so GL resources are freed on the GL thread
+        return std::shared_ptr<Asset>(new T(), [this](Asset* a) { retire(a); });
+    });
+    return AssetHandle<T>(std::static_pointer_cast<T>(asset));
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef BATCHING_H
+#define BATCHING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "crowd.h"
+#include "culling.h"
+#include "scene.h"
+#include "stream_buffer.h"
+
+// World-space vertex produced by the CPU pre-transform
+struct BatchVertex {
+    float position[3];
+    float normal[3];
+    float color[3];
+};
+
+// Crowd renderer for drivers where draw calls or instancing are expensive.
+// FK and the cube vertices of every part are transformed to world space on the CPU
+// (SSE where available, robots split across the job system), written straight into the
+// stream buffer and drawn with a single glDrawArrays.
+class BatchedCrowdRenderer {
+public:
+    BatchedCrowdRenderer();
+
+    // Vertex attributes read from the stream buffer
+    bool init(const StreamBuffer& stream);
+
+    // Pre-transform the visible parts of the visible robots from crowd.poses
+    void update(const Crowd& crowd,
+                const FrameVector<int>& visible,
+                const Frustum& frustum,
+                StreamBuffer& stream);
+
+    void draw(const glm::mat4& view,
+              const glm::mat4& proj,
+              const glm::vec3& camPos,
+              const Scene& scene) const;
+
+    // Depth-only pass over the same robots
+    void drawDepth(const glm::mat4& view, const glm::mat4& proj) const;
+
+    // Take the programs from the shader variant cache again, after hot reload rebuilt them
+    void updatePrograms();
+
+    void destroy();
+
+private:
+    GLuint program;
+    GLuint depthProgram;
+    GLuint vao;
+    int firstVertex;                     // this frame's vertices inside the stream buffer
+    int vertexCount;
+
+    // Per visible robot scratch, reused every frame
+    std::vector<glm::mat4> partMatrices;
+    std::vector<unsigned char> partVisible;
+    std::vector<int> vertexOffset;
+};
+
+// Transform the unit cube by one part matrix into out (CUBE_VERTEX_COUNT vertices)
+void transformCube(const glm::mat4& model, const glm::vec3& color, BatchVertex* out);
+
+#endif
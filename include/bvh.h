@@ -0,0 +1,75 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <vector>
+
+#include "culling.h"
+#include "frame_arena.h"
+
+// Dynamic bounding volume hierarchy over axis-aligned boxes (one per robot).
+// Built top-down with binned SAH; the top levels are built and refit in parallel on the
+// job system. When primitives move, refit() updates the boxes in place and rebuilds only
+// the subtrees whose surface area has grown too much since they were built.
+class Bvh {
+public:
+    Bvh();
+
+    // Full SAH build over boxes; primitive ids are indices into boxes
+    void build(const std::vector<Aabb>& boxes);
+
+    // Replace the box of one primitive; takes effect at the next refit()
+    void updatePrimitive(int id, const Aabb& box);
+
+    // Recompute node bounds bottom-up, then rebuild degraded subtrees.
+    // Returns the number of subtrees rebuilt. Scratch comes from the frame arena.
+    int refit();
+
+    // Primitives whose boxes intersect the frustum / the box (appended to out)
+    void queryFrustum(const Frustum& frustum, std::vector<int>& out) const;
+    void queryBox(const Aabb& box, std::vector<int>& out) const;
+
+    // Nearest primitive box hit by the ray within maxDistance; returns -1 if none
+    int raycast(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, float* hitDistance) const;
+
+    // Total SAH cost (relative), for judging tree quality
+    float sahCost() const;
+
+    int primitiveCount() const { return (int)primBounds.size(); }
+    int nodeCount() const { return (int)nodes.size() - freeNodes; }
+
+    // Subtrees are rebuilt once their area exceeds buildArea * rebuildThreshold
+    float rebuildThreshold;
+
+    // Build and refit the top levels on the job system (off for serial timings)
+    bool parallel;
+
+private:
+    struct Node {
+        Aabb  bounds;
+        int   left;         // child indices, -1 for leaves
+        int   right;
+        int   first;        // range in primIndex covered by the subtree
+        int   count;
+        float buildArea;    // surface area when the subtree was built
+    };
+
+    // nextNode hands out node slots to the tasks of one build, so trees build independently
+    int  buildRange(int begin, int end, int depth, std::atomic<int>& nextNode);
+    void refitNode(int node, int depth);
+    int  collectDegraded(int node, int depth, FrameVector<int>& roots, FrameVector<int>& depths) const;
+    void releaseSubtree(int node);
+
+    std::vector<Node>  nodes;
+    std::vector<int>   primIndex;      // every subtree owns a contiguous range of this array
+    std::vector<Aabb>  primBounds;
+    std::vector<glm::vec3> centroids;
+    int root;
+    int freeNodes;                      // nodes orphaned by subtree rebuilds
+    bool dirty;
+};
+
+float surfaceArea(const Aabb& box);
+
+#endif
@@ -35,6 +35,9 @@ public:
     // Cycle to next camera mode
     void nextMode();
 
+    // True while the view changes on its own, without input (orbit mode)
+    bool isAnimating() const;
+
 private:
     CameraMode currentMode;
 
@@ -0,0 +1,101 @@
+#ifndef CROWD_H
+#define CROWD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "animation.h"
+#include "bvh.h"
+#include "culling.h"
+#include "frame_arena.h"
+#include "lod.h"
+#include "occlusion.h"
+#include "robot.h"
+
+// How the crowd is submitted to the GPU
+enum class CrowdRenderPath {
+    PER_PART = 0,     // CPU sampling + FK, one draw call per part
+    VAT = 1,          // GPU sampling from baked part-matrix textures, one instanced draw
+    PALETTE = 2,      // CPU sampling + FK into a matrix palette, one instanced draw of a merged mesh
+    BATCHED = 3,      // CPU pre-transform of every vertex into one streamed buffer, one draw
+    PATH_COUNT = 4
+};
+
+const char* crowdRenderPathName(CrowdRenderPath path);
+
+// One robot of the crowd: placement plus which baked clip it plays
+struct CrowdRobot {
+    glm::vec3 position;   // ground point under the robot
+    glm::vec3 home;       // grid slot the robot wanders around
+    float heading;        // rotation about Y, degrees
+    int   clip;           // index into Crowd::clips
+    float phase;          // seconds added to the shared playback time
+};
+
+// A crowd of robots animated from baked clips
+class Crowd {
+public:
+    // Bake the standard clips and lay out count robots on a grid behind the origin
+    void init(int count, float spacing, float sampleRate);
+
+    // Robots whose bounds intersect the frustum, in index order (BVH query)
+    void cull(const Frustum& frustum, std::vector<int>& visible) const;
+
+    // Cull and pick a detail level for every visible robot in the same pass.
+    // byLevel[l] receives the robots drawn at level l, in index order; pixelsPerUnit is the
+    // projected size in pixels of one world unit at distance 1.
+    // With occlusion (begun by the caller for this view), the torsos of the nearest robots
+    // are added as occluders and robots hidden behind them are dropped as well.
+    void cull(const Frustum& frustum,
+              const glm::vec3& camPos,
+              float pixelsPerUnit,
+              const LodSettings& lod,
+              FrameVector<int> byLevel[LOD_COUNT],
+              OcclusionBuffer* occlusion = nullptr);
+
+    // Move every robot on a small loop around its home slot, update its bounds and refit the BVH
+    void wander(float time);
+
+    // Nearest robot whose bounds the ray hits, or -1
+    int pick(const glm::vec3& origin, const glm::vec3& dir) const;
+
+    // Sample the clip of every listed robot at the shared time (table lookup + lerp)
+    void updatePoses(float time, const FrameVector<int>& which);
+
+    // World placement of robot i
+    glm::mat4 rootMatrix(int i) const;
+
+    int size() const { return (int)robots.size(); }
+
+    std::vector<BakedClip>  clips;
+    std::vector<CrowdRobot> robots;
+    std::vector<RobotPose>  poses;   // filled by updatePoses
+    std::vector<unsigned char> lodLevels;   // level each robot was last drawn at (for hysteresis)
+    std::vector<glm::mat4> clipOccluders;   // per clip: box inside the torso in every pose (robot space)
+
+    // World AABB of each robot over every pose of its clip (SoA centre / half extents)
+    std::vector<float> boundsCX, boundsCY, boundsCZ;
+    std::vector<float> boundsEX, boundsEY, boundsEZ;
+
+    // Hierarchy over the robot boxes, for frustum, ray and box queries
+    Bvh bvh;
+
+private:
+    void updateBounds(int i);
+
+    std::vector<int> visibleScratch;   // kept across frames for the BVH query
+};
+
+// Draw the listed robots part by part (one uniform upload + draw call per visible part).
+// depthPass: depth pre-pass with a depth-only program; culled parts are counted by the shading pass.
+void drawCrowd(GLuint program,
+               GLuint cubeVAO,
+               const Crowd& crowd,
+               const FrameVector<int>& visible,
+               const Frustum& frustum,
+               const glm::mat4& view,
+               const glm::mat4& proj,
+               bool depthPass = false);
+
+#endif
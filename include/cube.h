@@ -3,6 +3,12 @@
 
 #include <glad/glad.h>
 
+// Unit cube as 36 interleaved vertices: position (3 floats) + normal (3 floats)
+const int CUBE_VERTEX_COUNT = 36;
+const int CUBE_VERTEX_FLOATS = 6;
+
+const float* getCubeVertices();
+
 GLuint createCube();
 
-#endif
\ No newline at end of file
+#endif
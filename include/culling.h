@@ -0,0 +1,49 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include "robot.h"
+
+// Six normalized planes (xyz = inward normal, w = distance); a point p is inside when dot(n, p) + w >= 0
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Axis-aligned box
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Planes of a combined projection * view matrix (Gribb/Hartmann)
+Frustum extractFrustum(const glm::mat4& viewProj);
+
+// World box enclosing local transformed by m
+Aabb transformAabb(const Aabb& local, const glm::mat4& m);
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+bool aabbInFrustum(const Frustum& frustum, const Aabb& box);
+
+// Batch tests over structure-of-arrays input, four at a time with SSE.
+// visible[i] is set to 1 if object i intersects the frustum, 0 otherwise; returns the visible count.
+int cullSpheres(const Frustum& frustum,
+                const float* x, const float* y, const float* z, const float* radius,
+                int count, unsigned char* visible);
+
+int cullBoxes(const Frustum& frustum,
+              const float* cx, const float* cy, const float* cz,
+              const float* ex, const float* ey, const float* ez,
+              int count, unsigned char* visible);
+
+// Bounding spheres of the part cubes produced by computeRobotParts (SoA, one per part)
+struct PartSpheres {
+    float x[MAX_ROBOT_PARTS];
+    float y[MAX_ROBOT_PARTS];
+    float z[MAX_ROBOT_PARTS];
+    float radius[MAX_ROBOT_PARTS];
+};
+
+void computePartSpheres(const glm::mat4* parts, int count, PartSpheres& out);
+
+#endif
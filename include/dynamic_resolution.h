@@ -0,0 +1,63 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+// Dynamic resolution scaling: the scene is rendered into an offscreen framebuffer at
+// scale * window size and stretched to the window with a bilinear blit. The scale follows
+// the scene's GPU time (GL_TIME_ELAPSED queries, read a few frames late so they never stall)
+// toward a frame-time budget. The controller smooths the measurement, ignores errors inside a
+// dead band and waits for a changed scale to show up in the measurements before moving again,
+// so it settles instead of oscillating.
+class DynamicResolution {
+public:
+    DynamicResolution();
+
+    // budgetMs: target GPU time of the scene pass; scale stays within [minScale, 1]
+    bool init(float budgetMs, float minScale);
+
+    // Bind the offscreen target at the current scale; call before clearing the scene
+    void beginScene(int windowWidth, int windowHeight);
+
+    // Stop timing, upscale to the default framebuffer and update the controller
+    void endScene();
+
+    float scale() const { return currentScale; }
+    float gpuMs() const { return smoothedMs; }          // smoothed scene GPU time
+    int   renderWidth() const { return sceneWidth; }
+    int   renderHeight() const { return sceneHeight; }
+
+    void destroy();
+
+private:
+    static const int QUERY_COUNT = 4;   // frames a timer result may lag behind
+
+    void resizeTargets(int width, int height);
+    void readQueries();
+    void updateScale(float ms);
+
+    float budget;
+    float minimumScale;
+    float currentScale;
+    float smoothedMs;
+    int   settleFrames;       // measurements to skip after a scale change
+    int   measured;           // measurements since the last change
+
+    GLuint fbo;
+    GLuint colorTexture;
+    GLuint depthBuffer;
+    int targetWidth;          // allocated size (the window size)
+    int targetHeight;
+    int windowWidth;
+    int windowHeight;
+    int sceneWidth;           // rendered size this frame
+    int sceneHeight;
+
+    GLuint program;
+    GLuint emptyVAO;
+    GLuint queries[QUERY_COUNT];
+    bool   queryPending[QUERY_COUNT];
+    int    queryIndex;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <cstddef>
+#include <string>
+
+#include "mapped_file.h"
+
+// A file compiled into the executable by tools/embed_files
+struct EmbeddedAsset {
+    const char* path;   // relative to the repository root, e.g. "shaders/vertex_shader.glsl"
+    const char* data;   // zero terminated
+    size_t size;        // without the terminator
+};
+
+// Assets are looked up by repository-relative path in this order:
+//   1. the override directory, if set (edit files without rebuilding)
+//   2. the mounted asset archive, if any (one mapping for every packed asset)
+//   3. the copy embedded at build time (builds with EMBED_ASSETS)
+//   4. the file relative to the working directory
+// Release builds with embedding therefore read no files.
+void setAssetOverrideDirectory(const std::string& directory);
+const std::string& assetOverrideDirectory();
+
+// Map a packed archive (see asset_archive.h) for the rest of the run; false if unusable
+bool mountAssetArchive(const std::string& file);
+
+// Where a path would be read from on disk: under the override directory, or as is
+std::string assetDiskPath(const std::string& path);
+
+bool findEmbeddedAsset(const std::string& path, const char*& data, size_t& size);
+int embeddedAssetCount();
+
+// Returns false, without printing, if the asset exists nowhere
+bool loadAsset(const std::string& path, std::string& contents);
+
+// The asset's bytes without copying them: a mapped file, or a view of the embedded copy
+bool mapAsset(const std::string& path, MappedFile& bytes);
+
+// Files loadAsset had to read from disk so far
+int assetFileReads();
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FRAGMENT_COUNTER_H
+#define FRAGMENT_COUNTER_H
+
+#include <glad/glad.h>
+
+// Counts the fragments a span of draw calls shades, to judge overdraw and whether the
+// depth pre-pass pays off. Uses GL_FRAGMENT_SHADER_INVOCATIONS where pipeline statistics
+// queries exist; otherwise GL_SAMPLES_PASSED, which counts fragments that passed the
+// depth test (a lower bound when the driver does not reject fragments early).
+// Results are read a few frames late so the CPU never waits for the GPU.
+class FragmentCounter {
+public:
+    FragmentCounter();
+
+    bool init();
+
+    void begin();
+    void end();
+
+    // Latest result, in fragments
+    double lastCount() const { return last; }
+    bool   countsInvocations() const { return target == GL_FRAGMENT_SHADER_INVOCATIONS; }
+
+    void destroy();
+
+private:
+    static const int QUERY_COUNT = 4;
+
+    void readQueries();
+
+    GLenum target;
+    GLuint queries[QUERY_COUNT];
+    bool   pending[QUERY_COUNT];
+    int    current;
+    bool   active;
+    double last;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+// Bump allocator for data that lives for one frame (visible lists, culling results, scratch).
+// Allocation is a pointer increment, freeing is a no-op, and reset() makes all of the memory
+// available again. When a frame needs more than the first block, extra blocks are taken from
+// the heap and merged into one larger block at the next reset, so a steady frame loop settles
+// on a single block and stops touching the heap.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes = 256 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    // Everything allocated so far becomes invalid
+    void reset();
+
+    size_t used() const { return usedBytes; }
+    size_t capacity() const;
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current;      // block being filled
+    size_t offset;       // into the current block
+    size_t usedBytes;
+    size_t initialBytes;
+};
+
+// The calling thread's arena, created on first use
+FrameArena& frameArena();
+
+// Reset the arenas of every thread, at the end of a frame when no jobs are running
+void resetFrameArenas();
+
+// Bytes allocated from all arenas since the last reset
+size_t frameArenaBytesUsed();
+
+// STL allocator over the arena of whichever thread allocates. Containers using it must not
+// outlive the frame; deallocate does nothing.
+template <class T>
+struct FrameAllocator {
+    typedef T value_type;
+
+    FrameAllocator() {}
+    template <class U> FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(frameArena().allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <class U> bool operator==(const FrameAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+// Frame pacing: owns the swap interval, holds each frame to a target frame time with a
+// hybrid wait (sleep while far from the deadline, then spin) and measures how evenly
+// frames are presented (mean, standard deviation, min/max, missed deadlines).
+class FramePacer {
+public:
+    FramePacer();
+
+    // Applies the swap interval; negative intervals need *_EXT_swap_control_tear and fall back to 1 without it
+    void init(GLFWwindow* window, int swapInterval, double targetFps);
+
+    void setSwapInterval(int interval);
+    int  swapInterval() const { return interval; }
+    bool supportsSwapTear() const { return swapTear; }
+
+    // 0 = no target (only the swap interval paces frames)
+    void   setTargetFps(double fps);
+    double targetFps() const { return targetFrameTime > 0.0 ? 1.0 / targetFrameTime : 0.0; }
+
+    // Seconds between pacing reports (0 = no reports)
+    void setReportInterval(double seconds) { reportInterval = seconds; }
+
+    // Call right before glfwSwapBuffers: waits for this frame's deadline
+    void waitForDeadline();
+
+    // Call right after glfwSwapBuffers: records the time since the previous swap
+    void frameSwapped();
+
+    // Forget the current deadline and the last swap time (after the loop slept, e.g. on demand)
+    void resync();
+
+    // Recent frame intervals in ms, oldest first (for the jitter graph)
+    const std::vector<float>& history() const { return recent; }
+
+    double measuredFps() const { return lastReportFps; }
+
+private:
+    void report(double now);
+
+    GLFWwindow* window;
+    int    interval;
+    bool   swapTear;
+    double targetFrameTime;    // seconds, 0 = unpaced
+    double deadline;           // next frame's target swap time, < 0 when unset
+    double lastSwap;           // < 0 when unset
+
+    // Running statistics over the report window (Welford)
+    double reportInterval;
+    double windowStart;
+    int    samples;
+    double mean;
+    double m2;
+    double minMs;
+    double maxMs;
+    int    missed;
+    double sleptMs;
+    double spunMs;
+    double lastReportFps;
+
+    std::vector<float> recent;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+// Per-frame counters, averaged over each report interval
+enum StatCounter {
+    STAT_DRAW_CALLS = 0,
+    STAT_ROBOTS_DRAWN,
+    STAT_ROBOTS_CULLED,     // rejected by their bounds before any per-robot work
+    STAT_PARTS_CULLED,      // parts of visible robots rejected by their own bounds
+    STAT_CPU_ANIM_MS,       // crowd sampling / FK / pre-transform on the CPU
+    STAT_STREAM_KB,         // bytes written to the stream buffer
+    STAT_STREAM_STALLS,     // frames that waited for the GPU to release a stream segment
+    STAT_STREAM_STALL_MS,
+    STAT_BVH_MS,            // moving the crowd and refitting its BVH
+    STAT_LOD_FULL,          // visible robots per detail level
+    STAT_LOD_PROXY,
+    STAT_LOD_IMPOSTOR,
+    STAT_ROBOTS_OCCLUDED,   // in the frustum but hidden behind nearer robots
+    STAT_OCCLUSION_MS,      // occluder rasterization and box tests
+    STAT_RES_SCALE,         // dynamic resolution scale in percent
+    STAT_SCENE_GPU_MS,      // smoothed GPU time of the scene pass
+    STAT_FRAGMENTS_K,       // fragments shaded by the scene's lighting pass, in thousands
+    STAT_ASSET_UPLOAD_MS,   // GPU uploads finished by the asset manager
+    STAT_HEAP_ALLOCS,       // global operator new calls during the frame
+    STAT_ARENA_KB,          // frame arena memory used by the frame
+    STAT_COUNT
+};
+
+// Frame timing and counter accumulation with a periodic console report
+class FrameStats {
+public:
+    FrameStats();
+
+    // Print a report every interval seconds (0 disables reporting)
+    void setReportInterval(double seconds);
+
+    // Short tag printed with every report, e.g. the active crowd render path
+    void setLabel(const char* label);
+
+    void beginFrame(double now);
+    void endFrame(double now);
+
+    void add(StatCounter counter, double value);
+
+    // Totals since the last resetTotals(), for summaries over a whole run
+    int    totalFrames() const { return totalFrameCount; }
+    double totalAverageMs() const;
+    double totalAverage(StatCounter counter) const;
+    void   resetTotals();
+
+private:
+    void report();
+
+    double reportInterval;
+    const char* label;
+
+    double frameStart;
+    double windowStart;
+    int    windowFrames;
+    double windowFrameMs;
+    double windowMinMs;
+    double windowMaxMs;
+    double windowCounters[STAT_COUNT];
+
+    int    totalFrameCount;
+    double totalFrameMs;
+    double totalCounters[STAT_COUNT];
+    double frameCounters[STAT_COUNT];
+};
+
+// Process-wide stats used by the frame loop and the renderers
+FrameStats& frameStats();
+
+// Monotonic wall clock in seconds, for timing CPU work outside of GLFW
+double monotonicSeconds();
+
+// Display name of a counter
+const char* statCounterName(StatCounter counter);
+
+#endif
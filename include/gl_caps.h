@@ -0,0 +1,30 @@
+#ifndef GL_CAPS_H
+#define GL_CAPS_H
+
+#include <glad/glad.h>
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile (same value)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Optional GL features, queried once after the context is created
+struct GLCaps {
+    int  major = 0;
+    int  minor = 0;
+    bool bufferStorage = false;   // GL 4.4 / GL_ARB_buffer_storage (persistent mapping)
+    bool pipelineStatistics = false;   // GL 4.6 / GL_ARB_pipeline_statistics_query
+    bool programBinary = false;        // GL 4.1 / GL_ARB_get_program_binary
+    bool parallelShaderCompile = false;   // GL_KHR/ARB_parallel_shader_compile: GL_COMPLETION_STATUS_KHR polls
+};
+
+// Query the current context; loads ARB entry points the 4.6 loader skipped on older versions.
+// getProc is the context's loader (glfwGetProcAddress).
+void initGLCaps(GLADloadproc getProc);
+
+const GLCaps& glCaps();
+
+// True if the current context advertises the extension
+bool hasGLExtension(const char* name);
+
+#endif
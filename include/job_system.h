@@ -0,0 +1,75 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size worker pool for data-parallel CPU work (crowd animation, batching, ...)
+// and background tasks (asset decodes, startup steps). The helpers of parallelFor go to their
+// own queue, which workers always serve first, and background tasks never occupy every
+// worker, so a long decode cannot hold up a frame's parallel work.
+class JobSystem {
+public:
+    // workerCount 0 = one worker per hardware thread, minus the calling thread
+    explicit JobSystem(int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queue a background task and return immediately
+    void submit(std::function<void()> task);
+
+    // Run fn(begin, end) over [0, count) in chunks of about grain items.
+    // The calling thread takes part and the call returns when every chunk is done; while it
+    // waits it only runs parallelFor work, never background tasks.
+    // fn is called in place rather than wrapped in a std::function, so lambdas with large
+    // captures do not allocate.
+    template <class Fn>
+    void parallelFor(int count, int grain, const Fn& fn) {
+        parallelFor(count, grain, &callRange<Fn>, &fn);
+    }
+
+    // Number of threads that execute work, including the calling thread
+    int threadCount() const { return (int)workers.size() + 1; }
+
+private:
+    typedef void (*RangeFn)(const void* context, int begin, int end);
+
+    template <class Fn>
+    static void callRange(const void* context, int begin, int end) {
+        (*static_cast<const Fn*>(context))(begin, end);
+    }
+
+    // Ring buffer of queued tasks; it only grows, so steady-state pushes do not allocate
+    struct TaskQueue {
+        std::vector<std::function<void()>> tasks;
+        size_t head = 0;
+        size_t count = 0;
+
+        void push(std::function<void()>&& task);
+        bool pop(std::function<void()>& task);
+    };
+
+    void parallelFor(int count, int grain, RangeFn fn, const void* context);
+    void push(TaskQueue& queue, std::function<void()>&& task);
+    void workerLoop();
+    bool runParallelTask();
+
+    std::vector<std::thread> workers;
+    TaskQueue parallelTasks;     // parallelFor helpers
+    TaskQueue background;        // submit()
+    int backgroundRunning;
+    int maxBackground;           // workers background tasks may occupy at once
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+};
+
+// Process-wide pool, created on first use
+JobSystem& jobSystem();
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "frame_arena.h"
+#include "scene.h"
+#include "stream_buffer.h"
+
+class Crowd;
+
+// Detail levels for crowd robots, finest first
+enum LodLevel {
+    LOD_FULL = 0,      // every part, through the active crowd render path
+    LOD_PROXY,         // one box covering the whole robot
+    LOD_IMPOSTOR,      // camera-facing quad textured with a pre-rendered robot
+    LOD_COUNT
+};
+
+const char* lodLevelName(int level);
+
+// Screen-size thresholds, in pixels of projected robot height
+struct LodSettings {
+    bool  enabled = true;
+    float proxyPixels = 60.0f;      // robots shorter than this on screen drop to the proxy box
+    float impostorPixels = 20.0f;   // robots shorter than this drop to the impostor
+    float hysteresis = 0.15f;       // a threshold must be crossed by this fraction before the level changes
+};
+
+// Level for a robot pixels tall on screen that was drawn at previous last frame
+int selectLodLevel(float pixels, int previous, const LodSettings& settings);
+
+// Draws the proxy and impostor levels of the crowd, one instanced call each.
+// The impostor texture is rendered once at startup from the rest pose with the main robot shader.
+class LodCrowdRenderer {
+public:
+    LodCrowdRenderer();
+
+    // robotProgram / cubeVAO are the hero robot's shader and cube, used to bake the impostor
+    bool init(GLuint robotProgram, GLuint cubeVAO, const StreamBuffer& stream);
+
+    // Stream one placement record per proxy and per impostor robot
+    void update(const Crowd& crowd,
+                const FrameVector<int>& proxies,
+                const FrameVector<int>& impostors,
+                StreamBuffer& stream);
+
+    // Returns the number of draw calls issued
+    int draw(const glm::mat4& view,
+             const glm::mat4& proj,
+             const glm::vec3& camPos,
+             const Scene& scene) const;
+
+    // The two halves of draw(): opaque proxy boxes, then alpha-tested impostors
+    int drawProxies(const glm::mat4& view, const glm::mat4& proj, const Scene& scene) const;
+    int drawImpostors(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, const Scene& scene) const;
+
+    // Depth-only pass over the proxies; impostors discard texels, so they are left out
+    int drawDepth(const glm::mat4& view, const glm::mat4& proj) const;
+
+    // Take the programs from the shader variant cache again, after hot reload rebuilt them
+    void updatePrograms();
+
+    void destroy();
+
+private:
+    bool bakeImpostor(GLuint robotProgram, GLuint cubeVAO);
+
+    GLuint proxyProgram;
+    GLuint proxyDepthProgram;
+    GLuint impostorProgram;
+    GLuint proxyVAO;
+    GLuint impostorVAO;
+    GLuint cubeVBO;
+    GLuint quadVBO;
+    GLuint impostorTexture;
+    int proxyCount;
+    int impostorCount;
+
+    // Rest-pose box of the robot, relative to its ground point
+    glm::vec3 restCenter;
+    glm::vec3 restSize;
+    glm::vec3 proxyColor;
+};
+
+#endif
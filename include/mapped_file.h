@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only bytes of a file, memory-mapped so reading it copies nothing (where mmap is not
+// available the file is read into memory instead). Can also wrap memory it does not own,
+// such as an asset embedded in the executable. Movable, not copyable.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False, without printing, if the file cannot be opened
+    bool open(const std::string& path);
+
+    // View memory owned elsewhere that outlives this object
+    void wrap(const char* data, size_t size);
+
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    void take(MappedFile& other);
+
+    const char* bytes;
+    size_t length;
+    bool opened;
+    bool mapped;               // bytes is an mmap'd region to unmap
+    std::vector<char> buffer;  // contents when the file was read instead of mapped
+};
+
+#endif
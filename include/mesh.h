@@ -0,0 +1,76 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Indexed triangle mesh with the same vertex layout as the cube: position + normal
+const int MESH_VERTEX_FLOATS = 6;
+
+// One detail level of a mesh: a range of its index buffer, and how far (object-space units,
+// RMS distance of the full mesh's vertices to the level's surface) the level is from the full mesh
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float    error;
+    uint32_t reserved;
+};
+
+struct MeshData {
+    std::vector<float> vertices;      // MESH_VERTEX_FLOATS per vertex
+    std::vector<uint32_t> indices;    // three per triangle
+    std::vector<MeshLod> lods;        // finest first; empty = one level with every index
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    size_t vertexCount() const { return vertices.size() / MESH_VERTEX_FLOATS; }
+    size_t triangleCount() const { return indices.size() / 3; }
+    void computeBounds();
+};
+
+// Engine mesh file (.mesh): header and LOD table, then the vertex and index arrays, each
+// 64-byte aligned, ready to be uploaded straight from a mapping (little endian)
+static const uint32_t MESH_FILE_VERSION = 2;
+
+struct MeshFileHeader {
+    char     magic[4];        // "RMSH"
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;    // bytes per vertex
+    uint32_t lodCount;        // MeshLod entries right after the header
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint64_t vertexOffset;    // from the start of the file
+    uint64_t indexOffset;
+};
+
+// Arrays of a mesh file, pointing into its bytes
+struct MeshView {
+    const float* vertices;
+    const uint32_t* indices;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    const MeshLod* lods;
+    uint32_t lodCount;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+bool writeMeshFile(const std::string& path, const MeshData& mesh);
+
+// Validates a mesh file in memory; false if it is malformed or from another version
+bool parseMeshFile(const char* data, size_t size, MeshView& view);
+
+// Coarsest level whose error projects to at most maxPixels on screen at distance.
+// pixelsPerUnit is the viewport height / (2 tan(fovy / 2)), the size of one unit at distance 1.
+int selectMeshLod(const MeshLod* lods, int lodCount, float distance, float pixelsPerUnit, float maxPixels);
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform
+// cache of cacheSize entries (0.5 is ideal for large regular meshes, 3 is no reuse)
+float computeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize);
+
+#endif
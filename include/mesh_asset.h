@@ -0,0 +1,40 @@
+#ifndef MESH_ASSET_H
+#define MESH_ASSET_H
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "asset_manager.h"
+#include "mesh.h"
+
+// Mesh file loaded through the asset manager: validated on a worker thread, uploaded to a
+// VAO (attribute 0 position, 1 normal) plus index buffer from the mapping on the GL thread,
+// in slices of BufferAsset::sliceBytes so large meshes spread over several frames
+class MeshAsset : public Asset {
+public:
+    MeshAsset();
+
+    bool decode(MappedFile& bytes);
+    bool upload();
+    void release();
+
+    GLuint vao() const { return vertexArray; }
+    GLsizei indexCount() const { return (GLsizei)view.indexCount; }
+    const MeshView& data() const { return view; }   // valid until uploaded
+
+    int lodCount() const { return (int)lods.size(); }
+    const MeshLod& lod(int level) const { return lods[level]; }
+
+    // Draws one detail level (see selectMeshLod); the coarsest if level is out of range
+    void draw(int level = 0) const;
+
+private:
+    MappedFile bytes;
+    MeshView view;
+    std::vector<MeshLod> lods;   // copied, the mapping is closed after upload
+    size_t uploaded;             // bytes so far: vertices, then indices
+    GLuint vertexArray;
+    GLuint buffers[2];
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// Triangle and vertex reordering for the GPU. Geometry is unchanged, only the order differs.
+
+// Reorder triangles for post-transform vertex cache hits (Tipsify, Sander et al. 2007):
+// fans around recently used vertices, preferring those that stay in a cacheSize cache.
+// Writes the new order to clusters as the start index of each run that begins with a
+// cache flush; those runs can be moved as a whole at little cost to the cache hit rate.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize,
+                         std::vector<uint32_t>* clusters = NULL);
+
+// Reorder the clusters from optimizeVertexCache so clusters facing outward, away from the mesh
+// center, are drawn first and hide what is behind them (less overdraw)
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                      const float* vertices, int vertexFloats);
+
+// Renumber vertices in order of first use, so vertex fetches walk memory forward
+void optimizeVertexFetch(MeshData& mesh);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+// Edge-collapse simplification with quadric error metrics (Garland and Heckbert 1997).
+// Vertices collapse onto one of their neighbors, so every simplified level reuses a subset of
+// the original vertices; open borders are held in place by extra quadrics.
+
+// Simplified copies of mesh, one per target triangle count (decreasing), made in one pass.
+// Stops early once a collapse's quadric error (RMS distance to the planes it merges) would
+// exceed maxError (object-space units, 0 = no limit); the returned levels are those reached.
+// errors[i] is the measured RMS distance of the original vertices to level i's surface.
+int simplifyMesh(const MeshData& mesh, const std::vector<size_t>& targetTriangles, float maxError,
+                 std::vector<MeshData>& levels, std::vector<float>& errors);
+
+struct MeshLodSettings {
+    int    levels = 4;             // including the full mesh
+    float  ratio = 0.5f;           // triangles kept from one level to the next
+    float  maxError = 0.05f;       // fraction of the bounding box diagonal; coarser levels are dropped
+    size_t minTriangles = 8;       // no level below this
+    int    cacheSize = 16;         // post-transform cache the levels are ordered for
+};
+
+// Replaces mesh with its LOD chain: every level's vertices and indices concatenated, the ranges
+// and errors in mesh.lods. Each level is ordered for the vertex cache (and level 0 for overdraw).
+void buildMeshLods(MeshData& mesh, const MeshLodSettings& settings);
+
+// buildMeshLods for many meshes (e.g. the parts of a robot), one job per mesh
+void buildMeshLods(std::vector<MeshData>& meshes, const MeshLodSettings& settings);
+
+#endif
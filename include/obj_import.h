@@ -0,0 +1,28 @@
+#ifndef OBJ_IMPORT_H
+#define OBJ_IMPORT_H
+
+#include <cstddef>
+
+#include "mesh.h"
+
+// Timings and sizes of one import
+struct ObjImportStats {
+    size_t bytes = 0;
+    int    chunks = 0;
+    double parseMs = 0.0;      // chunks parsed in parallel, indices resolved
+    double dedupMs = 0.0;      // unique (position, normal) pairs become vertices
+    size_t positions = 0;
+    size_t normals = 0;
+    size_t corners = 0;        // face corners after triangulation
+    bool   generatedNormals = false;
+};
+
+// Wavefront OBJ (v, vn, f; polygons are fan-triangulated, negative indices supported,
+// texture coordinates, groups and materials ignored) to an indexed mesh.
+// The text is split into chunks at line boundaries that are parsed on the job system without
+// allocating per token; corners sharing position and normal indices become one vertex.
+// Faces without normals get area-weighted smooth normals.
+// Returns false, with the line printed, on malformed input.
+bool importObj(const char* text, size_t size, MeshData& mesh, ObjImportStats* stats = NULL);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "culling.h"
+
+// Software occlusion culling on the CPU, no GPU involved.
+// Occluders (boxes that lie inside real geometry) are rasterized into a small depth buffer
+// with SSE, split into bands of rows across the job system; a max-depth pyramid (hierarchical Z)
+// is built from it and bounding boxes are tested against the coarsest level that covers them
+// with a few texels.
+class OcclusionBuffer {
+public:
+    OcclusionBuffer();
+
+    // Depth buffer resolution; width is rounded up to a multiple of 4
+    void init(int width, int height);
+
+    // Clear the depth buffer and the occluder list for a new view
+    void begin(const glm::mat4& viewProj);
+
+    // Queue the unit cube transformed by model as an occluder.
+    // It must lie inside the geometry it stands for, or visible objects may be culled.
+    void addOccluder(const glm::mat4& model);
+
+    // Rasterize the queued occluders and build the pyramid
+    void rasterize();
+
+    // True if the world box is certainly hidden behind the rasterized occluders
+    bool isOccluded(const Aabb& box) const;
+
+    int width() const { return bufferWidth; }
+    int height() const { return bufferHeight; }
+    int occluderCount() const { return (int)occluders.size(); }
+    int triangleCount() const { return rasterizedTriangles; }
+
+    // Level 0 of the pyramid, row-major from the bottom row, depth in [0, 1] (1 = far)
+    const float* depth() const { return levels.empty() ? nullptr : levels[0].data(); }
+
+private:
+    struct Triangle {
+        float x[3], y[3], z[3];   // pixel coordinates and depth
+        int minX, maxX, minY, maxY;
+    };
+
+    void setupOccluder(int index, Triangle* out, int& count) const;
+    void rasterizeBand(int rowBegin, int rowEnd);
+    void buildPyramid();
+
+    int bufferWidth;
+    int bufferHeight;
+    glm::mat4 viewProj;
+    std::vector<glm::mat4> occluders;
+    std::vector<Triangle> triangles;
+    std::vector<int> triangleCounts;              // per occluder, after back-face culling
+    std::vector<std::vector<float> > levels;      // max-depth pyramid, level 0 = full resolution
+    std::vector<int> levelWidth;
+    std::vector<int> levelHeight;
+    int rasterizedTriangles;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PACING_TEST_H
+#define PACING_TEST_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "frame_pacer.h"
+
+// Pacing / tearing test screen, modelled on GLFW/tests/tearing.c: a white bar sweeping
+// across a black screen (tears and judder are easy to see on it) above a graph of the
+// most recent frame intervals, where bars off the target by more than 10% turn red.
+// Up / Down change the swap interval; the title shows the interval and the measured rate.
+class PacingTest {
+public:
+    PacingTest();
+
+    bool init();
+    void draw(const FramePacer& pacer, int width, int height, double time) const;
+
+    // Window title in the style of the GLFW tearing test
+    void updateTitle(GLFWwindow* window, const FramePacer& pacer) const;
+
+    void destroy();
+
+private:
+    void drawRect(float x, float y, float w, float h, float r, float g, float b) const;
+
+    GLuint program;
+    GLuint vao;
+    GLuint vbo;
+    GLint  rectLoc;
+    GLint  colorLoc;
+};
+
+#endif
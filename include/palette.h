@@ -0,0 +1,60 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "crowd.h"
+#include "scene.h"
+#include "stream_buffer.h"
+
+// Crowd renderer drawing every robot with one instanced call.
+// The CPU runs FK for all robots and writes every part matrix into one texture buffer
+// (the palette, streamed through the frame's StreamBuffer); a merged robot mesh whose vertices carry their part index looks its
+// transform up by instance and part. Draw count does not grow with the rig's part count.
+class PaletteCrowdRenderer {
+public:
+    PaletteCrowdRenderer();
+
+    // The palette texture views the whole stream buffer
+    bool init(const StreamBuffer& stream);
+
+    // FK for the visible robots from crowd.poses, written straight into stream memory
+    void update(const Crowd& crowd, const FrameVector<int>& visible, StreamBuffer& stream);
+
+    void draw(const glm::mat4& view,
+              const glm::mat4& proj,
+              const glm::vec3& camPos,
+              const Scene& scene) const;
+
+    // Depth-only pass over the same robots
+    void drawDepth(const glm::mat4& view, const glm::mat4& proj) const;
+
+    // Take the programs from the shader variant cache again, after hot reload rebuilt them
+    void updatePrograms();
+
+    void destroy();
+
+private:
+    static const int MAX_PARTS = 32;   // must match palette_vertex_shader.glsl
+
+    GLuint program;
+    GLuint depthProgram;
+    GLuint vao;
+    GLuint meshVBO;
+    GLuint paletteTexture;
+    int vertexCount;
+    int partCount;                     // parts of the rig the mesh was built for
+    int robotCount;
+    int paletteBase;                   // texel offset of this frame's palette
+};
+
+// Write rows 0..2 of an affine matrix (the palette/VAT texel layout)
+inline void packMatrixRows(const glm::mat4& m, glm::vec4* out) {
+    for (int row = 0; row < 3; ++row) {
+        out[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (GL 4.1 / GL_ARB_get_program_binary).
+// Entries are keyed on the program's sources, its defines and the driver strings, so a
+// driver update or an edited shader simply misses. A binary the driver rejects is deleted
+// and the program is compiled from source again.
+
+// Enable the cache in directory (created if missing); needs a current context and initGLCaps().
+// Returns false, leaving the cache disabled, if the driver has no binary formats.
+bool initProgramCache(const char* directory);
+
+bool programCacheEnabled();
+
+// Key of a program built from these sources and defines on the current driver
+uint64_t programCacheKey(const std::string& vertexSource,
+                         const std::string& fragmentSource,
+                         const std::string& defines);
+
+// Linked program for key, or 0 on a miss or a rejected binary
+GLuint loadCachedProgram(uint64_t key);
+
+// Save a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+void storeCachedProgram(uint64_t key, GLuint program);
+
+// Startup accounting for every program loadShaderProgram builds
+struct ProgramLoadStats {
+    int    programs = 0;
+    int    cacheHits = 0;
+    int    rejected = 0;     // cached binaries the driver refused
+    double ms = 0.0;         // time spent reading, compiling/loading and linking
+};
+
+void recordProgramLoad(double ms, bool fromCache);
+const ProgramLoadStats& programLoadStats();
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef REDRAW_H
+#define REDRAW_H
+
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <cstdint>
+
+// Render-on-demand: decides each loop iteration whether anything visible changed and,
+// if not, blocks in glfwWaitEventsTimeout instead of drawing the same frame again.
+// Reports the effective redraw rate and the process CPU usage while enabled.
+class RedrawScheduler {
+public:
+    RedrawScheduler();
+
+    void setEnabled(bool on) { enabled = on; }
+    bool isEnabled() const { return enabled; }
+
+    // Seconds between rate reports (0 = every 5 s)
+    void setReportInterval(double seconds);
+
+    // Install input callbacks on the window; the previous framebuffer size callback keeps working
+    void attach(GLFWwindow* window);
+
+    // stateHash covers everything that ends up on screen (view, poses, scene...);
+    // animating is true while time alone changes the picture.
+    // Returns true if the frame has to be drawn.
+    bool shouldDraw(uint64_t stateHash, bool animating);
+
+    // Block until input arrives or the next report is due
+    void waitForEvents();
+
+private:
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void scrollCallback(GLFWwindow* window, double dx, double dy);
+    static void refreshCallback(GLFWwindow* window);
+    static void focusCallback(GLFWwindow* window, int focused);
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+
+    void report(double now);
+
+    bool enabled;
+    bool inputPending;            // an input or window event arrived since the last check
+    int  keysHeld;                // held keys keep redrawing (joint control, free camera)
+    bool keyDown[GLFW_KEY_LAST + 1];
+    uint64_t lastState;
+    GLFWframebuffersizefun previousFramebufferSize;
+
+    double reportInterval;
+    double windowStart;
+    double cpuStart;
+    int    iterations;
+    int    redraws;
+};
+
+#endif
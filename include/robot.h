@@ -5,6 +5,50 @@
 
 #include <glm/glm.hpp>
 
+// Limits of a rig (see robot_description.h). The palette shader's color table holds
+// MAX_ROBOT_PARTS entries, as does the VAT shader's.
+const int MAX_ROBOT_PARTS  = 32;
+const int MAX_ROBOT_JOINTS = 32;
+
+// The standard joint channels, the first JOINT_COUNT angles of RobotPose; the animations and
+// keyboard drive these. A description's own channels follow them.
+enum RobotJoint {
+    JOINT_NECK = 0,
+    JOINT_SHOULDER_L,
+    JOINT_ELBOW_L,
+    JOINT_SHOULDER_R,
+    JOINT_ELBOW_R,
+    JOINT_HIP_L,
+    JOINT_KNEE_L,
+    JOINT_HIP_R,
+    JOINT_KNEE_R,
+    JOINT_TORSO,
+    JOINT_COUNT
+};
+
+// Rigid body parts of the built-in rig, each drawn as one scaled unit cube. Other rigs have
+// robotPartCount() parts of their own.
+enum RobotPart {
+    PART_TORSO = 0,
+    PART_HEAD,
+    PART_UPPER_ARM_L,
+    PART_FOREARM_L,
+    PART_UPPER_ARM_R,
+    PART_FOREARM_R,
+    PART_THIGH_L,
+    PART_SHIN_L,
+    PART_THIGH_R,
+    PART_SHIN_R
+};
+
+// Joint angles in degrees, one per channel of the active rig
+struct RobotPose {
+    float joint[MAX_ROBOT_JOINTS] = {};
+
+    float& operator[](int i)       { return joint[i]; }
+    float  operator[](int i) const { return joint[i]; }
+};
+
 // Update joint angles from keyboard each frame (pass delta time in seconds)
 void updateJointsFromInput(GLFWwindow* window, float dt);
 
@@ -17,6 +61,26 @@ void drawRobot(GLuint program,
                const glm::mat4& view,
                const glm::mat4& proj);
 
+// Draw an arbitrary pose placed in the world by root (ground point under the robot)
+void drawRobotPose(GLuint program,
+                   GLuint cubeVAO,
+                   const RobotPose& pose,
+                   const glm::mat4& root,
+                   const glm::mat4& view,
+                   const glm::mat4& proj);
+
+// Parts and joint channels of the active rig
+int robotPartCount();
+int robotJointCount();
+
+// Forward kinematics: cube model matrix of every part for a pose (robotPartCount() of them)
+void computeRobotParts(const RobotPose& pose, const glm::mat4& root, glm::mat4 parts[MAX_ROBOT_PARTS]);
+
+// Flat color of a part
+const glm::vec3& robotPartColor(int part);
+
+// Current interactive pose
+const RobotPose& getRobotPose();
 
 void setLeftLeg(float hipDeg, float kneeDeg);
 
@@ -0,0 +1,57 @@
+#ifndef ROBOT_DESCRIPTION_H
+#define ROBOT_DESCRIPTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "robot.h"
+
+// Data-driven robot rig: links drawn as boxes, each attached to its parent by a joint.
+// A description has up to MAX_ROBOT_PARTS links, drawn as that many parts in link order.
+// Each revolute joint is driven by one RobotPose angle, its channel: one of the JOINT_COUNT
+// standard channels the animations drive, or a channel of the description's own, which
+// follow them (up to MAX_ROBOT_JOINTS in all) and hold whatever angle the pose gives them.
+//
+// Plain data with no pointers, so a compiled description is cached on disk as is.
+struct RobotLink {
+    char    name[32];
+    int32_t parent;           // link index, or -1 for the robot's root (its ground point)
+    int32_t joint;            // RobotPose channel that turns this link, or -1 for a fixed joint
+    float   origin[3];        // joint position in the parent's frame
+    float   axis[3];          // unit rotation axis in the parent's frame
+    float   lower, upper;     // joint limits in degrees; none if lower > upper
+    float   visualOffset[3];  // box center in the link's frame
+    float   visualSize[3];    // box size; zero draws nothing
+    float   color[3];
+};
+
+struct RobotDescription {
+    char      name[32];
+    int32_t   linkCount;
+    int32_t   jointCount;                          // channels, at least JOINT_COUNT
+    RobotLink links[MAX_ROBOT_PARTS];
+    int32_t   order[MAX_ROBOT_PARTS];              // link indices, parents before children
+    char      jointNames[MAX_ROBOT_JOINTS][32];    // channel names, the standard ones first
+};
+
+// The rig that used to be hard-coded in robot.cpp (also in assets/robots/default.json)
+const RobotDescription& defaultRobotDescription();
+
+// The description computeRobotParts and robotPartColor use; set before anything poses robots
+void setRobotDescription(const RobotDescription& description);
+const RobotDescription& robotDescription();
+
+// Channel name in the active rig: "neck", "shoulder_l", ... or one of its own
+const char* robotJointName(int joint);
+
+// Parse a JSON description (see README); prints the problem and returns false if invalid
+bool parseRobotDescription(const char* text, size_t size, const std::string& source, RobotDescription& out);
+
+// Loads a description through the asset lookup (see embedded_assets.h). With a cache
+// directory, the compiled description is stored there keyed on the file's contents, and later
+// loads of the same contents skip parsing. fromCache tells which happened.
+bool loadRobotDescription(const std::string& path, const std::string& cacheDirectory,
+                          RobotDescription& out, bool* fromCache = NULL);
+
+#endif
@@ -2,11 +2,36 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
 
 GLuint compileShader(const char* shaderSource, GLenum shaderType);
 
 GLuint CreateShaderProgram(GLuint vertexShader, GLuint fragmentShader);
 
-GLuint loadShaderProgram (const char* vertexPath, const char* fragmentPath);
+struct PreprocessedShader;
 
-#endif
\ No newline at end of file
+// Program from preprocessed sources, through the program binary cache
+GLuint buildShaderProgram(const PreprocessedShader& vertex,
+                          const PreprocessedShader& fragment,
+                          bool* fromCache = NULL);
+
+// Preprocess (includes, defines after #version) and build a program; 0 if a file is missing
+GLuint loadShaderProgram (const char* vertexPath,
+                          const char* fragmentPath,
+                          const std::string& defines = std::string());
+
+// Preprocess a program's sources ahead of time, on any thread (no GL calls). The next
+// loadShaderProgram with the same arguments takes them instead of preprocessing again.
+bool prepareShaderProgram(const char* vertexPath,
+                          const char* fragmentPath,
+                          const std::string& defines = std::string());
+
+// Uniform setters for the currently bound program; uniforms the program does not use are skipped
+void setUniform(GLuint program, const char* name, const glm::mat4& value);
+void setUniform(GLuint program, const char* name, const glm::vec3& value);
+void setUniform(GLuint program, const char* name, const glm::vec2& value);
+void setUniform(GLuint program, const char* name, float value);
+void setUniform(GLuint program, const char* name, int value);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "embedded_assets.h"
+
+// Reads a shader file; returns false if it does not exist
+typedef std::function<bool(const std::string& path, std::string& source)> ShaderFileLoader;
+
+// Loader reading straight from disk; the default loader is loadAsset (embedded copy or override)
+bool loadShaderFile(const std::string& path, std::string& source);
+
+// A shader after includes and defines were resolved
+struct PreprocessedShader {
+    std::string source;
+    std::vector<std::string> files;   // every file read; index i is GLSL source string i in #line
+};
+
+// Expand #include "file" (relative to the including file, each file included once) and insert
+// the defines (full "#define NAME VALUE" lines) right after #version. #line directives keep
+// compiler messages pointing at the original file (by index into files) and line.
+// Returns false, with an error printed, on a missing or malformed include.
+bool preprocessShader(const std::string& path,
+                      const std::string& defines,
+                      PreprocessedShader& out,
+                      const ShaderFileLoader& loader = loadAsset);
+
+// Print which file each source string index of a compiler message refers to
+void printShaderFiles(const PreprocessedShader& shader);
+
+#endif
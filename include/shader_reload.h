@@ -0,0 +1,101 @@
+#ifndef SHADER_RELOAD_H
+#define SHADER_RELOAD_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shader_preprocessor.h"
+
+// A shader file that changed on disk, with its new contents
+struct ChangedShader {
+    std::string path;     // logical path, as passed to loadShaderProgram (e.g. "shaders/x.glsl")
+    std::string source;
+};
+
+// Watches a shader directory and its subdirectories from a background thread (inotify,
+// Linux only) and reads changed files there, so the frame loop only picks up finished sources.
+class ShaderWatcher {
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    // Returns false if watching is unsupported or the directory cannot be watched.
+    // Changes are reported under logicalDirectory, so a watched override directory
+    // still maps to the paths the programs were loaded with.
+    bool start(const std::string& directory, const std::string& logicalDirectory);
+    void stop();
+
+    // Files changed since the last call; the latest contents of each file
+    std::vector<ChangedShader> takeChanges();
+
+private:
+    void run();
+    void addWatches(const std::string& path);
+    void readFile(const std::string& path);
+
+    std::string rootDirectory;
+    std::string logicalRoot;
+    int inotifyFd;
+    std::vector<std::pair<int, std::string> > watches;   // watch descriptor, directory
+    std::thread worker;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::vector<ChangedShader> changes;
+};
+
+// A vertex/fragment program that can be rebuilt while the program runs, when any file it
+// includes changes. Sources are kept in memory, so a rebuild reads nothing from disk. A rebuild compiles
+// in the background when the driver supports parallel shader compile (otherwise at the next
+// frame boundary), is swapped in only once it links, and takes over the old program's
+// uniform values. On errors the old program stays in use.
+class ReloadableProgram {
+public:
+    ReloadableProgram();
+
+    bool load(const char* vertexPath, const char* fragmentPath, const std::string& defines = std::string());
+
+    // load() in two steps: prepare() reads and preprocesses the sources (any thread, no GL),
+    // build() compiles and links them (GL thread)
+    bool prepare(const char* vertexPath, const char* fragmentPath, const std::string& defines = std::string());
+    bool build();
+
+    GLuint id() const { return program; }
+    bool rebuilding() const { return pending != 0; }
+
+    // Start a rebuild if one of the changed files is ours
+    void onShadersChanged(const std::vector<ChangedShader>& changed);
+
+    // Call at a frame boundary: swaps in a finished rebuild, true if id() changed
+    bool update();
+
+    void destroy();
+
+private:
+    bool preprocess(PreprocessedShader& vertex, PreprocessedShader& fragment);
+    void discardPending();
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines;
+    std::map<std::string, std::string> files;   // latest contents of every file read
+    PreprocessedShader vertex;
+    PreprocessedShader fragment;
+    PreprocessedShader pendingVertex;
+    PreprocessedShader pendingFragment;
+
+    GLuint program;
+    GLuint pending;            // program being rebuilt, 0 if none
+    GLuint pendingShaders[2];
+    double rebuildStart;
+    double prepareMs;
+};
+
+// Copy the values of every plain uniform both programs share from one to the other
+void copyUniforms(GLuint from, GLuint to);
+
+#endif
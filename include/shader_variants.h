@@ -0,0 +1,40 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+#include "shader_reload.h"
+
+// Feature switches compiled into a shader instead of branched on at runtime.
+// Each bit becomes a "#define NAME 0/1" line, so shaders test them with #if.
+enum ShaderVariantBits {
+    VARIANT_DEPTH_ONLY   = 1 << 0,   // DEPTH_ONLY: the fragment stage writes depth only
+    VARIANT_VERTEX_COLOR = 1 << 1,   // VERTEX_COLOR: color from the vertex stage, not the objectCol uniform
+    VARIANT_NO_SPECULAR  = 1 << 2,   // NO_SPECULAR: ambient + diffuse only
+    VARIANT_BIT_COUNT    = 3
+};
+
+// Define lines for a set of variant bits
+std::string shaderVariantDefines(unsigned bits);
+
+// Program built from the two files with the given variant bits. Compiled on first use and
+// cached by (files, bits); the cache owns the program, so callers must not delete it.
+// Hot reload replaces the program, so callers take it again after updateShaderVariants().
+GLuint shaderVariant(const char* vertexPath, const char* fragmentPath, unsigned bits);
+
+// Preprocess a variant's sources ahead of time, on any thread (see prepareShaderProgram)
+bool prepareShaderVariant(const char* vertexPath, const char* fragmentPath, unsigned bits);
+
+// Hot reload: rebuild every cached variant that reads one of the changed files
+// (see ReloadableProgram), and at a frame boundary swap in the finished ones.
+// updateShaderVariants returns true if any program changed.
+void reloadShaderVariants(const std::vector<ChangedShader>& changed);
+bool updateShaderVariants();
+bool shaderVariantsRebuilding();
+
+int  shaderVariantCount();
+void destroyShaderVariants();
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef STARTUP_GRAPH_H
+#define STARTUP_GRAPH_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Where a startup task runs: MAIN for window and GL work (the thread owning the context),
+// WORKER for file reads, preprocessing and CPU-side setup (the job system's pool)
+enum class StartupThread { MAIN, WORKER };
+
+// Initialization as a dependency graph: each task starts as soon as the tasks it depends on
+// are done, so CPU work overlaps window and context creation. A task returning false fails
+// startup; tasks depending on it are skipped. Tasks must be added in dependency order.
+class StartupGraph {
+public:
+    typedef int Task;
+
+    Task add(const char* name, StartupThread thread, std::function<bool()> fn,
+             std::initializer_list<Task> dependencies = {});
+
+    // Runs every task and returns once all have finished; false if one failed.
+    // Call from the main thread; MAIN tasks run on the calling thread.
+    bool run();
+
+    // Per task: thread, start and end relative to the start of run(), duration
+    void printTimings() const;
+
+private:
+    struct Node {
+        std::string name;
+        StartupThread thread;
+        std::function<bool()> fn;
+        std::vector<Task> dependents;
+        int waitingFor;
+        bool skipped;
+        double startMs;
+        double endMs;
+    };
+
+    void dispatch(Task task);               // called with mutex held
+    void execute(Task task);
+    void finish(Task task, bool succeeded);  // called with mutex held
+
+    std::vector<Node> nodes;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> mainReady;
+    int finished;
+    bool failed;
+    bool inlineWorkers;   // no worker threads: WORKER tasks run on the main thread
+    double runStart;
+};
+
+#endif
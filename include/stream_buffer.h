@@ -0,0 +1,59 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+// A sub-allocation of the current frame's segment
+struct StreamAllocation {
+    void*      ptr = nullptr;   // write-only, valid until commit()
+    GLintptr   offset = 0;      // byte offset inside buffer()
+    GLsizeiptr size = 0;
+};
+
+// Ring buffer for data uploaded every frame (instance data, palettes, streamed vertices).
+// The buffer is split into one segment per frame in flight; each segment is protected by a
+// fence and only rewritten once the GPU has finished the frame that last used it.
+// Memory is persistently mapped when buffer storage is available and mapped per allocation
+// with GL_MAP_UNSYNCHRONIZED_BIT otherwise, so uploads never orphan or stall in the driver.
+class StreamBuffer {
+public:
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    StreamBuffer();
+
+    // capacity is the total size; each frame gets capacity / FRAMES_IN_FLIGHT bytes
+    bool init(GLsizeiptr capacity, bool allowPersistent = true);
+    void destroy();
+
+    // Wait (and count a stall) if the GPU still uses this frame's segment
+    void beginFrame();
+
+    // Bump-allocate from the current segment; ptr is null when the segment is full.
+    // The offset in the buffer is a multiple of alignment.
+    // In the fallback path only one allocation may be open at a time.
+    StreamAllocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+
+    // Finish writing an allocation (unmaps in the fallback path)
+    void commit(const StreamAllocation& alloc);
+
+    // Fence the segment used this frame and move to the next one
+    void endFrame();
+
+    GLuint buffer() const { return bufferId; }
+    GLsizeiptr capacity() const { return totalSize; }
+    bool isPersistent() const { return persistent; }
+
+private:
+    GLuint bufferId;
+    GLsizeiptr totalSize;
+    GLsizeiptr segmentSize;
+    bool persistent;
+    char* mapped;                         // whole buffer, persistent path only
+
+    int frame;                            // segment used by the current frame
+    GLsizeiptr head;                      // next free byte inside the segment
+    GLsync fences[FRAMES_IN_FLIGHT];
+    bool overflowReported;
+};
+
+#endif
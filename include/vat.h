@@ -0,0 +1,54 @@
+#ifndef VAT_H
+#define VAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "animation.h"
+#include "crowd.h"
+#include "scene.h"
+#include "stream_buffer.h"
+
+// Crowd renderer that animates entirely on the GPU ("vertex animation textures").
+// Baked clips are expanded to per-part matrices and stored in a texture buffer; the
+// vertex shader picks the frame from the instance's clip, phase and the current time.
+// Per-frame CPU work is one placement/clip record per visible robot plus a time uniform.
+class VatCrowdRenderer {
+public:
+    VatCrowdRenderer();
+
+    // Expand the clips to part matrices, upload them and build the shader program
+    bool init(const std::vector<BakedClip>& clips, const StreamBuffer& stream);
+
+    // Stream one placement/clip record per visible robot
+    void update(const Crowd& crowd, const FrameVector<int>& visible, StreamBuffer& stream);
+
+    void draw(const glm::mat4& view,
+              const glm::mat4& proj,
+              const glm::vec3& camPos,
+              const Scene& scene,
+              float time) const;
+
+    // Depth-only pass over the same instances
+    void drawDepth(const glm::mat4& view, const glm::mat4& proj, float time) const;
+
+    // Take the programs from the shader variant cache again, after hot reload rebuilt them
+    void updatePrograms();
+
+    void destroy();
+
+private:
+    static const int MAX_CLIPS = 8;   // must match vat_vertex_shader.glsl
+
+    GLuint program;
+    GLuint depthProgram;
+    GLuint vao;
+    GLuint cubeVBO;
+    GLuint matrixBuffer;
+    GLuint matrixTexture;
+    int partCount;                    // parts of the rig the clips were baked for
+    int instanceCount;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#version 330 core
+
+// Vertex shader: vertices already transformed to world space on the CPU (dynamic batching)
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec3 aColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
+void main() {
+    FragPos = aPos;
+    Normal = aNormal;
+    Color = aColor;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
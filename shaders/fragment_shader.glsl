@@ -1,33 +1,33 @@
 #version 330 core
 
-// Fragment shader: Phong lighting (ambient + diffuse + specular)
+// Fragment shader: Phong lighting (ambient + diffuse + specular) for every robot path.
+// Variants (see shader_variants.h): DEPTH_ONLY, VERTEX_COLOR, NO_SPECULAR.
+
+#include "include/variants.glsl"
+#include "include/lighting.glsl"
 
 in vec3 FragPos;
 in vec3 Normal;
+#if VERTEX_COLOR
+in vec3 Color;
+#else
+uniform vec3 objectCol;
+#endif
 
 uniform vec3 lightPos;
 uniform vec3 lightCol;
-uniform vec3 objectCol;
 uniform vec3 camPos;
 
 out vec4 FragColor;
 
 void main() {
-    // Ambient
-    vec3 ambient = 0.3 * lightCol;
-
-    // Diffuse
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightCol;
-
-    // Specular
-    vec3 viewDir = normalize(camPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = 0.5 * spec * lightCol;
-
-    vec3 result = (ambient + diffuse + specular) * objectCol;
+#if !DEPTH_ONLY
+#if VERTEX_COLOR
+    vec3 color = Color;
+#else
+    vec3 color = objectCol;
+#endif
+    vec3 result = phongLighting(FragPos, Normal, lightPos, lightCol, camPos) * color;
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+// Fragment shader: pre-rendered robot image, tinted by the scene light
+
+in vec2 TexCoord;
+
+uniform sampler2D impostor;
+uniform vec3 lightCol;
+
+out vec4 FragColor;
+
+void main() {
+    vec4 texel = texture(impostor, TexCoord);
+    if (texel.a < 0.5) discard;
+    FragColor = vec4(texel.rgb * lightCol, 1.0);
+}
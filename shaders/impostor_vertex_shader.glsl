@@ -0,0 +1,26 @@
+#version 330 core
+
+// Vertex shader: camera-facing quad per far robot, rotating about the world up axis only
+
+layout (location = 0) in vec2 aCorner;      // x in [-0.5, 0.5], y in [0, 1]
+layout (location = 1) in vec4 aPlacement;   // xyz = ground position, w = heading (unused)
+
+uniform vec2 quadSize;                      // world width / height of the baked image
+uniform float quadBase;                     // height of the image's bottom edge above the ground
+uniform vec3 camPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 TexCoord;
+
+void main() {
+    vec3 toCam = camPos - aPlacement.xyz;
+    vec3 right = normalize(vec3(toCam.z, 0.0, -toCam.x) + vec3(1e-6, 0.0, 0.0));
+
+    vec3 world = aPlacement.xyz
+               + right * aCorner.x * quadSize.x
+               + vec3(0.0, quadBase + aCorner.y * quadSize.y, 0.0);
+    TexCoord = vec2(aCorner.x + 0.5, aCorner.y);
+    gl_Position = projection * view * vec4(world, 1.0);
+}
@@ -0,0 +1,25 @@
+// Phong lighting shared by the robot shaders.
+// NO_SPECULAR 1 drops the highlight (distant proxies, where it is not visible).
+
+vec3 phongLighting(vec3 fragPos, vec3 normal, vec3 lightPos, vec3 lightCol, vec3 camPos) {
+    // Ambient
+    vec3 ambient = 0.3 * lightCol;
+
+    // Diffuse
+    vec3 norm = normalize(normal);
+    vec3 lightDir = normalize(lightPos - fragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightCol;
+
+#if NO_SPECULAR
+    return ambient + diffuse;
+#else
+    // Specular
+    vec3 viewDir = normalize(camPos - fragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = 0.5 * spec * lightCol;
+
+    return ambient + diffuse + specular;
+#endif
+}
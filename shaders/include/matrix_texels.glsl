@@ -0,0 +1,11 @@
+// Affine matrices stored as 3 texels (the first three rows) in a texture buffer
+
+mat4 matrixFromRows(vec4 r0, vec4 r1, vec4 r2) {
+    return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 fetchMatrix(samplerBuffer buffer, int firstTexel) {
+    return matrixFromRows(texelFetch(buffer, firstTexel),
+                          texelFetch(buffer, firstTexel + 1),
+                          texelFetch(buffer, firstTexel + 2));
+}
@@ -0,0 +1,16 @@
+// Per-robot placement records of the instanced crowd paths: xyz = ground position, w = heading (radians)
+
+mat3 headingRotation(float heading) {
+    float c = cos(heading);
+    float s = sin(heading);
+    return mat3(vec3(  c, 0.0,  -s),
+                vec3(0.0, 1.0, 0.0),
+                vec3(  s, 0.0,   c));
+}
+
+// translate * rotateY(heading)
+mat4 placementMatrix(vec4 placement) {
+    mat4 root = mat4(headingRotation(placement.w));
+    root[3] = vec4(placement.xyz, 1.0);
+    return root;
+}
@@ -0,0 +1,11 @@
+// Defaults for the variant switches, for programs built without variant defines
+
+#ifndef DEPTH_ONLY
+#define DEPTH_ONLY 0
+#endif
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 0
+#endif
+#ifndef NO_SPECULAR
+#define NO_SPECULAR 0
+#endif
@@ -0,0 +1,33 @@
+#version 330 core
+
+// Vertex shader: one box standing in for a whole distant robot, instanced per robot
+
+#include "include/placement.glsl"
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aPlacement;   // xyz = ground position, w = heading (radians)
+
+uniform vec3 boxCenter;                     // rest-pose bounds relative to the ground point
+uniform vec3 boxSize;
+uniform vec3 boxColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
+void main() {
+    mat3 rotation = headingRotation(aPlacement.w);
+
+    // The box is only scaled along its own axes, so face normals just rotate
+    FragPos = aPlacement.xyz + rotation * (boxCenter + aPos * boxSize);
+    Normal = rotation * aNormal;
+    Color = boxColor;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Fragment shader: flat color
+
+uniform vec3 color;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(color, 1.0);
+}
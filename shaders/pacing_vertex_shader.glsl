@@ -0,0 +1,11 @@
+#version 330 core
+
+// Vertex shader: unit quad placed as a rectangle in normalized device coordinates
+
+layout (location = 0) in vec2 aPos;
+
+uniform vec4 rect;   // x, y, width, height
+
+void main() {
+    gl_Position = vec4(rect.xy + aPos * rect.zw, 0.0, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+// Vertex shader: merged robot mesh skinned rigidly from a matrix palette.
+// One instance per robot; each vertex carries the index of the part it belongs to.
+
+#define MAX_PARTS 32
+
+#include "include/matrix_texels.glsl"
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in int  aPart;
+
+uniform samplerBuffer palette;      // 3 texels (matrix rows) per part, partCount parts per robot
+uniform int  paletteBase;           // first texel of this frame's palette in the stream buffer
+uniform int  partCount;
+uniform vec3 partColors[MAX_PARTS];
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
+void main() {
+    int base = paletteBase + (gl_InstanceID * partCount + aPart) * 3;
+    mat4 model = fetchMatrix(palette, base);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Color = partColors[aPart];
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
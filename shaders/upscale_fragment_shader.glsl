@@ -0,0 +1,15 @@
+#version 330 core
+
+// Fragment shader: bilinear upscale of the rendered part of the offscreen scene
+
+in vec2 TexCoord;
+
+uniform sampler2D sceneColor;
+uniform vec2 uvScale;   // rendered size / allocated size
+uniform vec2 uvMax;     // last texel centre inside the rendered area
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(sceneColor, min(TexCoord * uvScale, uvMax));
+}
@@ -0,0 +1,58 @@
+#version 330 core
+
+// Vertex shader: crowd animated on the GPU from baked part-matrix textures.
+// One instance per robot part; the per-robot record advances every partCount instances.
+
+#define MAX_PARTS 32
+#define MAX_CLIPS 8
+
+#include "include/placement.glsl"
+#include "include/matrix_texels.glsl"
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aPlacement;   // xyz = ground position, w = heading (radians)
+layout (location = 3) in vec2 aClip;        // x = clip index, y = phase (seconds)
+
+uniform samplerBuffer partMatrices;         // 3 texels (matrix rows) per part per frame
+uniform int   clipOffset[MAX_CLIPS];        // first texel of each clip
+uniform int   clipFrames[MAX_CLIPS];
+uniform float clipRate[MAX_CLIPS];
+uniform int   partCount;
+uniform vec3  partColors[MAX_PARTS];
+uniform float time;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
+void main() {
+    int part = gl_InstanceID % partCount;
+    int clip = int(aClip.x);
+
+    // Frame pair and blend factor
+    float frames = float(clipFrames[clip]);
+    float u = mod((time + aClip.y) * clipRate[clip], frames);
+    int f0 = int(u);
+    int f1 = (f0 + 1) % clipFrames[clip];
+    float f = u - float(f0);
+
+    int t0 = clipOffset[clip] + (f0 * partCount + part) * 3;
+    int t1 = clipOffset[clip] + (f1 * partCount + part) * 3;
+    vec4 r0 = mix(texelFetch(partMatrices, t0),     texelFetch(partMatrices, t1),     f);
+    vec4 r1 = mix(texelFetch(partMatrices, t0 + 1), texelFetch(partMatrices, t1 + 1), f);
+    vec4 r2 = mix(texelFetch(partMatrices, t0 + 2), texelFetch(partMatrices, t1 + 2), f);
+    mat4 local = matrixFromRows(r0, r1, r2);
+
+    mat4 model = placementMatrix(aPlacement) * local;
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Color = partColors[part];
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -12,6 +12,9 @@ uniform mat4 projection;
 out vec3 FragPos;
 out vec3 Normal;
 
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
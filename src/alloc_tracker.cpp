@@ -0,0 +1,201 @@
+#include "alloc_tracker.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(ALLOC_TRACKING) && defined(__GLIBC__)
+#define INTERPOSE_MALLOC 1
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+// Replaces the global allocation functions so they can be counted. Everything still goes to
+// malloc and free; the counts are relaxed since they are only read as statistics.
+static std::atomic<int> gPhase(ALLOC_PHASE_STARTUP);
+static std::atomic<uint64_t> gHeapAllocations[ALLOC_PHASE_COUNT];
+
+#ifdef INTERPOSE_MALLOC
+// Set by the guard while it checks frames: the first allocation prints its stack
+static std::atomic<bool> gTrapArmed(false);
+
+static void trapAllocation() {
+    if (!gTrapArmed.exchange(false)) return;
+    // backtrace_symbols_fd writes straight to the descriptor without allocating
+    static const char header[] = "Allocation guard: first allocation after warm-up:\n";
+    if (write(STDERR_FILENO, header, sizeof(header) - 1) < 0) return;
+    void* frames[32];
+    backtrace_symbols_fd(frames, backtrace(frames, 32), STDERR_FILENO);
+}
+#endif
+
+static inline void countAllocation() {
+    int phase = gPhase.load(std::memory_order_relaxed);
+    gHeapAllocations[phase].fetch_add(1, std::memory_order_relaxed);
+#ifdef INTERPOSE_MALLOC
+    if (phase != ALLOC_PHASE_STARTUP && gTrapArmed.load(std::memory_order_relaxed)) trapAllocation();
+#endif
+}
+
+void setAllocPhase(AllocPhase phase) {
+    gPhase.store(phase, std::memory_order_relaxed);
+}
+
+const char* allocPhaseName(AllocPhase phase) {
+    switch (phase) {
+        case ALLOC_PHASE_STARTUP: return "startup";
+        case ALLOC_PHASE_INPUT:   return "input";
+        case ALLOC_PHASE_ANIMATE: return "animate";
+        case ALLOC_PHASE_CULL:    return "cull";
+        case ALLOC_PHASE_DRAW:    return "draw";
+        case ALLOC_PHASE_PRESENT: return "present";
+        default:                  return "?";
+    }
+}
+
+uint64_t heapAllocationCount() {
+    uint64_t total = 0;
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) total += gHeapAllocations[i].load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t heapAllocationCount(AllocPhase phase) {
+    return gHeapAllocations[phase].load(std::memory_order_relaxed);
+}
+
+#ifdef INTERPOSE_MALLOC
+
+bool allocTrackingCoversMalloc() { return true; }
+
+// glibc's own entry points, so the replacements below can forward to them
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size) noexcept {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) noexcept {
+    countAllocation();
+    return __libc_realloc(p, size);
+}
+}
+
+// malloc is counted already
+static void* countedAlloc(size_t size) {
+    return malloc(size ? size : 1);
+}
+
+#else
+
+bool allocTrackingCoversMalloc() { return false; }
+
+static void* countedAlloc(size_t size) {
+    countAllocation();
+    return malloc(size ? size : 1);
+}
+
+#endif
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+FrameAllocGuard::FrameAllocGuard()
+    : warmupFrames(0), checkedFrames(0), frame(0), failedFrames(0)
+{
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) frameStart[i] = found[i] = 0;
+}
+
+void FrameAllocGuard::start(int warmup, int checked) {
+    warmupFrames = warmup;
+    checkedFrames = checked;
+    frame = 0;
+    failedFrames = 0;
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) found[i] = 0;
+#ifdef INTERPOSE_MALLOC
+    // The first backtrace call loads the unwinder, which allocates; get that done now
+    void* frames[4];
+    backtrace(frames, 4);
+#endif
+}
+
+void FrameAllocGuard::beginFrame() {
+    if (!active()) return;
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) frameStart[i] = heapAllocationCount((AllocPhase)i);
+}
+
+bool FrameAllocGuard::endFrame() {
+    if (!active()) return false;
+    ++frame;
+    if (frame > warmupFrames) {
+        uint64_t frameTotal = 0;
+        uint64_t counts[ALLOC_PHASE_COUNT];
+        for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) {
+            counts[i] = heapAllocationCount((AllocPhase)i) - frameStart[i];
+            found[i] += counts[i];
+            frameTotal += counts[i];
+        }
+        if (frameTotal > 0) {
+            ++failedFrames;
+            printf("Allocation guard: frame %d made %llu heap allocations (", frame, (unsigned long long)frameTotal);
+            const char* separator = "";
+            for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) {
+                if (counts[i] == 0) continue;
+                printf("%s%s %llu", separator, allocPhaseName((AllocPhase)i), (unsigned long long)counts[i]);
+                separator = ", ";
+            }
+            printf(")\n");
+        }
+    }
+#ifdef INTERPOSE_MALLOC
+    gTrapArmed.store(frame >= warmupFrames && frame < warmupFrames + checkedFrames && failedFrames == 0);
+#endif
+    return frame >= warmupFrames + checkedFrames;
+}
+
+void FrameAllocGuard::printSummary() const {
+    if (!active()) return;
+    int checked = frame > warmupFrames ? frame - warmupFrames : 0;
+    if (!failed()) {
+        printf("Allocation guard: passed, no heap allocations in %d frames after %d warm-up frames%s\n", checked,
+               warmupFrames, allocTrackingCoversMalloc() ? "" : " (operator new only)");
+        return;
+    }
+    printf("Allocation guard: FAILED, %d of %d frames allocated after warm-up:", failedFrames, checked);
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) {
+        if (found[i]) printf(" %s %llu", allocPhaseName((AllocPhase)i), (unsigned long long)found[i]);
+    }
+    printf("\n");
+}
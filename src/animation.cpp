@@ -0,0 +1,116 @@
+#include "animation.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+static const float PI = 3.14159265f;
+
+const float IDLE_WALK_PERIOD  = PI;                // sin(2t)
+const float ARM_WAVE_PERIOD   = 4.0f * PI / 3.0f;  // sin(1.5t)
+const float HEAD_BOB_PERIOD   = 0.8f * PI;         // sin(2.5t)
+const float TORSO_SWAY_PERIOD = 2.0f * PI;         // sin(t)
+
+void animIdleWalk(float t, RobotPose& pose) {
+    float s = sinf(2.0f * t);                       // -1..+1
+    pose[JOINT_HIP_L]  = 30.0f * s;                 // swing
+    pose[JOINT_KNEE_L] = 40.0f * fmaxf(0.0f, s);    // bend on forward swing
+}
+
+void animArmWave(float t, RobotPose& pose) {
+    pose[JOINT_SHOULDER_L] = 60.0f * sinf(1.5f * t);          // Wave up and down
+    pose[JOINT_SHOULDER_R] = 60.0f * sinf(1.5f * t + PI);     // Opposite phase
+}
+
+void animHeadBob(float t, RobotPose& pose) {
+    pose[JOINT_NECK] = 15.0f * sinf(2.5f * t);      // Gentle nod
+}
+
+void animTorsoSway(float t, RobotPose& pose) {
+    pose[JOINT_TORSO] = 10.0f * sinf(1.0f * t);     // Slow gentle sway
+}
+
+BakedClip bakeClip(const char* name,
+                   const ProceduralAnim* anims,
+                   int animCount,
+                   float period,
+                   float sampleRate)
+{
+    BakedClip clip;
+    clip.name = name;
+    clip.period = period;
+
+    int count = (int)lroundf(period * sampleRate);
+    if (count < 2) count = 2;
+    clip.sampleRate = count / period;
+    clip.samples.resize(count);
+
+    const Aabb unitCube = { glm::vec3(-0.5f), glm::vec3(0.5f) };
+    clip.bounds.min = glm::vec3(1e30f);
+    clip.bounds.max = glm::vec3(-1e30f);
+
+    for (int i = 0; i < count; ++i) {
+        float t = i / clip.sampleRate;
+        for (int a = 0; a < animCount; ++a) {
+            anims[a](t, clip.samples[i]);
+        }
+
+        glm::mat4 parts[MAX_ROBOT_PARTS];
+        computeRobotParts(clip.samples[i], glm::mat4(1.0f), parts);
+        for (int p = 0; p < robotPartCount(); ++p) {
+            Aabb box = transformAabb(unitCube, parts[p]);
+            clip.bounds.min = glm::min(clip.bounds.min, box.min);
+            clip.bounds.max = glm::max(clip.bounds.max, box.max);
+        }
+    }
+
+    cout << "Baked clip '" << clip.name << "': " << count << " samples @ "
+         << clip.sampleRate << " Hz, " << clipMemoryBytes(clip) << " bytes" << endl;
+    return clip;
+}
+
+void sampleClip(const BakedClip& clip, float time, RobotPose& out) {
+    const int count = (int)clip.samples.size();
+
+    float u = fmodf(time, clip.period);
+    if (u < 0.0f) u += clip.period;
+    u *= clip.sampleRate;
+
+    int i0 = (int)u;
+    if (i0 >= count) i0 = count - 1;
+    int i1 = (i0 + 1 == count) ? 0 : i0 + 1;
+    float f = u - (float)i0;
+
+    const RobotPose& a = clip.samples[i0];
+    const RobotPose& b = clip.samples[i1];
+    const int joints = robotJointCount();
+    for (int j = 0; j < joints; ++j) {
+        out[j] = a[j] + (b[j] - a[j]) * f;
+    }
+}
+
+size_t clipMemoryBytes(const BakedClip& clip) {
+    return sizeof(BakedClip)
+         + clip.name.capacity()
+         + clip.samples.capacity() * sizeof(RobotPose);
+}
+
+std::vector<BakedClip> bakeStandardClips(float sampleRate) {
+    vector<BakedClip> clips;
+
+    const ProceduralAnim walk[] = { animIdleWalk };
+    clips.push_back(bakeClip("idle_walk", walk, 1, IDLE_WALK_PERIOD, sampleRate));
+
+    const ProceduralAnim wave[] = { animArmWave, animHeadBob };
+    // 4pi is the LCM of the arm wave (4pi/3) and head bob (0.8pi) periods
+    clips.push_back(bakeClip("wave_nod", wave, 2, 4.0f * PI, sampleRate));
+
+    // Every animation at once; 4pi is the LCM of all four periods
+    const ProceduralAnim all[] = { animIdleWalk, animArmWave, animHeadBob, animTorsoSway };
+    clips.push_back(bakeClip("all", all, 4, 4.0f * PI, sampleRate));
+
+    size_t total = 0;
+    for (const BakedClip& c : clips) total += clipMemoryBytes(c);
+    cout << "Baked " << clips.size() << " clips, " << total << " bytes total" << endl;
+    return clips;
+}
@@ -0,0 +1,181 @@
+#include "asset_archive.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char ARCHIVE_MAGIC[4] = {'R', 'P', 'A', 'K'};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+AssetArchive::AssetArchive()
+    : entries(NULL), names(NULL), count(0)
+{
+}
+
+bool AssetArchive::open(const string& path) {
+    close();
+    if (!file.open(path)) {
+        cerr << "Error: cannot open asset archive " << path << endl;
+        return false;
+    }
+
+    const char* base = file.data();
+    const uint64_t size = file.size();
+    AssetArchiveHeader header;
+    if (size < sizeof(header)) {
+        cerr << "Error: " << path << " is not an asset archive" << endl;
+        file.close();
+        return false;
+    }
+    memcpy(&header, base, sizeof(header));
+
+    uint64_t indexEnd = sizeof(header) + (uint64_t)header.entryCount * sizeof(AssetArchiveEntry);
+    bool valid = memcmp(header.magic, ARCHIVE_MAGIC, 4) == 0
+              && header.version == ASSET_ARCHIVE_VERSION
+              && header.alignment >= ASSET_ARCHIVE_ALIGNMENT && (header.alignment & (header.alignment - 1)) == 0
+              && indexEnd <= header.namesOffset
+              && header.namesOffset <= header.dataOffset
+              && header.dataOffset <= size;
+
+    // Every entry must stay inside the file at the alignment the packer wrote, and paths must
+    // be sorted for the binary search
+    const AssetArchiveEntry* index = (const AssetArchiveEntry*)(base + sizeof(header));
+    const char* strings = base + header.namesOffset;
+    const uint64_t namesSize = header.dataOffset - header.namesOffset;
+    for (uint32_t i = 0; valid && i < header.entryCount; ++i) {
+        const AssetArchiveEntry& e = index[i];
+        valid = (uint64_t)e.nameOffset + e.nameLength <= namesSize
+             && e.offset >= header.dataOffset && e.offset <= size && e.size <= size - e.offset
+             && e.offset % header.alignment == 0;
+        if (valid && i > 0) {
+            const AssetArchiveEntry& p = index[i - 1];
+            valid = string(strings + p.nameOffset, p.nameLength) < string(strings + e.nameOffset, e.nameLength);
+        }
+    }
+    if (!valid) {
+        cerr << "Error: asset archive " << path << " is corrupt or from another version" << endl;
+        file.close();
+        return false;
+    }
+
+    entries = index;
+    names = strings;
+    count = (int)header.entryCount;
+    return true;
+}
+
+void AssetArchive::close() {
+    file.close();
+    entries = NULL;
+    names = NULL;
+    count = 0;
+}
+
+bool AssetArchive::find(const string& path, const char*& data, size_t& size) const {
+    int lo = 0;
+    int hi = count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const AssetArchiveEntry& e = entries[mid];
+        int order = path.compare(0, string::npos, names + e.nameOffset, e.nameLength);
+        if (order == 0) {
+            data = file.data() + e.offset;
+            size = (size_t)e.size;
+            return true;
+        }
+        if (order < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return false;
+}
+
+string AssetArchive::entryPath(int index) const {
+    if (index < 0 || index >= count) return string();
+    return string(names + entries[index].nameOffset, entries[index].nameLength);
+}
+
+static bool writeAll(FILE* out, const void* data, size_t size) {
+    return size == 0 || fwrite(data, 1, size, out) == size;
+}
+
+static bool writePadding(FILE* out, uint64_t from, uint64_t to) {
+    static const char zeros[256] = {};
+    while (from < to) {
+        size_t n = (size_t)min<uint64_t>(to - from, sizeof(zeros));
+        if (!writeAll(out, zeros, n)) return false;
+        from += n;
+    }
+    return true;
+}
+
+bool writeAssetArchive(const string& output, vector<AssetArchiveInput> inputs) {
+    sort(inputs.begin(), inputs.end(), [](const AssetArchiveInput& a, const AssetArchiveInput& b) {
+        return a.path < b.path;
+    });
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (inputs[i].path == inputs[i - 1].path) {
+            cerr << "Error: " << inputs[i].path << " is packed twice" << endl;
+            return false;
+        }
+    }
+
+    // Map every input first, so the layout is known before anything is written
+    vector<MappedFile> files(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!files[i].open(inputs[i].file)) {
+            cerr << "Error: cannot read " << inputs[i].file << endl;
+            return false;
+        }
+    }
+
+    AssetArchiveHeader header;
+    memcpy(header.magic, ARCHIVE_MAGIC, 4);
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.entryCount = (uint32_t)inputs.size();
+    header.alignment = ASSET_ARCHIVE_ALIGNMENT;
+    header.namesOffset = sizeof(header) + inputs.size() * sizeof(AssetArchiveEntry);
+
+    vector<AssetArchiveEntry> entries(inputs.size());
+    string names;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        entries[i].nameOffset = (uint32_t)names.size();
+        entries[i].nameLength = (uint32_t)inputs[i].path.size();
+        names += inputs[i].path;
+        names += '\0';
+    }
+    header.dataOffset = alignUp(header.namesOffset + names.size(), header.alignment);
+    uint64_t cursor = header.dataOffset;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        entries[i].offset = cursor;
+        entries[i].size = files[i].size();
+        cursor = alignUp(cursor + files[i].size(), header.alignment);
+    }
+
+    string temporary = output + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out) {
+        cerr << "Error: cannot write " << temporary << endl;
+        return false;
+    }
+    bool ok = writeAll(out, &header, sizeof(header))
+           && writeAll(out, entries.data(), entries.size() * sizeof(AssetArchiveEntry))
+           && writeAll(out, names.data(), names.size())
+           && writePadding(out, header.namesOffset + names.size(), header.dataOffset);
+    for (size_t i = 0; ok && i < inputs.size(); ++i) {
+        ok = writeAll(out, files[i].data(), files[i].size())
+          && writePadding(out, entries[i].offset + entries[i].size,
+                          i + 1 < inputs.size() ? entries[i + 1].offset : entries[i].offset + entries[i].size);
+    }
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), output.c_str()) != 0) {
+        cerr << "Error: writing " << output << " failed" << endl;
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,177 @@
+#include "asset_manager.h"
+#include "embedded_assets.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+Asset::Asset() : stateValue((int)AssetState::LOADING) {
+}
+
+bool TextAsset::decode(MappedFile& bytes) {
+    contents.assign(bytes.data(), bytes.size());
+    return true;
+}
+
+const size_t BufferAsset::sliceBytes;
+
+BufferAsset::BufferAsset() : id(0), length(0), uploaded(0) {
+}
+
+bool BufferAsset::decode(MappedFile& file) {
+    // Nothing to decode: keep the mapping and copy straight into the buffer at upload
+    length = file.size();
+    bytes = std::move(file);
+    return true;
+}
+
+bool BufferAsset::upload() {
+    if (id == 0) {
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_ARRAY_BUFFER, id);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)length, NULL, GL_STATIC_DRAW);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, id);
+    }
+    size_t slice = min(sliceBytes, length - uploaded);
+    if (slice > 0) glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)uploaded, (GLsizeiptr)slice, bytes.data() + uploaded);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded += slice;
+
+    if (uploaded < length) return false;
+    bytes.close();
+    return true;
+}
+
+void BufferAsset::release() {
+    if (id) glDeleteBuffers(1, &id);
+    id = 0;
+}
+
+AssetManager::AssetManager()
+    : closed(false), pendingCount(0), decoding(0), loaded(0), failed(0)
+{
+}
+
+AssetManager::~AssetManager() {
+    shutdown();
+}
+
+shared_ptr<Asset> AssetManager::acquire(const string& key, const string& path,
+                                        const function<shared_ptr<Asset>()>& create) {
+    shared_ptr<Asset> asset;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        map<string, weak_ptr<Asset> >::iterator it = assets.find(key);
+        if (it != assets.end()) asset = it->second.lock();
+        if (asset) return asset;
+
+        asset = create();
+        asset->assetPath = path;
+        assets[key] = asset;
+    }
+    ++pendingCount;
+    ++decoding;
+    jobSystem().submit([this, asset]() mutable { decode(asset); });
+    return asset;
+}
+
+void AssetManager::decode(shared_ptr<Asset>& asset) {
+    MappedFile bytes;
+    bool decoded = false;
+    if (!mapAsset(asset->path(), bytes)) {
+        cerr << "Error: cannot open asset " << asset->path() << endl;
+    } else if (!asset->decode(bytes)) {
+        cerr << "Error: cannot decode asset " << asset->path() << endl;
+    } else {
+        decoded = true;
+    }
+
+    if (decoded) {
+        asset->stateValue = (int)AssetState::UPLOADING;
+        lock_guard<std::mutex> lock(mutex);
+        uploads.push_back(asset);
+    } else {
+        asset->stateValue = (int)AssetState::FAILED;
+        --pendingCount;
+        ++failed;
+    }
+    // Drop the task's reference before shutdown() can see the decode as finished
+    asset.reset();
+    --decoding;
+}
+
+void AssetManager::update(double budgetMs) {
+    releaseRetired();
+
+    double start = monotonicSeconds();
+    bool uploading = false;
+    for (;;) {
+        shared_ptr<Asset> asset;
+        {
+            lock_guard<std::mutex> lock(mutex);
+            if (uploads.empty()) break;
+            asset = uploads.front();
+        }
+
+        // Only the queue and this copy refer to it: nobody wants the asset any more
+        if (asset.use_count() > 2) {
+            if (uploading && (monotonicSeconds() - start) * 1000.0 >= budgetMs) break;
+            uploading = true;
+            if (!asset->upload()) continue;   // more slices next time, budget permitting
+            asset->stateValue = (int)AssetState::READY;
+            ++loaded;
+        }
+        --pendingCount;
+        lock_guard<std::mutex> lock(mutex);
+        uploads.pop_front();
+    }
+    if (uploading) frameStats().add(STAT_ASSET_UPLOAD_MS, (monotonicSeconds() - start) * 1000.0);
+}
+
+void AssetManager::retire(Asset* asset) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!closed) {
+            retired.push_back(asset);
+            return;
+        }
+    }
+    // The GL context may be gone; its objects went with it
+    cerr << "Warning: asset " << asset->path() << " released after the asset manager shut down" << endl;
+    delete asset;
+}
+
+void AssetManager::releaseRetired() {
+    vector<Asset*> released;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (retired.empty()) return;
+        released.swap(retired);
+        for (map<string, weak_ptr<Asset> >::iterator it = assets.begin(); it != assets.end(); ) {
+            if (it->second.expired()) it = assets.erase(it);
+            else ++it;
+        }
+    }
+    for (Asset* asset : released) {
+        asset->release();
+        delete asset;
+    }
+}
+
+void AssetManager::shutdown() {
+    // Decodes in flight still reference assets
+    while (decoding.load() > 0) this_thread::yield();
+    {
+        deque<shared_ptr<Asset> > dropped;
+        lock_guard<std::mutex> lock(mutex);
+        dropped.swap(uploads);
+        pendingCount -= (int)dropped.size();
+    }
+    releaseRetired();
+    lock_guard<std::mutex> lock(mutex);
+    closed = true;
+}
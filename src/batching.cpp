@@ -0,0 +1,201 @@
+#include "batching.h"
+#include "cube.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BATCH_USE_SSE 1
+#else
+#define BATCH_USE_SSE 0
+#endif
+
+using namespace std;
+
+// The cube is laid out face by face, 6 vertices per face sharing one normal
+static const int VERTICES_PER_FACE = 6;
+
+void transformCube(const glm::mat4& model, const glm::vec3& color, BatchVertex* out) {
+    const float* src = getCubeVertices();
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+#if BATCH_USE_SSE
+    const __m128 c0 = _mm_loadu_ps(&model[0][0]);
+    const __m128 c1 = _mm_loadu_ps(&model[1][0]);
+    const __m128 c2 = _mm_loadu_ps(&model[2][0]);
+    const __m128 c3 = _mm_loadu_ps(&model[3][0]);
+    const __m128 n0 = _mm_setr_ps(normalMatrix[0][0], normalMatrix[0][1], normalMatrix[0][2], 0.0f);
+    const __m128 n1 = _mm_setr_ps(normalMatrix[1][0], normalMatrix[1][1], normalMatrix[1][2], 0.0f);
+    const __m128 n2 = _mm_setr_ps(normalMatrix[2][0], normalMatrix[2][1], normalMatrix[2][2], 0.0f);
+
+    __m128 normal = _mm_setzero_ps();
+    for (int v = 0; v < CUBE_VERTEX_COUNT; ++v) {
+        const float* s = src + v * CUBE_VERTEX_FLOATS;
+
+        __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(s[0])),
+                                         _mm_mul_ps(c1, _mm_set1_ps(s[1]))),
+                              _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(s[2])), c3));
+
+        if (v % VERTICES_PER_FACE == 0) {
+            __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n0, _mm_set1_ps(s[3])),
+                                             _mm_mul_ps(n1, _mm_set1_ps(s[4]))),
+                                  _mm_mul_ps(n2, _mm_set1_ps(s[5])));
+            // Horizontal dot product (w is zero) without SSE4.1
+            __m128 sq = _mm_mul_ps(n, n);
+            __m128 sum = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+            sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            normal = _mm_div_ps(n, _mm_sqrt_ps(sum));
+        }
+
+        // Each 4-wide store spills one float into the next field, which is written right after
+        BatchVertex& o = out[v];
+        _mm_storeu_ps(o.position, p);
+        _mm_storeu_ps(o.normal, normal);
+        o.color[0] = color.r;
+        o.color[1] = color.g;
+        o.color[2] = color.b;
+    }
+#else
+    glm::vec3 normal(0.0f);
+    for (int v = 0; v < CUBE_VERTEX_COUNT; ++v) {
+        const float* s = src + v * CUBE_VERTEX_FLOATS;
+        glm::vec4 p = model * glm::vec4(s[0], s[1], s[2], 1.0f);
+        if (v % VERTICES_PER_FACE == 0) {
+            normal = glm::normalize(normalMatrix * glm::vec3(s[3], s[4], s[5]));
+        }
+
+        BatchVertex& o = out[v];
+        for (int k = 0; k < 3; ++k) {
+            o.position[k] = p[k];
+            o.normal[k] = normal[k];
+            o.color[k] = color[k];
+        }
+    }
+#endif
+}
+
+BatchedCrowdRenderer::BatchedCrowdRenderer()
+    : program(0), depthProgram(0), vao(0), firstVertex(0), vertexCount(0)
+{
+}
+
+bool BatchedCrowdRenderer::init(const StreamBuffer& stream) {
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    updatePrograms();
+    return program != 0 && depthProgram != 0;
+}
+
+void BatchedCrowdRenderer::update(const Crowd& crowd,
+                                  const FrameVector<int>& visible,
+                                  const Frustum& frustum,
+                                  StreamBuffer& stream)
+{
+    double start = monotonicSeconds();
+    vertexCount = 0;
+
+    const int robots = (int)visible.size();
+    const int partCount = robotPartCount();
+    partMatrices.resize((size_t)robots * partCount);
+    partVisible.resize((size_t)robots * partCount);
+    vertexOffset.resize(robots + 1);
+
+    // FK and per-part culling
+    jobSystem().parallelFor(robots, 32, [&](int begin, int end) {
+        PartSpheres spheres;
+        for (int k = begin; k < end; ++k) {
+            int i = visible[k];
+            glm::mat4* parts = &partMatrices[(size_t)k * partCount];
+            computeRobotParts(crowd.poses[i], crowd.rootMatrix(i), parts);
+            computePartSpheres(parts, partCount, spheres);
+            vertexOffset[k + 1] = CUBE_VERTEX_COUNT *
+                cullSpheres(frustum, spheres.x, spheres.y, spheres.z, spheres.radius,
+                            partCount, &partVisible[(size_t)k * partCount]);
+        }
+    });
+
+    vertexOffset[0] = 0;
+    for (int k = 0; k < robots; ++k) vertexOffset[k + 1] += vertexOffset[k];
+    const int total = vertexOffset[robots];
+    frameStats().add(STAT_PARTS_CULLED, (double)robots * partCount - total / CUBE_VERTEX_COUNT);
+
+    // Aligned to the vertex size so the buffer offset is a whole vertex index
+    StreamAllocation alloc = stream.allocate((GLsizeiptr)total * sizeof(BatchVertex), sizeof(BatchVertex));
+    if (!alloc.ptr) return;
+    BatchVertex* vertices = (BatchVertex*)alloc.ptr;
+
+    // Pre-transform the surviving parts
+    jobSystem().parallelFor(robots, 32, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            const glm::mat4* parts = &partMatrices[(size_t)k * partCount];
+            const unsigned char* partOn = &partVisible[(size_t)k * partCount];
+            BatchVertex* out = vertices + vertexOffset[k];
+            for (int p = 0; p < partCount; ++p) {
+                if (!partOn[p]) continue;
+                transformCube(parts[p], robotPartColor(p), out);
+                out += CUBE_VERTEX_COUNT;
+            }
+        }
+    });
+    stream.commit(alloc);
+
+    firstVertex = (int)(alloc.offset / (GLintptr)sizeof(BatchVertex));
+    vertexCount = total;
+    frameStats().add(STAT_CPU_ANIM_MS, (monotonicSeconds() - start) * 1000.0);
+}
+
+void BatchedCrowdRenderer::draw(const glm::mat4& view,
+                                const glm::mat4& proj,
+                                const glm::vec3& camPos,
+                                const Scene& scene) const
+{
+    if (vertexCount == 0) return;
+
+    glUseProgram(program);
+    setUniform(program, "view", view);
+    setUniform(program, "projection", proj);
+    setUniform(program, "camPos", camPos);
+    setUniform(program, "lightPos", scene.lightPosition);
+    setUniform(program, "lightCol", scene.lightColor);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, firstVertex, vertexCount);
+    glBindVertexArray(0);
+}
+
+void BatchedCrowdRenderer::drawDepth(const glm::mat4& view, const glm::mat4& proj) const {
+    if (vertexCount == 0) return;
+
+    glUseProgram(depthProgram);
+    setUniform(depthProgram, "view", view);
+    setUniform(depthProgram, "projection", proj);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, firstVertex, vertexCount);
+    glBindVertexArray(0);
+}
+
+void BatchedCrowdRenderer::updatePrograms() {
+    // Both programs belong to the shader variant cache
+    program = shaderVariant("shaders/batch_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_VERTEX_COLOR);
+    depthProgram = shaderVariant("shaders/batch_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_DEPTH_ONLY);
+}
+
+void BatchedCrowdRenderer::destroy() {
+    glDeleteVertexArrays(1, &vao);
+    program = depthProgram = vao = 0;
+    vertexCount = 0;
+}
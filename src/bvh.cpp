@@ -0,0 +1,408 @@
+#include "bvh.h"
+#include "job_system.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+using namespace std;
+
+static const int   MAX_LEAF_SIZE  = 4;     // leaves never hold fewer primitives than this by choice
+static const int   FORCE_SPLIT    = 16;    // leaves never hold more than this
+static const int   BIN_COUNT      = 16;
+static const float TRAVERSAL_COST = 1.0f;  // relative to one primitive test
+static const int   PARALLEL_DEPTH = 6;     // build/refit the top levels as parallel tasks
+static const int   PARALLEL_MIN   = 2048;  // primitives below which a subtree stays serial
+static const int   MAX_SAH_DEPTH  = 48;    // deeper nodes split at the median instead
+// Median splits halve the range, so they add at most 30 levels below MAX_SAH_DEPTH.
+// Traversals push both children and hold at most one entry per level plus the current node.
+static const int   MAX_DEPTH      = MAX_SAH_DEPTH + 30;
+static const int   STACK_SIZE     = MAX_DEPTH + 1;
+
+float surfaceArea(const Aabb& box) {
+    glm::vec3 d = box.max - box.min;
+    if (d.x < 0.0f) return 0.0f;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static Aabb emptyBox() {
+    Aabb b;
+    b.min = glm::vec3(1e30f);
+    b.max = glm::vec3(-1e30f);
+    return b;
+}
+
+static void grow(Aabb& box, const Aabb& other) {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+static void grow(Aabb& box, const glm::vec3& p) {
+    box.min = glm::min(box.min, p);
+    box.max = glm::max(box.max, p);
+}
+
+static bool overlaps(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// 0 = outside, 1 = intersecting, 2 = fully inside
+static int classify(const Frustum& frustum, const Aabb& box) {
+    glm::vec3 c = (box.min + box.max) * 0.5f;
+    glm::vec3 e = (box.max - box.min) * 0.5f;
+    int result = 2;
+    for (int i = 0; i < 6; ++i) {
+        const glm::vec4& p = frustum.planes[i];
+        float d = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+        float r = fabsf(p.x) * e.x + fabsf(p.y) * e.y + fabsf(p.z) * e.z;
+        if (d + r < 0.0f) return 0;
+        if (d - r < 0.0f) result = 1;
+    }
+    return result;
+}
+
+// Slab test; returns the entry distance or a negative value on a miss
+static float rayBox(const Aabb& box, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance) {
+    float tmin = 0.0f, tmax = maxDistance;
+    for (int a = 0; a < 3; ++a) {
+        float t0 = (box.min[a] - origin[a]) * invDir[a];
+        float t1 = (box.max[a] - origin[a]) * invDir[a];
+        if (t0 > t1) swap(t0, t1);
+        tmin = max(tmin, t0);
+        tmax = min(tmax, t1);
+        if (tmin > tmax) return -1.0f;
+    }
+    return tmin;
+}
+
+Bvh::Bvh() : rebuildThreshold(1.5f), parallel(true), root(-1), freeNodes(0), dirty(false) {
+}
+
+void Bvh::build(const vector<Aabb>& boxes) {
+    const int n = (int)boxes.size();
+    primBounds = boxes;
+    primIndex.resize(n);
+    centroids.resize(n);
+    for (int i = 0; i < n; ++i) {
+        primIndex[i] = i;
+        centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    }
+
+    nodes.clear();
+    freeNodes = 0;
+    dirty = false;
+    root = -1;
+    if (n == 0) return;
+
+    nodes.resize(2 * n);
+    atomic<int> nextNode(0);
+    root = buildRange(0, n, 0, nextNode);
+    nodes.resize(nextNode.load());
+}
+
+int Bvh::buildRange(int begin, int end, int depth, atomic<int>& nextNode) {
+    const int nodeId = nextNode.fetch_add(1);
+    const int count = end - begin;
+
+    Aabb bounds = emptyBox();
+    Aabb centroidBounds = emptyBox();
+    for (int i = begin; i < end; ++i) {
+        grow(bounds, primBounds[primIndex[i]]);
+        grow(centroidBounds, centroids[primIndex[i]]);
+    }
+
+    Node& node = nodes[nodeId];
+    node.bounds = bounds;
+    node.first = begin;
+    node.count = count;
+    node.left = node.right = -1;
+    node.buildArea = surfaceArea(bounds);
+
+    if (count <= MAX_LEAF_SIZE) return nodeId;
+
+    // Split axis: largest centroid extent
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    // Lopsided SAH splits (one primitive off a large range) can chain up; past MAX_SAH_DEPTH
+    // the range is split at the median so the depth stays bounded
+    int mid = begin + count / 2;
+    if (extent[axis] > 1e-6f && depth < MAX_SAH_DEPTH) {
+        // Binned SAH
+        int binCount[BIN_COUNT] = {};
+        Aabb binBounds[BIN_COUNT];
+        for (int b = 0; b < BIN_COUNT; ++b) binBounds[b] = emptyBox();
+
+        const float scale = BIN_COUNT / extent[axis];
+        auto binOf = [&](int prim) {
+            int b = (int)((centroids[prim][axis] - centroidBounds.min[axis]) * scale);
+            return min(b, BIN_COUNT - 1);
+        };
+        for (int i = begin; i < end; ++i) {
+            int b = binOf(primIndex[i]);
+            ++binCount[b];
+            grow(binBounds[b], primBounds[primIndex[i]]);
+        }
+
+        float rightArea[BIN_COUNT];
+        int rightCount[BIN_COUNT];
+        Aabb acc = emptyBox();
+        int accCount = 0;
+        for (int b = BIN_COUNT - 1; b > 0; --b) {
+            grow(acc, binBounds[b]);
+            accCount += binCount[b];
+            rightArea[b] = surfaceArea(acc);
+            rightCount[b] = accCount;
+        }
+
+        float bestCost = 1e30f;
+        int bestSplit = -1;
+        acc = emptyBox();
+        accCount = 0;
+        for (int b = 0; b < BIN_COUNT - 1; ++b) {
+            grow(acc, binBounds[b]);
+            accCount += binCount[b];
+            if (accCount == 0 || rightCount[b + 1] == 0) continue;
+            float cost = accCount * surfaceArea(acc) + rightCount[b + 1] * rightArea[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+
+        const float parentArea = max(node.buildArea, 1e-12f);
+        const float splitCost = TRAVERSAL_COST + bestCost / parentArea;
+        if ((bestSplit < 0 || splitCost >= (float)count) && count <= FORCE_SPLIT) {
+            return nodeId;
+        }
+        if (bestSplit >= 0) {
+            int* split = partition(&primIndex[begin], &primIndex[begin] + count,
+                                   [&](int prim) { return binOf(prim) <= bestSplit; });
+            mid = (int)(split - &primIndex[0]);
+        }
+    }
+
+    if (mid == begin || mid == end || depth >= MAX_SAH_DEPTH) {
+        // Degenerate centroids or too deep: split the range in half along the axis
+        mid = begin + count / 2;
+        nth_element(&primIndex[begin], &primIndex[mid], &primIndex[begin] + count,
+                    [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    int left = -1, right = -1;
+    if (parallel && depth < PARALLEL_DEPTH && count >= PARALLEL_MIN) {
+        jobSystem().parallelFor(2, 1, [&](int side, int) {
+            if (side == 0) left = buildRange(begin, mid, depth + 1, nextNode);
+            else           right = buildRange(mid, end, depth + 1, nextNode);
+        });
+    } else {
+        left = buildRange(begin, mid, depth + 1, nextNode);
+        right = buildRange(mid, end, depth + 1, nextNode);
+    }
+
+    nodes[nodeId].left = left;
+    nodes[nodeId].right = right;
+    return nodeId;
+}
+
+void Bvh::updatePrimitive(int id, const Aabb& box) {
+    primBounds[id] = box;
+    centroids[id] = (box.min + box.max) * 0.5f;
+    dirty = true;
+}
+
+void Bvh::refitNode(int nodeId, int depth) {
+    Node& node = nodes[nodeId];
+    if (node.left < 0) {
+        Aabb bounds = emptyBox();
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            grow(bounds, primBounds[primIndex[i]]);
+        }
+        node.bounds = bounds;
+        return;
+    }
+
+    if (parallel && depth < PARALLEL_DEPTH && node.count >= PARALLEL_MIN) {
+        jobSystem().parallelFor(2, 1, [&](int side, int) {
+            refitNode(side == 0 ? node.left : node.right, depth + 1);
+        });
+    } else {
+        refitNode(node.left, depth + 1);
+        refitNode(node.right, depth + 1);
+    }
+
+    Aabb bounds = nodes[node.left].bounds;
+    grow(bounds, nodes[node.right].bounds);
+    node.bounds = bounds;
+}
+
+int Bvh::collectDegraded(int nodeId, int depth, FrameVector<int>& roots, FrameVector<int>& depths) const {
+    const Node& node = nodes[nodeId];
+    if (node.left < 0) return 0;
+    if (surfaceArea(node.bounds) > node.buildArea * rebuildThreshold) {
+        roots.push_back(nodeId);
+        depths.push_back(depth);
+        return node.count;
+    }
+    return collectDegraded(node.left, depth + 1, roots, depths) +
+           collectDegraded(node.right, depth + 1, roots, depths);
+}
+
+void Bvh::releaseSubtree(int nodeId) {
+    const Node& node = nodes[nodeId];
+    if (node.left >= 0) {
+        releaseSubtree(node.left);
+        releaseSubtree(node.right);
+    }
+    ++freeNodes;
+}
+
+int Bvh::refit() {
+    if (root < 0 || !dirty) return 0;
+    dirty = false;
+    refitNode(root, 0);
+
+    FrameVector<int> degraded, depths;
+    int primitives = collectDegraded(root, 0, degraded, depths);
+    if (degraded.empty()) return 0;
+
+    // Too much of the tree is stale, or too many nodes are orphaned: start over
+    if (degraded[0] == root || primitives * 2 > primitiveCount() || freeNodes * 2 > (int)nodes.size()) {
+        build(primBounds);
+        return 1;
+    }
+
+    // Rebuild each degraded subtree into fresh nodes over the same primitive range,
+    // then move the new subtree root into the old root's slot so its parent link stays valid.
+    // The rebuild starts at the subtree's own depth, so the depth limit covers the whole tree.
+    const int oldSize = (int)nodes.size();
+    for (int d : degraded) {
+        releaseSubtree(nodes[d].left);
+        releaseSubtree(nodes[d].right);
+    }
+    nodes.resize(oldSize + 2 * primitives);
+    atomic<int> nextNode(oldSize);
+
+    FrameVector<int> newRoots(degraded.size());
+    jobSystem().parallelFor((int)degraded.size(), parallel ? 1 : (int)degraded.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            const Node& old = nodes[degraded[k]];
+            newRoots[k] = buildRange(old.first, old.first + old.count, depths[k], nextNode);
+        }
+    });
+    nodes.resize(nextNode.load());
+
+    for (size_t k = 0; k < degraded.size(); ++k) {
+        nodes[degraded[k]] = nodes[newRoots[k]];
+        ++freeNodes;
+    }
+
+    // Ancestors still hold the refit bounds, which remain valid
+    return (int)degraded.size();
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, vector<int>& out) const {
+    if (root < 0) return;
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        int c = classify(frustum, node.bounds);
+        if (c == 0) continue;
+
+        if (c == 2) {
+            // Whole subtree inside: its primitives are one contiguous range
+            out.insert(out.end(), primIndex.begin() + node.first, primIndex.begin() + node.first + node.count);
+        } else if (node.left < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                if (aabbInFrustum(frustum, primBounds[primIndex[i]])) out.push_back(primIndex[i]);
+            }
+        } else {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+void Bvh::queryBox(const Aabb& box, vector<int>& out) const {
+    if (root < 0) return;
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!overlaps(node.bounds, box)) continue;
+        if (node.left < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                if (overlaps(primBounds[primIndex[i]], box)) out.push_back(primIndex[i]);
+            }
+        } else {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+int Bvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, float* hitDistance) const {
+    if (root < 0) return -1;
+    glm::vec3 invDir;
+    for (int a = 0; a < 3; ++a) invDir[a] = 1.0f / (fabsf(dir[a]) > 1e-12f ? dir[a] : 1e-12f);
+
+    int hit = -1;
+    float best = maxDistance;
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (rayBox(node.bounds, origin, invDir, best) < 0.0f) continue;
+        if (node.left < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                float t = rayBox(primBounds[primIndex[i]], origin, invDir, best);
+                if (t >= 0.0f && t < best) {
+                    best = t;
+                    hit = primIndex[i];
+                }
+            }
+        } else {
+            // Visit the nearer child first so its hits prune the farther one
+            float tl = rayBox(nodes[node.left].bounds, origin, invDir, best);
+            float tr = rayBox(nodes[node.right].bounds, origin, invDir, best);
+            if (tl >= 0.0f && tr >= 0.0f) {
+                if (tl < tr) { stack[top++] = node.right; stack[top++] = node.left; }
+                else         { stack[top++] = node.left;  stack[top++] = node.right; }
+            } else if (tl >= 0.0f) {
+                stack[top++] = node.left;
+            } else if (tr >= 0.0f) {
+                stack[top++] = node.right;
+            }
+        }
+    }
+    if (hit >= 0 && hitDistance) *hitDistance = best;
+    return hit;
+}
+
+float Bvh::sahCost() const {
+    if (root < 0) return 0.0f;
+    const float rootArea = max(surfaceArea(nodes[root].bounds), 1e-12f);
+    float cost = 0.0f;
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        float area = surfaceArea(node.bounds) / rootArea;
+        if (node.left < 0) {
+            cost += area * node.count;
+        } else {
+            cost += area * TRAVERSAL_COST;
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+    return cost;
+}
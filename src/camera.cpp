@@ -90,6 +90,10 @@ void Camera::nextMode() {
     setMode(static_cast<CameraMode>(nextModeInt));
 }
 
+bool Camera::isAnimating() const {
+    return currentMode == CameraMode::ORBIT;
+}
+
 glm::mat4 Camera::getOrbitViewMatrix(float currentTime) const {
     glm::vec3 camPos(
         orbitRadius * sinf(orbitSpeed * currentTime),
@@ -0,0 +1,264 @@
+#include "crowd.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include "cube.h"
+#include "shader.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+// Cheap deterministic hash -> [0, 1) so layouts are reproducible between runs
+static float hash01(unsigned int x) {
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return (x & 0xFFFFFF) / 16777216.0f;
+}
+
+// Box that stays inside the torso (the rig's first link) through every pose of the clip, as
+// a transform of the unit cube in robot space. While the torso only turns about Y, each
+// sample's box is the largest axis-aligned box (same proportions) inside the turned torso,
+// and the clip's box is the intersection of those. A rig whose first link tilts or has no
+// box gets an empty occluder.
+static glm::mat4 torsoOccluder(const BakedClip& clip) {
+    Aabb inner;
+    inner.min = glm::vec3(-1e30f);
+    inner.max = glm::vec3(1e30f);
+    for (const RobotPose& pose : clip.samples) {
+        glm::mat4 parts[MAX_ROBOT_PARTS];
+        computeRobotParts(pose, glm::mat4(1.0f), parts);
+        const glm::mat4& m = parts[PART_TORSO];
+
+        glm::vec3 half(0.5f * glm::length(glm::vec3(m[0])),
+                       0.5f * glm::length(glm::vec3(m[1])),
+                       0.5f * glm::length(glm::vec3(m[2])));
+        if (half.x <= 0.0f || half.y <= 0.0f || half.z <= 0.0f || m[1][1] < 0.9999f * 2.0f * half.y) {
+            inner.min = glm::vec3(0.0f);
+            inner.max = glm::vec3(0.0f);
+            break;
+        }
+        float c = fabsf(m[0][0]) / (2.0f * half.x);
+        float s = fabsf(m[0][2]) / (2.0f * half.x);
+        float k = min(half.x / (half.x * c + half.z * s), half.z / (half.x * s + half.z * c));
+
+        glm::vec3 center(m[3]);
+        glm::vec3 h(half.x * k, half.y, half.z * k);
+        inner.min = glm::max(inner.min, center - h);
+        inner.max = glm::min(inner.max, center + h);
+    }
+    glm::mat4 box = glm::translate(glm::mat4(1.0f), (inner.min + inner.max) * 0.5f);
+    return glm::scale(box, glm::max(inner.max - inner.min, glm::vec3(0.0f)));
+}
+
+static Aabb robotBox(const Crowd& crowd, int i) {
+    glm::vec3 c(crowd.boundsCX[i], crowd.boundsCY[i], crowd.boundsCZ[i]);
+    glm::vec3 e(crowd.boundsEX[i], crowd.boundsEY[i], crowd.boundsEZ[i]);
+    Aabb box;
+    box.min = c - e;
+    box.max = c + e;
+    return box;
+}
+
+static const int MAX_OCCLUDERS = 128;   // nearest robots whose torsos are rasterized
+
+const char* crowdRenderPathName(CrowdRenderPath path) {
+    switch (path) {
+        case CrowdRenderPath::PER_PART: return "per-part";
+        case CrowdRenderPath::VAT:      return "vat";
+        case CrowdRenderPath::PALETTE:  return "palette";
+        case CrowdRenderPath::BATCHED:  return "batched";
+        default:                        return "unknown";
+    }
+}
+
+void Crowd::init(int count, float spacing, float sampleRate) {
+    clips = bakeStandardClips(sampleRate);
+    clipOccluders.clear();
+    for (const BakedClip& clip : clips) clipOccluders.push_back(torsoOccluder(clip));
+
+    robots.clear();
+    robots.reserve(count);
+    poses.assign(count, RobotPose());
+    lodLevels.assign(count, LOD_FULL);
+
+    const int columns = (int)ceilf(sqrtf((float)count));
+    for (int i = 0; i < count; ++i) {
+        int row = i / columns;
+        int col = i % columns;
+
+        CrowdRobot r;
+        r.home = glm::vec3((col - 0.5f * (columns - 1)) * spacing,
+                           0.0f,
+                           -3.0f - row * spacing);
+        r.position = r.home;
+        r.heading = 40.0f * (hash01(i * 3 + 0) - 0.5f);
+        r.clip = (int)(hash01(i * 3 + 1) * clips.size());
+        r.phase = hash01(i * 3 + 2) * clips[r.clip].period;
+        robots.push_back(r);
+    }
+
+    boundsCX.resize(count); boundsCY.resize(count); boundsCZ.resize(count);
+    boundsEX.resize(count); boundsEY.resize(count); boundsEZ.resize(count);
+    vector<Aabb> boxes(count);
+    for (int i = 0; i < count; ++i) {
+        updateBounds(i);
+        boxes[i] = robotBox(*this, i);
+    }
+    bvh.build(boxes);
+
+    size_t bytes = robots.capacity() * sizeof(CrowdRobot) + poses.capacity() * sizeof(RobotPose);
+    cout << "Crowd: " << count << " robots, " << bytes << " bytes of per-robot state" << endl;
+}
+
+void Crowd::cull(const Frustum& frustum, vector<int>& visible) const {
+    visible.clear();
+    bvh.queryFrustum(frustum, visible);
+    sort(visible.begin(), visible.end());
+}
+
+void Crowd::cull(const Frustum& frustum,
+                 const glm::vec3& camPos,
+                 float pixelsPerUnit,
+                 const LodSettings& lod,
+                 FrameVector<int> byLevel[LOD_COUNT],
+                 OcclusionBuffer* occlusion)
+{
+    cull(frustum, visibleScratch);
+    for (int l = 0; l < LOD_COUNT; ++l) byLevel[l].clear();
+
+    // Per-frame scratch comes from the frame arena
+    const int count = (int)visibleScratch.size();
+    FrameVector<float> distanceScratch(count);
+    for (int k = 0; k < count; ++k) {
+        int i = visibleScratch[k];
+        distanceScratch[k] = max(glm::length(glm::vec3(boundsCX[i], boundsCY[i], boundsCZ[i]) - camPos), 0.01f);
+    }
+
+    FrameVector<unsigned char> occludedScratch(count, 0);
+    if (occlusion && count > 0) {
+        double start = monotonicSeconds();
+
+        // The nearest robots cover the most pixels, so their torsos make the best occluders
+        FrameVector<int> orderScratch(count);
+        for (int k = 0; k < count; ++k) orderScratch[k] = k;
+        const int occluderCount = min(count, MAX_OCCLUDERS);
+        nth_element(orderScratch.begin(), orderScratch.begin() + (occluderCount - 1), orderScratch.end(),
+                    [&](int a, int b) { return distanceScratch[a] < distanceScratch[b]; });
+        for (int k = 0; k < occluderCount; ++k) {
+            int i = visibleScratch[orderScratch[k]];
+            occlusion->addOccluder(rootMatrix(i) * clipOccluders[robots[i].clip]);
+        }
+        occlusion->rasterize();
+
+        jobSystem().parallelFor(count, 256, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                occludedScratch[k] = occlusion->isOccluded(robotBox(*this, visibleScratch[k])) ? 1 : 0;
+            }
+        });
+        frameStats().add(STAT_OCCLUSION_MS, (monotonicSeconds() - start) * 1000.0);
+    }
+
+    int occluded = 0;
+    for (int k = 0; k < count; ++k) {
+        if (occludedScratch[k]) {
+            ++occluded;
+            continue;
+        }
+        int i = visibleScratch[k];
+        float distance = distanceScratch[k];
+        float pixels = 2.0f * boundsEY[i] * pixelsPerUnit / distance;
+        int level = selectLodLevel(pixels, lodLevels[i], lod);
+        lodLevels[i] = (unsigned char)level;
+        byLevel[level].push_back(i);
+    }
+    frameStats().add(STAT_ROBOTS_OCCLUDED, occluded);
+}
+
+void Crowd::wander(float time) {
+    double start = monotonicSeconds();
+    jobSystem().parallelFor(size(), 1024, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            CrowdRobot& r = robots[i];
+            float angle = 0.4f * time + hash01(i * 3 + 2) * 6.2831853f;
+            r.position = r.home + 0.6f * glm::vec3(cosf(angle), 0.0f, sinf(angle));
+            updateBounds(i);
+        }
+    });
+    for (int i = 0; i < size(); ++i) {
+        bvh.updatePrimitive(i, robotBox(*this, i));
+    }
+    bvh.refit();
+    frameStats().add(STAT_BVH_MS, (monotonicSeconds() - start) * 1000.0);
+}
+
+int Crowd::pick(const glm::vec3& origin, const glm::vec3& dir) const {
+    return bvh.raycast(origin, dir, 1000.0f, nullptr);
+}
+
+void Crowd::updateBounds(int i) {
+    Aabb box = transformAabb(clips[robots[i].clip].bounds, rootMatrix(i));
+    glm::vec3 c = (box.min + box.max) * 0.5f;
+    glm::vec3 e = (box.max - box.min) * 0.5f;
+    boundsCX[i] = c.x; boundsCY[i] = c.y; boundsCZ[i] = c.z;
+    boundsEX[i] = e.x; boundsEY[i] = e.y; boundsEZ[i] = e.z;
+}
+
+void Crowd::updatePoses(float time, const FrameVector<int>& which) {
+    double start = monotonicSeconds();
+    jobSystem().parallelFor((int)which.size(), 256, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            int i = which[k];
+            const CrowdRobot& r = robots[i];
+            sampleClip(clips[r.clip], time + r.phase, poses[i]);
+        }
+    });
+    frameStats().add(STAT_CPU_ANIM_MS, (monotonicSeconds() - start) * 1000.0);
+}
+
+glm::mat4 Crowd::rootMatrix(int i) const {
+    const CrowdRobot& r = robots[i];
+    glm::mat4 root = glm::translate(glm::mat4(1.0f), r.position);
+    return glm::rotate(root, glm::radians(r.heading), glm::vec3(0, 1, 0));
+}
+
+void drawCrowd(GLuint program,
+               GLuint cubeVAO,
+               const Crowd& crowd,
+               const FrameVector<int>& visible,
+               const Frustum& frustum,
+               const glm::mat4& view,
+               const glm::mat4& proj,
+               bool depthPass)
+{
+    glUseProgram(program);
+    setUniform(program, "view", view);
+    setUniform(program, "projection", proj);
+    const GLint modelLoc = glGetUniformLocation(program, "model");
+    const GLint colorLoc = glGetUniformLocation(program, "objectCol");
+    glBindVertexArray(cubeVAO);
+
+    int drawn = 0;
+    const int partCount = robotPartCount();
+    glm::mat4 parts[MAX_ROBOT_PARTS];
+    PartSpheres spheres;
+    unsigned char partVisible[MAX_ROBOT_PARTS];
+    for (int i : visible) {
+        computeRobotParts(crowd.poses[i], crowd.rootMatrix(i), parts);
+        computePartSpheres(parts, partCount, spheres);
+        cullSpheres(frustum, spheres.x, spheres.y, spheres.z, spheres.radius, partCount, partVisible);
+
+        for (int p = 0; p < partCount; ++p) {
+            if (!partVisible[p]) continue;
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &parts[p][0][0]);
+            glUniform3fv(colorLoc, 1, &robotPartColor(p)[0]);
+            glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+            ++drawn;
+        }
+    }
+
+    frameStats().add(STAT_DRAW_CALLS, drawn);
+    if (!depthPass) frameStats().add(STAT_PARTS_CULLED, (double)visible.size() * partCount - drawn);
+}
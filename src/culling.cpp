@@ -0,0 +1,157 @@
+#include "culling.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CULL_USE_SSE 1
+#else
+#define CULL_USE_SSE 0
+#endif
+
+Frustum extractFrustum(const glm::mat4& m) {
+    // Rows of the column-major matrix
+    glm::vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum f;
+    f.planes[0] = r3 + r0;   // left
+    f.planes[1] = r3 - r0;   // right
+    f.planes[2] = r3 + r1;   // bottom
+    f.planes[3] = r3 - r1;   // top
+    f.planes[4] = r3 + r2;   // near
+    f.planes[5] = r3 - r2;   // far
+    for (int i = 0; i < 6; ++i) {
+        glm::vec4& p = f.planes[i];
+        float len = glm::length(glm::vec3(p));
+        p = p * (1.0f / len);
+    }
+    return f;
+}
+
+Aabb transformAabb(const Aabb& local, const glm::mat4& m) {
+    // Arvo: centre moves with m, extents with |m|
+    glm::vec3 c = (local.min + local.max) * 0.5f;
+    glm::vec3 e = (local.max - local.min) * 0.5f;
+    glm::vec3 wc = glm::vec3(m * glm::vec4(c, 1.0f));
+    glm::vec3 we;
+    for (int i = 0; i < 3; ++i) {
+        we[i] = fabsf(m[0][i]) * e.x + fabsf(m[1][i]) * e.y + fabsf(m[2][i]) * e.z;
+    }
+    Aabb out;
+    out.min = wc - we;
+    out.max = wc + we;
+    return out;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        const glm::vec4& p = frustum.planes[i];
+        if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+    }
+    return true;
+}
+
+bool aabbInFrustum(const Frustum& frustum, const Aabb& box) {
+    glm::vec3 c = (box.min + box.max) * 0.5f;
+    glm::vec3 e = (box.max - box.min) * 0.5f;
+    for (int i = 0; i < 6; ++i) {
+        const glm::vec4& p = frustum.planes[i];
+        float d = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+        float r = fabsf(p.x) * e.x + fabsf(p.y) * e.y + fabsf(p.z) * e.z;
+        if (d + r < 0.0f) return false;
+    }
+    return true;
+}
+
+int cullSpheres(const Frustum& frustum,
+                const float* x, const float* y, const float* z, const float* radius,
+                int count, unsigned char* visible)
+{
+    int visibleCount = 0;
+    int i = 0;
+#if CULL_USE_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const glm::vec4& pl = frustum.planes[p];
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(pl.x)),
+                                             _mm_mul_ps(py, _mm_set1_ps(pl.y))),
+                                  _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(pl.z)), _mm_set1_ps(pl.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        visible[i] = sphereInFrustum(frustum, glm::vec3(x[i], y[i], z[i]), radius[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+int cullBoxes(const Frustum& frustum,
+              const float* cx, const float* cy, const float* cz,
+              const float* ex, const float* ey, const float* ez,
+              int count, unsigned char* visible)
+{
+    int visibleCount = 0;
+    int i = 0;
+#if CULL_USE_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(cx + i);
+        __m128 py = _mm_loadu_ps(cy + i);
+        __m128 pz = _mm_loadu_ps(cz + i);
+        __m128 hx = _mm_loadu_ps(ex + i);
+        __m128 hy = _mm_loadu_ps(ey + i);
+        __m128 hz = _mm_loadu_ps(ez + i);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const glm::vec4& pl = frustum.planes[p];
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(pl.x)),
+                                             _mm_mul_ps(py, _mm_set1_ps(pl.y))),
+                                  _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(pl.z)), _mm_set1_ps(pl.w)));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, _mm_set1_ps(fabsf(pl.x))),
+                                             _mm_mul_ps(hy, _mm_set1_ps(fabsf(pl.y)))),
+                                  _mm_mul_ps(hz, _mm_set1_ps(fabsf(pl.z))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        Aabb box;
+        box.min = glm::vec3(cx[i] - ex[i], cy[i] - ey[i], cz[i] - ez[i]);
+        box.max = glm::vec3(cx[i] + ex[i], cy[i] + ey[i], cz[i] + ez[i]);
+        visible[i] = aabbInFrustum(frustum, box) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+
+void computePartSpheres(const glm::mat4* parts, int count, PartSpheres& out) {
+    for (int p = 0; p < count; ++p) {
+        const glm::mat4& m = parts[p];
+        // Half diagonal of the transformed unit cube
+        float d2 = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]))
+                 + glm::dot(glm::vec3(m[1]), glm::vec3(m[1]))
+                 + glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+        out.x[p] = m[3][0];
+        out.y[p] = m[3][1];
+        out.z[p] = m[3][2];
+        out.radius[p] = 0.5f * sqrtf(d2);
+    }
+}
@@ -0,0 +1,167 @@
+#include "dynamic_resolution.h"
+#include "shader.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+static const float DEAD_BAND_LOW = 0.85f;   // no change while budget * [0.85, 1.0] contains the time
+static const float MAX_STEP = 0.05f;        // largest scale change per adjustment
+static const float SCALE_QUANTUM = 1.0f / 64.0f;
+static const float SMOOTHING = 0.2f;        // weight of a new measurement in the moving average
+
+DynamicResolution::DynamicResolution()
+    : budget(0.0f), minimumScale(0.25f), currentScale(1.0f), smoothedMs(0.0f),
+      settleFrames(0), measured(0), fbo(0), colorTexture(0), depthBuffer(0),
+      targetWidth(0), targetHeight(0), windowWidth(0), windowHeight(0),
+      sceneWidth(0), sceneHeight(0), program(0), emptyVAO(0), queryIndex(0)
+{
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries[i] = 0;
+        queryPending[i] = false;
+    }
+}
+
+bool DynamicResolution::init(float budgetMs, float minScale) {
+    budget = budgetMs;
+    minimumScale = min(1.0f, max(0.1f, minScale));
+    currentScale = 1.0f;
+
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &colorTexture);
+    glGenRenderbuffers(1, &depthBuffer);
+    glGenQueries(QUERY_COUNT, queries);
+    glGenVertexArrays(1, &emptyVAO);   // the upscale triangle is generated from gl_VertexID
+
+    program = loadShaderProgram("shaders/upscale_vertex_shader.glsl", "shaders/upscale_fragment_shader.glsl");
+    glUseProgram(program);
+    setUniform(program, "sceneColor", 0);
+
+    cout << "Dynamic resolution: " << budget << " ms GPU budget, scale " << minimumScale << " .. 1" << endl;
+    return program != 0;
+}
+
+void DynamicResolution::resizeTargets(int width, int height) {
+    targetWidth = width;
+    targetHeight = height;
+
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "Error: dynamic resolution framebuffer incomplete" << endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::beginScene(int width, int height) {
+    windowWidth = max(1, width);
+    windowHeight = max(1, height);
+
+    // The target is allocated at window size once; lower scales render into a corner of it
+    if (windowWidth != targetWidth || windowHeight != targetHeight) {
+        resizeTargets(windowWidth, windowHeight);
+    }
+    sceneWidth = max(1, (int)(windowWidth * currentScale + 0.5f));
+    sceneHeight = max(1, (int)(windowHeight * currentScale + 0.5f));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, sceneWidth, sceneHeight);
+
+    readQueries();
+    if (!queryPending[queryIndex]) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+    }
+}
+
+void DynamicResolution::endScene() {
+    if (!queryPending[queryIndex]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryPending[queryIndex] = true;
+        queryIndex = (queryIndex + 1) % QUERY_COUNT;
+    }
+
+    // Bilinear upscale of the rendered corner to the whole window
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(program);
+    setUniform(program, "uvScale", glm::vec2(
+                (float)sceneWidth / targetWidth, (float)sceneHeight / targetHeight));
+    setUniform(program, "uvMax", glm::vec2(
+                (sceneWidth - 0.5f) / targetWidth, (sceneHeight - 0.5f) / targetHeight));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void DynamicResolution::readQueries() {
+    // Oldest first, so measurements arrive in frame order
+    for (int k = 0; k < QUERY_COUNT; ++k) {
+        int i = (queryIndex + k) % QUERY_COUNT;
+        if (!queryPending[i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+        queryPending[i] = false;
+        updateScale((float)(ns / 1.0e6));
+    }
+}
+
+void DynamicResolution::updateScale(float ms) {
+    // Results still in flight when the scale changed describe the old resolution
+    if (settleFrames > 0) {
+        --settleFrames;
+        return;
+    }
+    smoothedMs = measured == 0 ? ms : smoothedMs + SMOOTHING * (ms - smoothedMs);
+    ++measured;
+    if (measured < 4) return;
+
+    if (smoothedMs <= budget && smoothedMs >= budget * DEAD_BAND_LOW) return;
+    if (smoothedMs < budget * DEAD_BAND_LOW && currentScale >= 1.0f) return;
+    if (smoothedMs > budget && currentScale <= minimumScale) return;
+
+    // Fill-rate bound: time follows the pixel count, i.e. scale squared.
+    // Aim for the middle of the dead band and take limited steps.
+    float ideal = currentScale * sqrtf(budget * (1.0f + DEAD_BAND_LOW) * 0.5f / max(smoothedMs, 0.01f));
+    float next = currentScale + max(-MAX_STEP, min(MAX_STEP, ideal - currentScale));
+    next = roundf(next / SCALE_QUANTUM) * SCALE_QUANTUM;
+    next = min(1.0f, max(minimumScale, next));
+    if (next == currentScale) return;
+
+    currentScale = next;
+    settleFrames = QUERY_COUNT;
+    measured = 0;
+}
+
+void DynamicResolution::destroy() {
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteQueries(QUERY_COUNT, queries);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    program = emptyVAO = fbo = colorTexture = depthBuffer = 0;
+    targetWidth = targetHeight = 0;
+}
@@ -0,0 +1,90 @@
+#include "embedded_assets.h"
+#include "asset_archive.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef EMBED_ASSETS
+// Generated at build time by tools/embed_files
+#include "embedded_assets_data.h"
+#else
+static const EmbeddedAsset EMBEDDED_ASSET_TABLE[] = {{"", "", 0}};
+static const int EMBEDDED_ASSET_COUNT = 0;
+#endif
+
+using namespace std;
+
+// Debug builds may point the override at the source tree, so edits apply without rebuilding
+#ifdef ASSET_SOURCE_DIR
+static string gOverrideDirectory = ASSET_SOURCE_DIR;
+#else
+static string gOverrideDirectory;
+#endif
+
+static atomic<int> gFileReads(0);
+static AssetArchive gArchive;
+
+void setAssetOverrideDirectory(const string& directory) {
+    gOverrideDirectory = directory;
+    while (gOverrideDirectory.size() > 1 && gOverrideDirectory[gOverrideDirectory.size() - 1] == '/') {
+        gOverrideDirectory.erase(gOverrideDirectory.size() - 1);
+    }
+}
+
+const string& assetOverrideDirectory() {
+    return gOverrideDirectory;
+}
+
+string assetDiskPath(const string& path) {
+    return gOverrideDirectory.empty() ? path : gOverrideDirectory + "/" + path;
+}
+
+bool mountAssetArchive(const string& file) {
+    if (!gArchive.open(file)) return false;
+    ++gFileReads;
+    return true;
+}
+
+bool findEmbeddedAsset(const string& path, const char*& data, size_t& size) {
+    for (int i = 0; i < EMBEDDED_ASSET_COUNT; ++i) {
+        if (strcmp(EMBEDDED_ASSET_TABLE[i].path, path.c_str()) == 0) {
+            data = EMBEDDED_ASSET_TABLE[i].data;
+            size = EMBEDDED_ASSET_TABLE[i].size;
+            return true;
+        }
+    }
+    return false;
+}
+
+int embeddedAssetCount() {
+    return EMBEDDED_ASSET_COUNT;
+}
+
+static bool mapDiskFile(const string& path, MappedFile& bytes) {
+    if (!bytes.open(path)) return false;
+    ++gFileReads;
+    return true;
+}
+
+bool mapAsset(const string& path, MappedFile& bytes) {
+    // An override file wins; one missing there falls back to the archive, then the embedded copy
+    if (!gOverrideDirectory.empty() && mapDiskFile(gOverrideDirectory + "/" + path, bytes)) return true;
+
+    const char* data = NULL;
+    size_t size = 0;
+    if ((gArchive.isOpen() && gArchive.find(path, data, size)) || findEmbeddedAsset(path, data, size)) {
+        bytes.wrap(data, size);
+        return true;
+    }
+    return mapDiskFile(path, bytes);
+}
+
+bool loadAsset(const string& path, string& contents) {
+    MappedFile bytes;
+    if (!mapAsset(path, bytes)) return false;
+    contents.assign(bytes.data(), bytes.size());
+    return true;
+}
+
+int assetFileReads() {
+    return gFileReads;
+}
@@ -0,0 +1,65 @@
+#include "fragment_counter.h"
+#include "frame_stats.h"
+#include "gl_caps.h"
+#include <iostream>
+
+using namespace std;
+
+FragmentCounter::FragmentCounter()
+    : target(GL_SAMPLES_PASSED), current(0), active(false), last(0.0)
+{
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+}
+
+bool FragmentCounter::init() {
+    target = glCaps().pipelineStatistics ? GL_FRAGMENT_SHADER_INVOCATIONS : GL_SAMPLES_PASSED;
+    glGenQueries(QUERY_COUNT, queries);
+    cout << "Fragment counter: "
+         << (countsInvocations() ? "fragment shader invocations" : "samples passed (no pipeline statistics)")
+         << endl;
+    return true;
+}
+
+void FragmentCounter::begin() {
+    if (queries[0] == 0) return;
+    readQueries();
+    // Every query still in flight: skip this frame rather than wait
+    active = !pending[current];
+    if (active) glBeginQuery(target, queries[current]);
+}
+
+void FragmentCounter::end() {
+    if (!active) return;
+    glEndQuery(target);
+    pending[current] = true;
+    current = (current + 1) % QUERY_COUNT;
+    active = false;
+}
+
+void FragmentCounter::readQueries() {
+    for (int k = 0; k < QUERY_COUNT; ++k) {
+        int i = (current + k) % QUERY_COUNT;
+        if (!pending[i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 count = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &count);
+        pending[i] = false;
+        last = (double)count;
+        frameStats().add(STAT_FRAGMENTS_K, last / 1000.0);
+    }
+}
+
+void FragmentCounter::destroy() {
+    if (queries[0] != 0) glDeleteQueries(QUERY_COUNT, queries);
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+}
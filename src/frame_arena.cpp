@@ -0,0 +1,106 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t initialBytes)
+    : current(0), offset(0), usedBytes(0), initialBytes(initialBytes) {}
+
+FrameArena::~FrameArena() {
+    for (const Block& block : blocks) free(block.data);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    for (;;) {
+        if (current < blocks.size()) {
+            const Block& block = blocks[current];
+            uintptr_t base = (uintptr_t)block.data;
+            size_t aligned = (size_t)(((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+            if (aligned + bytes <= block.size) {
+                offset = aligned + bytes;
+                usedBytes += bytes;
+                return block.data + aligned;
+            }
+            // Blocks left over from the last reset are reused before new ones are made
+            if (current + 1 < blocks.size()) {
+                ++current;
+                offset = 0;
+                continue;
+            }
+        }
+
+        // Out of space: a new block at least twice the last one
+        size_t size = max(initialBytes, bytes + alignment);
+        if (!blocks.empty()) size = max(size, blocks.back().size * 2);
+        Block block;
+        block.data = (char*)malloc(size);
+        if (!block.data) abort();
+        block.size = size;
+        blocks.push_back(block);
+        current = blocks.size() - 1;
+        offset = 0;
+    }
+}
+
+void FrameArena::reset() {
+    // A frame that spilled into several blocks gets one block holding all of them next time
+    if (blocks.size() > 1) {
+        size_t total = capacity();
+        for (const Block& block : blocks) free(block.data);
+        blocks.clear();
+        Block block;
+        block.data = (char*)malloc(total);
+        if (!block.data) abort();
+        block.size = total;
+        blocks.push_back(block);
+    }
+    current = 0;
+    offset = 0;
+    usedBytes = 0;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
+
+// Every thread's arena, so the frame loop can reset them all
+static std::mutex gArenasMutex;
+static vector<FrameArena*> gArenas;
+
+namespace {
+struct ThreadArena {
+    FrameArena arena;
+
+    ThreadArena() {
+        lock_guard<std::mutex> lock(gArenasMutex);
+        gArenas.push_back(&arena);
+    }
+    ~ThreadArena() {
+        lock_guard<std::mutex> lock(gArenasMutex);
+        gArenas.erase(find(gArenas.begin(), gArenas.end(), &arena));
+    }
+};
+}
+
+FrameArena& frameArena() {
+    static thread_local ThreadArena threadArena;
+    return threadArena.arena;
+}
+
+void resetFrameArenas() {
+    lock_guard<std::mutex> lock(gArenasMutex);
+    for (FrameArena* arena : gArenas) arena->reset();
+}
+
+size_t frameArenaBytesUsed() {
+    lock_guard<std::mutex> lock(gArenasMutex);
+    size_t total = 0;
+    for (FrameArena* arena : gArenas) total += arena->used();
+    return total;
+}
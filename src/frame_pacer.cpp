@@ -0,0 +1,123 @@
+#include "frame_pacer.h"
+#include "frame_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+static const double SPIN_SECONDS = 0.002;   // sleep until this close to the deadline, then spin
+static const size_t HISTORY_FRAMES = 240;
+
+FramePacer::FramePacer()
+    : window(NULL), interval(1), swapTear(false), targetFrameTime(0.0),
+      deadline(-1.0), lastSwap(-1.0), reportInterval(0.0), windowStart(-1.0),
+      samples(0), mean(0.0), m2(0.0), minMs(1e9), maxMs(0.0), missed(0),
+      sleptMs(0.0), spunMs(0.0), lastReportFps(0.0)
+{
+}
+
+void FramePacer::init(GLFWwindow* win, int swapInterval, double fps) {
+    window = win;
+    swapTear = glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+               glfwExtensionSupported("WGL_EXT_swap_control_tear");
+    setSwapInterval(swapInterval);
+    setTargetFps(fps);
+}
+
+void FramePacer::setSwapInterval(int newInterval) {
+    if (newInterval < 0 && !swapTear) {
+        printf("Swap tear not supported, using swap interval 1 instead of %d\n", newInterval);
+        newInterval = 1;
+    }
+    interval = newInterval;
+    glfwSwapInterval(interval);
+    resync();
+}
+
+void FramePacer::setTargetFps(double fps) {
+    targetFrameTime = fps > 0.0 ? 1.0 / fps : 0.0;
+    resync();
+}
+
+void FramePacer::resync() {
+    deadline = -1.0;
+    lastSwap = -1.0;
+}
+
+void FramePacer::waitForDeadline() {
+    if (targetFrameTime <= 0.0) return;
+
+    double now = monotonicSeconds();
+    if (deadline < 0.0) {
+        deadline = now + targetFrameTime;
+        return;
+    }
+
+    // Sleep while the deadline is far away; the OS wakes us up late by up to a millisecond or so
+    double remaining = deadline - now;
+    if (remaining > SPIN_SECONDS) {
+        this_thread::sleep_for(chrono::duration<double>(remaining - SPIN_SECONDS));
+        double woke = monotonicSeconds();
+        sleptMs += (woke - now) * 1000.0;
+        now = woke;
+    }
+
+    // Spin for the rest
+    double spinStart = now;
+    while (now < deadline) {
+        this_thread::yield();
+        now = monotonicSeconds();
+    }
+    spunMs += (now - spinStart) * 1000.0;
+
+    // Advance by whole periods so an occasional late frame does not shift every later one;
+    // after a long stall start over instead of rushing to catch up
+    deadline += targetFrameTime;
+    if (now - deadline > targetFrameTime) deadline = now + targetFrameTime;
+}
+
+void FramePacer::frameSwapped() {
+    double now = monotonicSeconds();
+    if (lastSwap >= 0.0) {
+        double ms = (now - lastSwap) * 1000.0;
+
+        ++samples;
+        double delta = ms - mean;
+        mean += delta / samples;
+        m2 += delta * (ms - mean);
+        minMs = min(minMs, ms);
+        maxMs = max(maxMs, ms);
+        if (targetFrameTime > 0.0 && ms > 1500.0 * targetFrameTime) ++missed;
+
+        if (recent.size() == HISTORY_FRAMES) recent.erase(recent.begin());
+        recent.push_back((float)ms);
+    }
+    lastSwap = now;
+    report(now);
+}
+
+void FramePacer::report(double now) {
+    if (windowStart < 0.0) windowStart = now;
+    if (now - windowStart < (reportInterval > 0.0 ? reportInterval : 1.0)) return;
+
+    lastReportFps = samples > 0 && mean > 0.0 ? 1000.0 / mean : 0.0;
+    if (reportInterval > 0.0 && samples > 1) {
+        double stddev = sqrt(m2 / (samples - 1));
+        printf("[pacing] interval %d, target %.2f ms: mean %.2f ms, stddev %.3f ms, min %.2f, max %.2f, "
+               "missed %d, sleep %.2f ms, spin %.2f ms per frame\n",
+               interval, targetFrameTime * 1000.0, mean, stddev, minMs, maxMs,
+               missed, sleptMs / samples, spunMs / samples);
+        fflush(stdout);
+    }
+
+    windowStart = now;
+    samples = 0;
+    mean = m2 = 0.0;
+    minMs = 1e9;
+    maxMs = 0.0;
+    missed = 0;
+    sleptMs = spunMs = 0.0;
+}
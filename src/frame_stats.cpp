@@ -0,0 +1,126 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+double monotonicSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+const char* statCounterName(StatCounter counter) {
+    switch (counter) {
+        case STAT_DRAW_CALLS:      return "draw calls";
+        case STAT_ROBOTS_DRAWN:    return "robots";
+        case STAT_ROBOTS_CULLED:   return "robots culled";
+        case STAT_PARTS_CULLED:    return "parts culled";
+        case STAT_CPU_ANIM_MS:     return "cpu anim ms";
+        case STAT_STREAM_KB:       return "stream KB";
+        case STAT_STREAM_STALLS:   return "stream stalls";
+        case STAT_STREAM_STALL_MS: return "stream stall ms";
+        case STAT_BVH_MS:          return "bvh ms";
+        case STAT_LOD_FULL:        return "lod full";
+        case STAT_LOD_PROXY:       return "lod proxy";
+        case STAT_LOD_IMPOSTOR:    return "lod impostor";
+        case STAT_ROBOTS_OCCLUDED: return "robots occluded";
+        case STAT_OCCLUSION_MS:    return "occlusion ms";
+        case STAT_RES_SCALE:       return "res scale %";
+        case STAT_SCENE_GPU_MS:    return "scene gpu ms";
+        case STAT_FRAGMENTS_K:     return "fragments K";
+        case STAT_ASSET_UPLOAD_MS: return "asset upload ms";
+        case STAT_HEAP_ALLOCS:     return "heap allocs";
+        case STAT_ARENA_KB:        return "frame arena KB";
+        default:                   return "?";
+    }
+}
+
+FrameStats::FrameStats()
+    : reportInterval(0.0), label(""), frameStart(0.0), windowStart(-1.0)
+{
+    resetTotals();
+    windowFrames = 0;
+    windowFrameMs = 0.0;
+    windowMinMs = 1e9;
+    windowMaxMs = 0.0;
+    fill(windowCounters, windowCounters + STAT_COUNT, 0.0);
+    fill(frameCounters, frameCounters + STAT_COUNT, 0.0);
+}
+
+void FrameStats::setReportInterval(double seconds) {
+    reportInterval = seconds;
+}
+
+void FrameStats::setLabel(const char* newLabel) {
+    label = newLabel;
+}
+
+void FrameStats::beginFrame(double now) {
+    frameStart = now;
+    if (windowStart < 0.0) windowStart = now;
+    fill(frameCounters, frameCounters + STAT_COUNT, 0.0);
+}
+
+void FrameStats::add(StatCounter counter, double value) {
+    frameCounters[counter] += value;
+}
+
+void FrameStats::endFrame(double now) {
+    double ms = (now - frameStart) * 1000.0;
+
+    ++windowFrames;
+    windowFrameMs += ms;
+    windowMinMs = min(windowMinMs, ms);
+    windowMaxMs = max(windowMaxMs, ms);
+
+    ++totalFrameCount;
+    totalFrameMs += ms;
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        windowCounters[i] += frameCounters[i];
+        totalCounters[i] += frameCounters[i];
+    }
+
+    if (reportInterval > 0.0 && now - windowStart >= reportInterval) {
+        report();
+        windowStart = now;
+        windowFrames = 0;
+        windowFrameMs = 0.0;
+        windowMinMs = 1e9;
+        windowMaxMs = 0.0;
+        fill(windowCounters, windowCounters + STAT_COUNT, 0.0);
+    }
+}
+
+void FrameStats::report() {
+    if (windowFrames == 0) return;
+    double avg = windowFrameMs / windowFrames;
+    printf("[stats%s%s] %.1f fps, %.2f ms (min %.2f, max %.2f)",
+           label[0] ? " " : "", label, 1000.0 / avg, avg, windowMinMs, windowMaxMs);
+    for (int i = 0; i < STAT_COUNT; ++i) {
+        if (windowCounters[i] != 0.0) {
+            printf(", %s %.2f", statCounterName((StatCounter)i), windowCounters[i] / windowFrames);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+double FrameStats::totalAverageMs() const {
+    return totalFrameCount ? totalFrameMs / totalFrameCount : 0.0;
+}
+
+double FrameStats::totalAverage(StatCounter counter) const {
+    return totalFrameCount ? totalCounters[counter] / totalFrameCount : 0.0;
+}
+
+void FrameStats::resetTotals() {
+    totalFrameCount = 0;
+    totalFrameMs = 0.0;
+    fill(totalCounters, totalCounters + STAT_COUNT, 0.0);
+}
+
+FrameStats& frameStats() {
+    static FrameStats instance;
+    return instance;
+}
@@ -0,0 +1,65 @@
+#include "gl_caps.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static GLCaps gCaps;
+
+bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0) return true;
+    }
+    return false;
+}
+
+void initGLCaps(GLADloadproc getProc) {
+    glGetIntegerv(GL_MAJOR_VERSION, &gCaps.major);
+    glGetIntegerv(GL_MINOR_VERSION, &gCaps.minor);
+
+    // ARB extensions share the core entry point names, but glad only loads them for the core version
+    if (GLAD_GL_VERSION_4_4) {
+        gCaps.bufferStorage = true;
+    } else if (hasGLExtension("GL_ARB_buffer_storage")) {
+        glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)getProc("glBufferStorage");
+        gCaps.bufferStorage = glad_glBufferStorage != NULL;
+    }
+
+    if (GLAD_GL_VERSION_4_1) {
+        gCaps.programBinary = true;
+    } else if (hasGLExtension("GL_ARB_get_program_binary")) {
+        glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)getProc("glGetProgramBinary");
+        glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)getProc("glProgramBinary");
+        glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)getProc("glProgramParameteri");
+        gCaps.programBinary = glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri;
+    }
+
+    // Compiles and links run on driver threads; enable as many as the driver likes
+    typedef void (APIENTRYP MaxCompilerThreadsProc)(GLuint count);
+    MaxCompilerThreadsProc maxCompilerThreads = NULL;
+    if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        maxCompilerThreads = (MaxCompilerThreadsProc)getProc("glMaxShaderCompilerThreadsKHR");
+    } else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+        maxCompilerThreads = (MaxCompilerThreadsProc)getProc("glMaxShaderCompilerThreadsARB");
+    }
+    if (maxCompilerThreads) {
+        maxCompilerThreads(0xFFFFFFFFu);
+        gCaps.parallelShaderCompile = true;
+    }
+
+    // Only new query targets; glBeginQuery and friends are core
+    gCaps.pipelineStatistics = GLAD_GL_VERSION_4_6 || hasGLExtension("GL_ARB_pipeline_statistics_query");
+
+    cout << "GL caps: " << gCaps.major << "." << gCaps.minor
+         << ", buffer storage " << (gCaps.bufferStorage ? "yes" : "no")
+         << ", pipeline statistics " << (gCaps.pipelineStatistics ? "yes" : "no")
+         << ", program binary " << (gCaps.programBinary ? "yes" : "no")
+         << ", parallel compile " << (gCaps.parallelShaderCompile ? "yes" : "no") << endl;
+}
+
+const GLCaps& glCaps() {
+    return gCaps;
+}
@@ -0,0 +1,153 @@
+#include "job_system.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+JobSystem::JobSystem(int workerCount) : backgroundRunning(0), stopping(false) {
+    if (workerCount <= 0) {
+        int hw = (int)thread::hardware_concurrency();
+        workerCount = max(1, hw - 1);
+    }
+    parallelTasks.tasks.resize(64);
+    background.tasks.resize(64);
+    maxBackground = max(1, workerCount - 1);
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& t : workers) t.join();
+}
+
+void JobSystem::TaskQueue::push(function<void()>&& task) {
+    if (count == tasks.size()) {
+        // Full: unroll into a buffer twice the size
+        vector<function<void()>> grown(tasks.size() * 2);
+        for (size_t i = 0; i < count; ++i) grown[i] = std::move(tasks[(head + i) % tasks.size()]);
+        tasks.swap(grown);
+        head = 0;
+    }
+    tasks[(head + count) % tasks.size()] = std::move(task);
+    ++count;
+}
+
+bool JobSystem::TaskQueue::pop(function<void()>& task) {
+    if (count == 0) return false;
+    task = std::move(tasks[head]);
+    tasks[head] = nullptr;
+    head = (head + 1) % tasks.size();
+    --count;
+    return true;
+}
+
+void JobSystem::push(TaskQueue& queue, function<void()>&& task) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queue.push(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void JobSystem::submit(function<void()> task) {
+    push(background, std::move(task));
+}
+
+void JobSystem::workerLoop() {
+    for (;;) {
+        function<void()> task;
+        bool isBackground = false;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] {
+                return stopping || parallelTasks.count > 0
+                    || (background.count > 0 && backgroundRunning < maxBackground);
+            });
+            if (!parallelTasks.pop(task)) {
+                // Only reached under the limit, or when stopping (the queue is drained first)
+                if (!background.pop(task)) return;
+                isBackground = true;
+                ++backgroundRunning;
+            }
+        }
+        task();
+        if (isBackground) {
+            {
+                lock_guard<std::mutex> lock(mutex);
+                --backgroundRunning;
+            }
+            // A queued background task may have been waiting for this slot
+            wake.notify_one();
+        }
+    }
+}
+
+bool JobSystem::runParallelTask() {
+    function<void()> task;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!parallelTasks.pop(task)) return false;
+    }
+    task();
+    return true;
+}
+
+void JobSystem::parallelFor(int count, int grain, RangeFn fn, const void* context) {
+    if (count <= 0) return;
+    grain = max(1, grain);
+    const int chunks = (count + grain - 1) / grain;
+    if (chunks == 1 || workers.empty()) {
+        fn(context, 0, count);
+        return;
+    }
+
+    // Chunks are claimed from a shared counter, so helpers that start late simply find no work
+    struct Shared {
+        atomic<int> next{0};
+        atomic<int> done{0};
+        std::mutex mutex;
+        condition_variable finished;
+    } shared;
+
+    auto drain = [&]() {
+        int finishedHere = 0;
+        for (;;) {
+            int c = shared.next.fetch_add(1);
+            if (c >= chunks) break;
+            int begin = c * grain;
+            fn(context, begin, min(count, begin + grain));
+            ++finishedHere;
+        }
+        if (finishedHere > 0 && shared.done.fetch_add(finishedHere) + finishedHere == chunks) {
+            lock_guard<std::mutex> lock(shared.mutex);
+            shared.finished.notify_all();
+        }
+    };
+
+    const int helpers = min((int)workers.size(), chunks - 1);
+    atomic<int> helpersLeft(helpers);
+    for (int i = 0; i < helpers; ++i) {
+        push(parallelTasks, [&]() { drain(); helpersLeft.fetch_sub(1); });
+    }
+    drain();
+
+    {
+        unique_lock<std::mutex> lock(shared.mutex);
+        shared.finished.wait(lock, [&] { return shared.done.load() == chunks; });
+    }
+    // The helpers reference this stack frame; do not return before all of them have run
+    while (helpersLeft.load() > 0) {
+        if (!runParallelTask()) this_thread::yield();
+    }
+}
+
+JobSystem& jobSystem() {
+    static JobSystem instance;
+    return instance;
+}
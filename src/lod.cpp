@@ -0,0 +1,295 @@
+#include "lod.h"
+#include "crowd.h"
+#include "culling.h"
+#include "cube.h"
+#include "robot.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+static const int IMPOSTOR_HEIGHT = 128;   // texels; the width follows the robot's aspect
+
+// Per-robot record shared by both levels, read through the placement attribute
+struct LodInstance {
+    float placement[4];   // position xyz, heading (radians)
+};
+
+const char* lodLevelName(int level) {
+    switch (level) {
+        case LOD_FULL:     return "full";
+        case LOD_PROXY:    return "proxy";
+        case LOD_IMPOSTOR: return "impostor";
+        default:           return "unknown";
+    }
+}
+
+int selectLodLevel(float pixels, int previous, const LodSettings& settings) {
+    if (!settings.enabled) return LOD_FULL;
+
+    // Each boundary moves away from the side the robot is on, so small changes in
+    // distance around a threshold do not flip the level back and forth
+    const float thresholds[LOD_COUNT - 1] = { settings.proxyPixels, settings.impostorPixels };
+    int level = 0;
+    for (int b = 0; b < LOD_COUNT - 1; ++b) {
+        float t = thresholds[b] * (previous <= b ? 1.0f - settings.hysteresis : 1.0f + settings.hysteresis);
+        if (pixels < t) level = b + 1;
+    }
+    return level;
+}
+
+LodCrowdRenderer::LodCrowdRenderer()
+    : proxyProgram(0), proxyDepthProgram(0), impostorProgram(0), proxyVAO(0), impostorVAO(0),
+      cubeVBO(0), quadVBO(0), impostorTexture(0), proxyCount(0), impostorCount(0),
+      restCenter(0.0f), restSize(1.0f), proxyColor(1.0f)
+{
+}
+
+bool LodCrowdRenderer::init(GLuint robotProgram, GLuint cubeVAO, const StreamBuffer& stream) {
+    // Rest-pose bounds and the average part color for the proxy box
+    const int partCount = robotPartCount();
+    glm::mat4 parts[MAX_ROBOT_PARTS];
+    computeRobotParts(RobotPose(), glm::mat4(1.0f), parts);
+    Aabb unit;
+    unit.min = glm::vec3(-0.5f);
+    unit.max = glm::vec3(0.5f);
+    Aabb rest = transformAabb(unit, parts[0]);
+    proxyColor = glm::vec3(0.0f);
+    for (int p = 0; p < partCount; ++p) {
+        Aabb box = transformAabb(unit, parts[p]);
+        rest.min = glm::min(rest.min, box.min);
+        rest.max = glm::max(rest.max, box.max);
+        proxyColor += robotPartColor(p) / (float)partCount;
+    }
+    restCenter = (rest.min + rest.max) * 0.5f;
+    restSize = rest.max - rest.min;
+
+    // Proxy: the unit cube, one instance per robot
+    glGenVertexArrays(1, &proxyVAO);
+    glGenBuffers(1, &cubeVBO);
+    glBindVertexArray(proxyVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, CUBE_VERTEX_COUNT * CUBE_VERTEX_FLOATS * sizeof(float),
+                 getCubeVertices(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(LodInstance), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+
+    // Impostor: a two-triangle quad, one instance per robot
+    const float quad[] = {
+        -0.5f, 0.0f,   0.5f, 0.0f,   0.5f, 1.0f,
+         0.5f, 1.0f,  -0.5f, 1.0f,  -0.5f, 0.0f
+    };
+    glGenVertexArrays(1, &impostorVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(impostorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LodInstance), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    updatePrograms();
+    const GLuint proxyPrograms[2] = {proxyProgram, proxyDepthProgram};
+    for (GLuint p : proxyPrograms) {
+        glUseProgram(p);
+        setUniform(p, "boxCenter", restCenter);
+        setUniform(p, "boxSize", restSize);
+        setUniform(p, "boxColor", proxyColor);
+    }
+
+    impostorProgram = loadShaderProgram("shaders/impostor_vertex_shader.glsl", "shaders/impostor_fragment_shader.glsl");
+    glUseProgram(impostorProgram);
+    setUniform(impostorProgram, "impostor", 0);
+    setUniform(impostorProgram, "quadSize", glm::vec2(restSize.x, restSize.y));
+    setUniform(impostorProgram, "quadBase", rest.min.y);
+
+    return bakeImpostor(robotProgram, cubeVAO);
+}
+
+bool LodCrowdRenderer::bakeImpostor(GLuint robotProgram, GLuint cubeVAO) {
+    const int height = IMPOSTOR_HEIGHT;
+    const int width = max(8, (int)ceilf(height * restSize.x / restSize.y));
+
+    glGenTextures(1, &impostorTexture);
+    glBindTexture(GL_TEXTURE_2D, impostorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLuint fbo = 0, depth = 0;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, impostorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (ok) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Front view, orthographic, framing the rest-pose bounds exactly
+        glm::vec3 eye = restCenter + glm::vec3(0.0f, 0.0f, restSize.z + 5.0f);
+        glm::mat4 view = glm::lookAt(eye, restCenter, glm::vec3(0, 1, 0));
+        glm::mat4 proj = glm::ortho(-0.5f * restSize.x, 0.5f * restSize.x,
+                                    -0.5f * restSize.y, 0.5f * restSize.y,
+                                    0.1f, 2.0f * restSize.z + 10.0f);
+
+        glUseProgram(robotProgram);
+        setUniform(robotProgram, "camPos", eye);
+        setUniform(robotProgram, "lightPos", eye + glm::vec3(2.0f, 4.0f, 0.0f));
+        setUniform(robotProgram, "lightCol", glm::vec3(1.0f));
+        drawRobotPose(robotProgram, cubeVAO, RobotPose(), glm::mat4(1.0f), view, proj);
+
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    } else {
+        cerr << "Error: impostor framebuffer incomplete, far robots will use the proxy box" << endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &depth);
+    glDeleteFramebuffers(1, &fbo);
+
+    glBindTexture(GL_TEXTURE_2D, impostorTexture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    cout << "LOD: proxy box " << restSize.x << " x " << restSize.y << " x " << restSize.z
+         << ", impostor " << width << " x " << height << endl;
+    return ok;
+}
+
+void LodCrowdRenderer::update(const Crowd& crowd,
+                              const FrameVector<int>& proxies,
+                              const FrameVector<int>& impostors,
+                              StreamBuffer& stream)
+{
+    proxyCount = impostorCount = 0;
+    const size_t total = proxies.size() + impostors.size();
+    if (total == 0) return;
+
+    StreamAllocation alloc = stream.allocate((GLsizeiptr)(total * sizeof(LodInstance)), sizeof(LodInstance));
+    if (!alloc.ptr) return;
+
+    LodInstance* records = (LodInstance*)alloc.ptr;
+    size_t k = 0;
+    for (const FrameVector<int>* list : { &proxies, &impostors }) {
+        for (int i : *list) {
+            const CrowdRobot& r = crowd.robots[i];
+            LodInstance v;
+            v.placement[0] = r.position.x;
+            v.placement[1] = r.position.y;
+            v.placement[2] = r.position.z;
+            v.placement[3] = glm::radians(r.heading);
+            records[k++] = v;
+        }
+    }
+    stream.commit(alloc);
+
+    const GLintptr impostorOffset = alloc.offset + (GLintptr)(proxies.size() * sizeof(LodInstance));
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glBindVertexArray(proxyVAO);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(LodInstance), (void*)alloc.offset);
+    glBindVertexArray(impostorVAO);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LodInstance), (void*)impostorOffset);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    proxyCount = (int)proxies.size();
+    impostorCount = (int)impostors.size();
+}
+
+int LodCrowdRenderer::draw(const glm::mat4& view,
+                           const glm::mat4& proj,
+                           const glm::vec3& camPos,
+                           const Scene& scene) const
+{
+    return drawProxies(view, proj, scene) + drawImpostors(view, proj, camPos, scene);
+}
+
+int LodCrowdRenderer::drawProxies(const glm::mat4& view, const glm::mat4& proj, const Scene& scene) const {
+    if (proxyCount == 0) return 0;
+
+    glUseProgram(proxyProgram);
+    setUniform(proxyProgram, "view", view);
+    setUniform(proxyProgram, "projection", proj);
+    setUniform(proxyProgram, "lightPos", scene.lightPosition);
+    setUniform(proxyProgram, "lightCol", scene.lightColor);
+    glBindVertexArray(proxyVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, proxyCount);
+    glBindVertexArray(0);
+    return 1;
+}
+
+int LodCrowdRenderer::drawImpostors(const glm::mat4& view,
+                                    const glm::mat4& proj,
+                                    const glm::vec3& camPos,
+                                    const Scene& scene) const
+{
+    if (impostorCount == 0) return 0;
+
+    glUseProgram(impostorProgram);
+    setUniform(impostorProgram, "view", view);
+    setUniform(impostorProgram, "projection", proj);
+    setUniform(impostorProgram, "camPos", camPos);
+    setUniform(impostorProgram, "lightCol", scene.lightColor);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, impostorTexture);
+    glBindVertexArray(impostorVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, impostorCount);
+    glBindVertexArray(0);
+    return 1;
+}
+
+int LodCrowdRenderer::drawDepth(const glm::mat4& view, const glm::mat4& proj) const {
+    if (proxyCount == 0) return 0;
+
+    glUseProgram(proxyDepthProgram);
+    setUniform(proxyDepthProgram, "view", view);
+    setUniform(proxyDepthProgram, "projection", proj);
+    glBindVertexArray(proxyVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, proxyCount);
+    glBindVertexArray(0);
+    return 1;
+}
+
+void LodCrowdRenderer::updatePrograms() {
+    // Proxy programs belong to the shader variant cache
+    proxyProgram = shaderVariant("shaders/lod_proxy_vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                 VARIANT_VERTEX_COLOR | VARIANT_NO_SPECULAR);
+    proxyDepthProgram = shaderVariant("shaders/lod_proxy_vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                      VARIANT_DEPTH_ONLY);
+}
+
+void LodCrowdRenderer::destroy() {
+    glDeleteProgram(impostorProgram);
+    glDeleteVertexArrays(1, &proxyVAO);
+    glDeleteVertexArrays(1, &impostorVAO);
+    glDeleteBuffers(1, &cubeVBO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteTextures(1, &impostorTexture);
+    proxyProgram = proxyDepthProgram = impostorProgram = proxyVAO = impostorVAO = cubeVBO = quadVBO = impostorTexture = 0;
+    proxyCount = impostorCount = 0;
+}
@@ -7,77 +7,402 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm> 
+#include <cstdlib>
+#include <string>
+#include <cstdio>
 #include <glm/common.hpp>
 
 #include "shader.h"
 #include "cube.h"
 #include "robot.h"
+#include "robot_description.h"
 #include "scene.h"
 #include "camera.h"
+#include "animation.h"
+#include "crowd.h"
+#include "vat.h"
+#include "palette.h"
+#include "batching.h"
+#include "frame_stats.h"
+#include "frame_arena.h"
+#include "alloc_tracker.h"
+#include "gl_caps.h"
+#include "stream_buffer.h"
+#include "culling.h"
+#include "lod.h"
+#include "occlusion.h"
+#include "hash.h"
+#include "redraw.h"
+#include "frame_pacer.h"
+#include "pacing_test.h"
+#include "dynamic_resolution.h"
+#include "fragment_counter.h"
+#include "program_cache.h"
+#include "shader_reload.h"
+#include "shader_variants.h"
+#include "embedded_assets.h"
+#include "startup_graph.h"
+#include "asset_manager.h"
+#include "mesh_asset.h"
 using namespace std;
 
+// Command line options
+struct AppOptions {
+    int   crowdSize = 0;       // --crowd N: robots in the crowd behind the hero robot
+    float bakeRate  = 30.0f;   // --bake-rate HZ: sample rate of baked crowd clips
+    CrowdRenderPath crowdPath = CrowdRenderPath::PER_PART;   // --crowd-path NAME
+    float statsInterval = 0.0f;  // --stats SECONDS: print frame statistics periodically
+    float benchPaths = 0.0f;     // --bench-paths SECONDS: run every crowd path in turn, then exit
+    int   streamMB = 48;         // --stream-mb N: size of the per-frame upload ring buffer
+    bool  persistentMapping = true;   // --no-persistent: force the unsynchronized map-range path
+    bool  wander = false;        // --wander: crowd robots move, so their BVH is refit every frame
+    LodSettings lod;             // --no-lod, --lod-pixels PROXY IMPOSTOR
+    bool  occlusion = true;      // --no-occlusion: skip software occlusion culling of the crowd
+    bool  onDemand = false;      // --on-demand: only redraw when something changed
+    int   swapInterval = 1;      // --swap-interval N: glfwSwapInterval (negative = adaptive, if supported)
+    float targetFps = 0.0f;      // --fps N: pace frames to this rate (0 = swap interval only)
+    bool  pacingTest = false;    // --pacing-test: tearing/jitter test screen instead of the scene
+    float dynamicResMs = 0.0f;   // --dynamic-res MS: scale the scene resolution to this GPU budget (0 = off)
+    float minResScale = 0.5f;    // --min-res-scale S: lowest dynamic resolution scale
+    bool  depthPrepass = false;  // --depth-prepass: depth-only pass before the lighting pass
+    string shaderCache = ".shader_cache";   // --shader-cache DIR, --no-shader-cache: program binary cache
+    bool  hotReload = false;     // --hot-reload: rebuild the robot shaders when their files change
+    string assetDir;             // --asset-dir DIR: read assets from DIR before the embedded copies
+    string archive;              // --archive FILE: packed asset archive to read assets from
+    float uploadBudgetMs = 2.0f; // --upload-budget MS: GPU upload time the asset manager may use per frame
+    string robot;                // --robot FILE: robot description to use instead of the built-in rig
+    string mesh;                 // --mesh FILE: converted mesh (mesh_import) shown beside the hero robot
+    string robotCache = ".robot_cache";     // --robot-cache DIR, --no-robot-cache: compiled robot descriptions
+    int   allocGuard = 0;        // --alloc-guard FRAMES: after FRAMES warm-up frames, fail if FRAMES more allocate
+};
+
+static AppOptions parseOptions(int argc, char** argv) {
+    AppOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--crowd" && i + 1 < argc) {
+            opts.crowdSize = max(0, atoi(argv[++i]));
+        } else if (arg == "--bake-rate" && i + 1 < argc) {
+            opts.bakeRate = max(1.0f, (float)atof(argv[++i]));
+        } else if (arg == "--crowd-path" && i + 1 < argc) {
+            string name = argv[++i];
+            bool found = false;
+            for (int p = 0; p < (int)CrowdRenderPath::PATH_COUNT; ++p) {
+                if (name == crowdRenderPathName((CrowdRenderPath)p)) {
+                    opts.crowdPath = (CrowdRenderPath)p;
+                    found = true;
+                }
+            }
+            if (!found) cerr << "Unknown crowd path: " << name << endl;
+        } else if (arg == "--stats" && i + 1 < argc) {
+            opts.statsInterval = max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--bench-paths" && i + 1 < argc) {
+            opts.benchPaths = max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--stream-mb" && i + 1 < argc) {
+            opts.streamMB = max(3, atoi(argv[++i]));
+        } else if (arg == "--no-persistent") {
+            opts.persistentMapping = false;
+        } else if (arg == "--wander") {
+            opts.wander = true;
+        } else if (arg == "--swap-interval" && i + 1 < argc) {
+            opts.swapInterval = atoi(argv[++i]);
+        } else if (arg == "--fps" && i + 1 < argc) {
+            opts.targetFps = max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--dynamic-res" && i + 1 < argc) {
+            opts.dynamicResMs = max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--min-res-scale" && i + 1 < argc) {
+            opts.minResScale = (float)atof(argv[++i]);
+        } else if (arg == "--shader-cache" && i + 1 < argc) {
+            opts.shaderCache = argv[++i];
+        } else if (arg == "--no-shader-cache") {
+            opts.shaderCache.clear();
+        } else if (arg == "--asset-dir" && i + 1 < argc) {
+            opts.assetDir = argv[++i];
+        } else if (arg == "--archive" && i + 1 < argc) {
+            opts.archive = argv[++i];
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            opts.mesh = argv[++i];
+        } else if (arg == "--robot" && i + 1 < argc) {
+            opts.robot = argv[++i];
+        } else if (arg == "--robot-cache" && i + 1 < argc) {
+            opts.robotCache = argv[++i];
+        } else if (arg == "--no-robot-cache") {
+            opts.robotCache.clear();
+        } else if (arg == "--alloc-guard" && i + 1 < argc) {
+            opts.allocGuard = max(1, atoi(argv[++i]));
+        } else if (arg == "--upload-budget" && i + 1 < argc) {
+            opts.uploadBudgetMs = max(0.0f, (float)atof(argv[++i]));
+        } else if (arg == "--hot-reload") {
+            opts.hotReload = true;
+        } else if (arg == "--depth-prepass") {
+            opts.depthPrepass = true;
+        } else if (arg == "--pacing-test") {
+            opts.pacingTest = true;
+        } else if (arg == "--on-demand") {
+            opts.onDemand = true;
+        } else if (arg == "--no-occlusion") {
+            opts.occlusion = false;
+        } else if (arg == "--no-lod") {
+            opts.lod.enabled = false;
+        } else if (arg == "--lod-pixels" && i + 2 < argc) {
+            opts.lod.proxyPixels = max(1.0f, (float)atof(argv[++i]));
+            opts.lod.impostorPixels = min(opts.lod.proxyPixels, max(1.0f, (float)atof(argv[++i])));
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+        }
+    }
+    return opts;
+}
+
 
 // Callback function for window resize
 void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
+// The --mesh model standing on the ground beside the hero robot, scaled to its height, at
+// the coarsest detail level whose error stays under a pixel
+static void drawSceneMesh(GLuint program, const MeshAsset& mesh, const glm::vec3& camPos,
+                          const glm::mat4& projection, GLFWwindow* window) {
+    const MeshView& data = mesh.data();
+    glm::vec3 size = data.boundsMax - data.boundsMin;
+    float scale = 2.0f / max(max(size.x, size.y), max(size.z, 1e-6f));
+    glm::vec3 foot((data.boundsMin.x + data.boundsMax.x) * 0.5f, data.boundsMin.y,
+                   (data.boundsMin.z + data.boundsMax.z) * 0.5f);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(2.5f, 0.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(scale));
+    model = glm::translate(model, -foot);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    float pixelsPerUnit = 0.5f * height * projection[1][1];
+    glm::vec3 center = glm::vec3(model * glm::vec4((data.boundsMin + data.boundsMax) * 0.5f, 1.0f));
+    // Errors are stored in model units
+    float distance = glm::length(center - camPos) / scale;
+    int level = mesh.lodCount() > 0 ? selectMeshLod(&mesh.lod(0), mesh.lodCount(), distance, pixelsPerUnit, 1.0f) : 0;
+
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3f(glGetUniformLocation(program, "objectCol"), 0.7f, 0.7f, 0.72f);
+    mesh.draw(level);
+}
+
 // Process keyboard input
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
 
-int main() {
-    // Initialize GLFW
-    if (!glfwInit()) {
-        cerr << "Failed to initialize GLFW" << endl;
-        return -1;
+int main(int argc, char** argv) {
+    double startupStart = monotonicSeconds();
+    AppOptions options = parseOptions(argc, argv);
+
+    if (!options.assetDir.empty()) setAssetOverrideDirectory(options.assetDir);
+    if (!options.archive.empty() && mountAssetArchive(options.archive)) {
+        cout << "Asset archive: " << options.archive << endl;
     }
 
-    // Configure GLFW
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Objects built by the startup tasks below
+    GLFWwindow* window = NULL;
+    RedrawScheduler redraw;
+    FramePacer pacer;
+    PacingTest pacingTest;
+    DynamicResolution dynamicRes;
+    bool dynamicResolution = false;
+    ReloadableProgram robotShader, robotDepthShader;
+    FragmentCounter fragmentCounter;
+    GLuint cubeVAO = 0;
+    SceneManager sceneManager;
+    Camera camera;
+    Crowd crowd;
+    StreamBuffer streamBuffer;
+    VatCrowdRenderer vatRenderer;
+    PaletteCrowdRenderer paletteRenderer;
+    BatchedCrowdRenderer batchedRenderer;
+    LodCrowdRenderer lodRenderer;
+    OcclusionBuffer occlusionBuffer;
+    CrowdRenderPath crowdPath = options.crowdPath;
+    AssetManager assets;
+
+    // Decoded on a worker while startup runs; uploaded by assets.update within the frame budget
+    AssetHandle<MeshAsset> sceneMesh;
+    if (!options.mesh.empty()) sceneMesh = assets.load<MeshAsset>(options.mesh);
+
+    // Startup as a dependency graph: shader preprocessing and crowd baking run on worker
+    // threads while the window and GL context are created; GL work stays on this thread
+    StartupGraph startup;
+
+    StartupGraph::Task windowTask = startup.add("window", StartupThread::MAIN, [&]() {
+        if (!glfwInit()) {
+            cerr << "Failed to initialize GLFW" << endl;
+            return false;
+        }
 
+        // Configure GLFW
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // Create window
-    GLFWwindow* window = glfwCreateWindow(800, 600, "OpenGL Graphics Project", NULL, NULL);
-    if (window == NULL) {
-        cerr << "Failed to create GLFW window" << endl;
+        window = glfwCreateWindow(800, 600, "OpenGL Graphics Project", NULL, NULL);
+        if (window == NULL) {
+            cerr << "Failed to create GLFW window" << endl;
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+        // Render on demand: input callbacks wake the loop, otherwise it sleeps while idle
+        redraw.setEnabled(options.onDemand);
+        redraw.setReportInterval(options.statsInterval);
+        redraw.attach(window);
+        return true;
+    });
+
+    StartupGraph::Task contextTask = startup.add("gl context", StartupThread::MAIN, [&]() {
+        // Load OpenGL function pointers with GLAD
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            cerr << "Failed to initialize GLAD" << endl;
+            return false;
+        }
+
+        // Print OpenGL version
+        cout << "OpenGL Version: " << glGetString(GL_VERSION) << endl;
+        cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
+        cout << "Renderer: " << glGetString(GL_RENDERER) << endl;
+        initGLCaps((GLADloadproc)glfwGetProcAddress);
+        initProgramCache(options.shaderCache.c_str());
+        return true;
+    }, {windowTask});
+
+    // Shader files are read and preprocessed off the main thread; only compile and link need GL
+    StartupGraph::Task shaderSourceTask = startup.add("shader sources", StartupThread::WORKER, [&]() {
+        bool ok = robotShader.prepare("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                      shaderVariantDefines(0))
+               && robotDepthShader.prepare("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                           shaderVariantDefines(VARIANT_DEPTH_ONLY));
+        if (options.crowdSize > 0) {
+            const char* crowdVertexShaders[] = {
+                "shaders/vat_vertex_shader.glsl",
+                "shaders/palette_vertex_shader.glsl",
+                "shaders/batch_vertex_shader.glsl",
+            };
+            for (const char* vs : crowdVertexShaders) {
+                prepareShaderVariant(vs, "shaders/fragment_shader.glsl", VARIANT_VERTEX_COLOR);
+                prepareShaderVariant(vs, "shaders/fragment_shader.glsl", VARIANT_DEPTH_ONLY);
+            }
+            prepareShaderVariant("shaders/lod_proxy_vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                 VARIANT_VERTEX_COLOR | VARIANT_NO_SPECULAR);
+            prepareShaderVariant("shaders/lod_proxy_vertex_shader.glsl", "shaders/fragment_shader.glsl",
+                                 VARIANT_DEPTH_ONLY);
+            prepareShaderProgram("shaders/impostor_vertex_shader.glsl", "shaders/impostor_fragment_shader.glsl");
+        }
+        if (options.dynamicResMs > 0.0f) {
+            prepareShaderProgram("shaders/upscale_vertex_shader.glsl", "shaders/upscale_fragment_shader.glsl");
+        }
+        if (options.pacingTest) {
+            prepareShaderProgram("shaders/pacing_vertex_shader.glsl", "shaders/pacing_fragment_shader.glsl");
+        }
+        return ok;
+    });
+
+    // The rig must be in place before anything poses a robot
+    StartupGraph::Task robotTask = startup.add("robot description", StartupThread::WORKER, [&]() {
+        if (options.robot.empty()) return true;
+        RobotDescription description;
+        bool fromCache = false;
+        double start = monotonicSeconds();
+        if (!loadRobotDescription(options.robot, options.robotCache, description, &fromCache)) return false;
+        setRobotDescription(description);
+        printf("Robot: %s, %d links, %s in %.2f ms\n", description.name, description.linkCount,
+               fromCache ? "compiled copy from cache" : "parsed", (monotonicSeconds() - start) * 1000.0);
+        return true;
+    });
+
+    // Crowd of robots playing baked clips: baking the clips and building the BVH is CPU only
+    StartupGraph::Task crowdBakeTask = startup.add("crowd bake", StartupThread::WORKER, [&]() {
+        if (options.crowdSize > 0) crowd.init(options.crowdSize, 2.0f, options.bakeRate);
+        return true;
+    }, {robotTask});
+
+    StartupGraph::Task robotShaderTask = startup.add("robot shaders", StartupThread::MAIN, [&]() {
+        return robotShader.build() && robotDepthShader.build();
+    }, {contextTask, shaderSourceTask});
+
+    StartupGraph::Task cubeTask = startup.add("cube upload", StartupThread::MAIN, [&]() {
+        cubeVAO = createCube();
+        return true;
+    }, {contextTask});
+
+    startup.add("frame setup", StartupThread::MAIN, [&]() {
+        // Frame pacing; path benchmarks must not be capped by vsync
+        int swapInterval = options.swapInterval;
+        if (options.benchPaths > 0.0f && swapInterval != 0) {
+            cout << "Benchmarking: swap interval 0" << endl;
+            swapInterval = 0;
+        }
+        pacer.init(window, swapInterval, options.targetFps);
+        pacer.setReportInterval(options.statsInterval);
+
+        if (options.pacingTest) pacingTest.init();
+
+        // Offscreen scene target whose resolution follows the GPU frame time
+        dynamicResolution = options.dynamicResMs > 0.0f
+                         && dynamicRes.init(options.dynamicResMs, options.minResScale);
+
+        // Depth pre-pass and the fragment count that shows whether it pays off
+        fragmentCounter.init();
+
+        glEnable(GL_DEPTH_TEST);
+        return true;
+    }, {contextTask, shaderSourceTask});
+
+    startup.add("crowd upload", StartupThread::MAIN, [&]() {
+        if (options.crowdSize > 0) {
+            streamBuffer.init((GLsizeiptr)options.streamMB * 1024 * 1024, options.persistentMapping);
+            vatRenderer.init(crowd.clips, streamBuffer);
+            paletteRenderer.init(streamBuffer);
+            batchedRenderer.init(streamBuffer);
+            lodRenderer.init(robotShader.id(), cubeVAO, streamBuffer);
+            occlusionBuffer.init(256, 128);
+        }
+        return true;
+    }, {contextTask, shaderSourceTask, robotTask, crowdBakeTask, robotShaderTask, cubeTask});
+
+    bool started = startup.run();
+    startup.printTimings();
+    if (!started) {
         glfwTerminate();
         return -1;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // Load OpenGL function pointers with GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        cerr << "Failed to initialize GLAD" << endl;
-        return -1;
+    GLuint shaderProgram = robotShader.id();
+    GLuint depthProgram = robotDepthShader.id();
+
+    // Shader hot reload: a background thread watches the shader directory (under the
+    // asset override directory, if any), reporting changes by their logical path
+    ShaderWatcher shaderWatcher;
+    bool hotReload = options.hotReload && shaderWatcher.start(assetDiskPath("shaders"), "shaders");
+
+    bool depthPrepass = options.depthPrepass;
+
+    // Frame statistics and the crowd path benchmark
+    frameStats().setReportInterval(options.statsInterval);
+    frameStats().setLabel(crowd.size() > 0 ? crowdRenderPathName(crowdPath) : "");
+
+    bool benchmarking = options.benchPaths > 0.0f && crowd.size() > 0;
+    double benchStart = glfwGetTime();
+    double benchMs[(int)CrowdRenderPath::PATH_COUNT] = {};
+    double benchAnimMs[(int)CrowdRenderPath::PATH_COUNT] = {};
+    double benchDraws[(int)CrowdRenderPath::PATH_COUNT] = {};
+    if (benchmarking) {
+        crowdPath = CrowdRenderPath::PER_PART;
+        frameStats().setLabel(crowdRenderPathName(crowdPath));
+        cout << "Benchmarking " << (int)CrowdRenderPath::PATH_COUNT << " crowd paths, "
+             << options.benchPaths << " s each" << endl;
     }
 
-    // Print OpenGL version
-    cout << "OpenGL Version: " << glGetString(GL_VERSION) << endl;  
-    cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
-    cout << "Renderer: " << glGetString(GL_RENDERER) << endl;
-
-    glEnable(GL_DEPTH_TEST);
-
-    //shader
-    GLuint shaderProgram = loadShaderProgram("shaders/vertex_shader.glsl","shaders/fragment_shader.glsl");
-
-    GLuint cubeVAO = createCube();
-
-    // Scene manager
-    SceneManager sceneManager;
-
-    // Camera system
-    Camera camera;
-
     // projection
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f/600.0f, 0.1f, 100.0f);
 
@@ -90,15 +415,91 @@ int main() {
     // Set viewport
     glViewport(0, 0, 800, 600);
 
+    // Startup cost, with the share spent building shader programs
+    const ProgramLoadStats& programStats = programLoadStats();
+    printf("Startup: %.1f ms, %d shader programs in %.1f ms (%d from cache%s), %d asset files read, %d embedded\n",
+           (monotonicSeconds() - startupStart) * 1000.0, programStats.programs, programStats.ms,
+           programStats.cacheHits, programStats.rejected ? ", some binaries rejected" : "",
+           assetFileReads(), embeddedAssetCount());
+
     static float lastTime = glfwGetTime();
+    bool firstFrame = true;
+
+    FrameAllocGuard allocGuard;
+    if (options.allocGuard > 0) {
+        allocGuard.start(options.allocGuard, options.allocGuard);
+        printf("Allocation guard: %d warm-up frames, then %d frames must not allocate\n", options.allocGuard,
+               options.allocGuard);
+    }
 
 while (!glfwWindowShouldClose(window)) {
     float now = glfwGetTime();
     float deltaTime = now - lastTime;
     lastTime = now;
+    frameStats().beginFrame(glfwGetTime());
+    // Last frame's transient containers are gone; no jobs are running between frames
+    resetFrameArenas();
+    const uint64_t frameHeapAllocs = heapAllocationCount();
+    allocGuard.beginFrame();
+    setAllocPhase(ALLOC_PHASE_INPUT);
 
     processInput(window);
 
+    // --- shader hot reload: finished rebuilds are swapped in at the frame boundary ---
+    if (hotReload) {
+        vector<ChangedShader> changed = shaderWatcher.takeChanges();
+        if (!changed.empty()) {
+            robotShader.onShadersChanged(changed);
+            robotDepthShader.onShadersChanged(changed);
+            reloadShaderVariants(changed);
+        }
+        if (robotShader.update()) shaderProgram = robotShader.id();
+        if (robotDepthShader.update()) depthProgram = robotDepthShader.id();
+        if (updateShaderVariants() && options.crowdSize > 0) {
+            vatRenderer.updatePrograms();
+            paletteRenderer.updatePrograms();
+            batchedRenderer.updatePrograms();
+            lodRenderer.updatePrograms();
+        }
+    }
+
+    // --- asset uploads: decoded assets reach the GPU within the frame's budget ---
+    assets.update(options.uploadBudgetMs);
+
+    // --- pacing test screen replaces the scene ---
+    if (options.pacingTest) {
+        static bool prevUp = false, prevDown = false;
+        static double lastTitle = -1.0;
+        bool up = glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS;
+        bool down = glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS;
+        bool changed = false;
+        if (up && !prevUp) {
+            pacer.setSwapInterval(pacer.swapInterval() + 1);
+            changed = true;
+        }
+        if (down && !prevDown && (pacer.swapInterval() > 0 || pacer.supportsSwapTear())) {
+            pacer.setSwapInterval(pacer.swapInterval() - 1);
+            changed = true;
+        }
+        prevUp = up;
+        prevDown = down;
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        pacingTest.draw(pacer, width, height, glfwGetTime());
+        setAllocPhase(ALLOC_PHASE_PRESENT);
+        pacer.waitForDeadline();
+        glfwSwapBuffers(window);
+        pacer.frameSwapped();
+        if (changed || glfwGetTime() - lastTitle > 1.0) {
+            pacingTest.updateTitle(window, pacer);
+            lastTitle = glfwGetTime();
+        }
+        glfwPollEvents();
+        if (allocGuard.endFrame()) glfwSetWindowShouldClose(window, true);
+        continue;
+    }
+
     // Update robot joints only if not in free camera mode (to avoid key conflicts)
     if (camera.getMode() != CameraMode::FREE) {
         updateJointsFromInput(window, deltaTime);
@@ -124,9 +525,9 @@ while (!glfwWindowShouldClose(window)) {
       bool now1 = glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS;
       bool now2 = glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS;
       bool now3 = glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS;
-      if (now1 && !prev1) { sceneManager.setScene(SceneManager::DAY); cout << "Scene: Day" << endl; }
-      if (now2 && !prev2) { sceneManager.setScene(SceneManager::NIGHT); cout << "Scene: Night" << endl; }
-      if (now3 && !prev3) { sceneManager.setScene(SceneManager::SUNSET); cout << "Scene: Sunset" << endl; }
+      if (now1 && !prev1) { sceneManager.setScene(SceneManager::DAY); printf("Scene: Day\n"); }
+      if (now2 && !prev2) { sceneManager.setScene(SceneManager::NIGHT); printf("Scene: Night\n"); }
+      if (now3 && !prev3) { sceneManager.setScene(SceneManager::SUNSET); printf("Scene: Sunset\n"); }
       prev1 = now1; prev2 = now2; prev3 = now3;
     }
 
@@ -141,6 +542,58 @@ while (!glfwWindowShouldClose(window)) {
       prevO = nowO; prevI = nowI; prevU = nowU;
     }
 
+    // L: cycle crowd render path
+    { static bool prev = false;
+      bool now = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+      if (now && !prev && crowd.size() > 0) {
+          crowdPath = (CrowdRenderPath)(((int)crowdPath + 1) % (int)CrowdRenderPath::PATH_COUNT);
+          frameStats().setLabel(crowdRenderPathName(crowdPath));
+          printf("Crowd path: %s\n", crowdRenderPathName(crowdPath));
+      }
+      prev = now;
+    }
+
+    // Y: toggle crowd level of detail
+    { static bool prev = false;
+      bool now = glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS;
+      if (now && !prev && crowd.size() > 0) {
+          options.lod.enabled = !options.lod.enabled;
+          printf("Crowd LOD: %s\n", options.lod.enabled ? "ON" : "OFF");
+      }
+      prev = now;
+    }
+
+    // 0: toggle the depth pre-pass
+    { static bool prev = false;
+      bool now = glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS;
+      if (now && !prev) {
+          depthPrepass = !depthPrepass;
+          printf("Depth pre-pass: %s\n", depthPrepass ? "ON" : "OFF");
+      }
+      prev = now;
+    }
+
+    // Left click: pick the crowd robot under the cursor
+    { static bool prev = false;
+      bool now = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+      if (now && !prev && crowd.size() > 0) {
+          double x, y;
+          int width, height;
+          glfwGetCursorPos(window, &x, &y);
+          glfwGetWindowSize(window, &width, &height);
+          glm::vec2 ndc(2.0f * (float)x / width - 1.0f, 1.0f - 2.0f * (float)y / height);
+          glm::mat4 invViewProj = glm::inverse(projection * camera.getViewMatrix());
+          glm::vec4 nearPoint = invViewProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+          glm::vec4 farPoint = invViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+          glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+          glm::vec3 dir = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+          int hit = crowd.pick(origin, dir);
+          if (hit >= 0) printf("Picked robot %d (clip %s)\n", hit, crowd.clips[crowd.robots[hit].clip].name.c_str());
+          else printf("Picked nothing\n");
+      }
+      prev = now;
+    }
+
     // SPACE: toggle idle walk
     { static bool prev = false;
       bool now = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
@@ -163,7 +616,7 @@ while (!glfwWindowShouldClose(window)) {
           armWave = false;
           headBob = false;
           torsoSway = false;
-          cout << "Reset: All animations stopped" << endl;
+          printf("Reset: All animations stopped\n");
       }
       prev = now;
     }
@@ -171,30 +624,32 @@ while (!glfwWindowShouldClose(window)) {
     // W: toggle arm wave animation
     { static bool prev = false;
       bool now = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
-      if (now && !prev) { armWave = !armWave; cout << "Arm Wave: " << (armWave ? "ON" : "OFF") << endl; }
+      if (now && !prev) { armWave = !armWave; printf("Arm Wave: %s\n", armWave ? "ON" : "OFF"); }
       prev = now;
     }
 
     // B: toggle head bobbing animation
     { static bool prev = false;
       bool now = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
-      if (now && !prev) { headBob = !headBob; cout << "Head Bob: " << (headBob ? "ON" : "OFF") << endl; }
+      if (now && !prev) { headBob = !headBob; printf("Head Bob: %s\n", headBob ? "ON" : "OFF"); }
       prev = now;
     }
 
     // T: toggle torso rotation animation
     { static bool prev = false;
       bool now = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
-      if (now && !prev) { torsoSway = !torsoSway; cout << "Torso Sway: " << (torsoSway ? "ON" : "OFF") << endl; }
+      if (now && !prev) { torsoSway = !torsoSway; printf("Torso Sway: %s\n", torsoSway ? "ON" : "OFF"); }
       prev = now;
     }
 
+    setAllocPhase(ALLOC_PHASE_ANIMATE);
+
     // --- idle walk animation (only when toggled on) ---
     if (idleWalk) {
-        float t = (float)glfwGetTime();
-        float s = sinf(2.0f * t);             // -1..+1
-        hipL_Ang  =  30.0f * s;               // swing
-        kneeL_Ang =  40.0f * fmaxf(0.0f, s);  // bend on forward swing
+        RobotPose p;
+        animIdleWalk((float)glfwGetTime(), p);
+        hipL_Ang  = p[JOINT_HIP_L];
+        kneeL_Ang = p[JOINT_KNEE_L];
     }
 
     // --- one-step FSM (runs until it finishes, independent of idleWalk) ---
@@ -230,28 +685,27 @@ while (!glfwWindowShouldClose(window)) {
 
     // --- arm wave animation ---
     if (armWave) {
-        float t = (float)glfwGetTime();
-        float leftArm = 60.0f * sinf(1.5f * t);      // Wave up and down
-        float rightArm = 60.0f * sinf(1.5f * t + 3.14159f);  // Opposite phase
-        setArms(leftArm, rightArm);
+        RobotPose p;
+        animArmWave((float)glfwGetTime(), p);
+        setArms(p[JOINT_SHOULDER_L], p[JOINT_SHOULDER_R]);
     } else {
         setArms(0.0f, 0.0f);  // Reset to neutral
     }
 
     // --- head bobbing animation ---
     if (headBob) {
-        float t = (float)glfwGetTime();
-        float headAngle = 15.0f * sinf(2.5f * t);    // Gentle nod
-        setHead(headAngle);
+        RobotPose p;
+        animHeadBob((float)glfwGetTime(), p);
+        setHead(p[JOINT_NECK]);
     } else {
         setHead(0.0f);  // Reset to neutral
     }
 
     // --- torso sway animation ---
     if (torsoSway) {
-        float t = (float)glfwGetTime();
-        float torsoAngle = 10.0f * sinf(1.0f * t);   // Slow gentle sway
-        setTorsoRotation(torsoAngle);
+        RobotPose p;
+        animTorsoSway((float)glfwGetTime(), p);
+        setTorsoRotation(p[JOINT_TORSO]);
     } else {
         setTorsoRotation(0.0f);  // Reset to neutral
     }
@@ -267,6 +721,36 @@ while (!glfwWindowShouldClose(window)) {
     glm::mat4 view = camera.getViewMatrix();
     glm::vec3 camPos = camera.getPosition();
 
+    // --- Render on demand: skip the frame if nothing on screen would change ---
+    {
+        uint64_t state = hashBytes(&view, sizeof(view));
+        state = hashBytes(&getRobotPose(), sizeof(RobotPose), state);
+        int sceneIndex = sceneManager.getCurrentSceneIndex();
+        state = hashBytes(&sceneIndex, sizeof(sceneIndex), state);
+        state = hashBytes(&crowdPath, sizeof(crowdPath), state);
+        state = hashBytes(&options.lod.enabled, sizeof(bool), state);
+        state = hashBytes(&depthPrepass, sizeof(bool), state);
+        state = hashBytes(&shaderProgram, sizeof(shaderProgram), state);
+        bool meshReady = sceneMesh.ready();
+        state = hashBytes(&meshReady, sizeof(bool), state);
+
+        bool animating = idleWalk || stepping || armWave || headBob || torsoSway
+                      || camera.isAnimating() || crowd.size() > 0 || benchmarking
+                      || robotShader.rebuilding() || robotDepthShader.rebuilding()
+                      || assets.pending() > 0;
+        if (!redraw.shouldDraw(state, animating)) {
+            // Skipped frames are checked by the allocation guard too, sleep included
+            setAllocPhase(ALLOC_PHASE_PRESENT);
+            redraw.waitForEvents();
+            lastTime = glfwGetTime();   // time spent asleep is not animation time
+            pacer.resync();
+            if (allocGuard.endFrame()) glfwSetWindowShouldClose(window, true);
+            continue;
+        }
+    }
+
+    setAllocPhase(ALLOC_PHASE_DRAW);
+
     // --- Update uniforms with scene properties and camera ---
     glUseProgram(shaderProgram);
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
@@ -274,22 +758,196 @@ while (!glfwWindowShouldClose(window)) {
     glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(currentScene.lightPosition));
     glUniform3fv(glGetUniformLocation(shaderProgram, "lightCol"), 1, glm::value_ptr(currentScene.lightColor));
 
+    // --- crowd: cull and stream this frame's data before any drawing ---
+    setAllocPhase(ALLOC_PHASE_CULL);
+    FrameVector<int> lodRobots[LOD_COUNT];
+    Frustum frustum = extractFrustum(projection * view);
+    if (crowd.size() > 0) {
+        // Reject off-screen and hidden robots before any per-robot work
+        // and pick each visible robot's detail level in the same pass
+        if (options.wander) crowd.wander(now);
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        float pixelsPerUnit = 0.5f * fbHeight * projection[1][1];
+        OcclusionBuffer* occlusion = nullptr;
+        if (options.occlusion) {
+            // The hero robot's torso hides crowd robots too
+            glm::mat4 heroParts[MAX_ROBOT_PARTS];
+            computeRobotParts(getRobotPose(), glm::mat4(1.0f), heroParts);
+            occlusionBuffer.begin(projection * view);
+            occlusionBuffer.addOccluder(heroParts[PART_TORSO]);
+            occlusion = &occlusionBuffer;
+        }
+        crowd.cull(frustum, camPos, pixelsPerUnit, options.lod, lodRobots, occlusion);
+
+        int visibleCount = 0;
+        for (int l = 0; l < LOD_COUNT; ++l) {
+            visibleCount += (int)lodRobots[l].size();
+            frameStats().add((StatCounter)(STAT_LOD_FULL + l), (double)lodRobots[l].size());
+        }
+        frameStats().add(STAT_ROBOTS_DRAWN, (double)visibleCount);
+        frameStats().add(STAT_ROBOTS_CULLED, (double)(crowd.size() - visibleCount));
+
+        const FrameVector<int>& visibleRobots = lodRobots[LOD_FULL];
+        streamBuffer.beginFrame();
+        switch (crowdPath) {
+            case CrowdRenderPath::PER_PART:
+                crowd.updatePoses(now, visibleRobots);
+                break;
+            case CrowdRenderPath::VAT:
+                vatRenderer.update(crowd, visibleRobots, streamBuffer);
+                break;
+            case CrowdRenderPath::PALETTE:
+                crowd.updatePoses(now, visibleRobots);
+                paletteRenderer.update(crowd, visibleRobots, streamBuffer);
+                break;
+            case CrowdRenderPath::BATCHED:
+                crowd.updatePoses(now, visibleRobots);
+                batchedRenderer.update(crowd, visibleRobots, frustum, streamBuffer);
+                break;
+            default:
+                break;
+        }
+        lodRenderer.update(crowd, lodRobots[LOD_PROXY], lodRobots[LOD_IMPOSTOR], streamBuffer);
+    }
+
+    // Opaque geometry: the hero robot, the full-detail crowd and the proxy boxes.
+    // depthPass draws it with the depth-only programs.
+    auto drawOpaque = [&](bool depthPass) {
+        GLuint robotProgram = depthPass ? depthProgram : shaderProgram;
+        glUseProgram(robotProgram);
+        drawRobot(robotProgram, cubeVAO, view, projection);
+        frameStats().add(STAT_DRAW_CALLS, robotPartCount());
+        if (sceneMesh.ready()) {
+            drawSceneMesh(robotProgram, *sceneMesh.get(), camPos, projection, window);
+            frameStats().add(STAT_DRAW_CALLS, 1);
+        }
+        if (crowd.size() == 0) return;
+
+        const FrameVector<int>& visibleRobots = lodRobots[LOD_FULL];
+        switch (crowdPath) {
+            case CrowdRenderPath::PER_PART:
+                drawCrowd(robotProgram, cubeVAO, crowd, visibleRobots, frustum, view, projection, depthPass);
+                break;
+            case CrowdRenderPath::VAT:
+                if (depthPass) vatRenderer.drawDepth(view, projection, now);
+                else vatRenderer.draw(view, projection, camPos, currentScene, now);
+                frameStats().add(STAT_DRAW_CALLS, 1);
+                break;
+            case CrowdRenderPath::PALETTE:
+                if (depthPass) paletteRenderer.drawDepth(view, projection);
+                else paletteRenderer.draw(view, projection, camPos, currentScene);
+                frameStats().add(STAT_DRAW_CALLS, 1);
+                break;
+            case CrowdRenderPath::BATCHED:
+                if (depthPass) batchedRenderer.drawDepth(view, projection);
+                else batchedRenderer.draw(view, projection, camPos, currentScene);
+                frameStats().add(STAT_DRAW_CALLS, 1);
+                break;
+            default:
+                break;
+        }
+        frameStats().add(STAT_DRAW_CALLS, depthPass ? lodRenderer.drawDepth(view, projection)
+                                                    : lodRenderer.drawProxies(view, projection, currentScene));
+    };
+
     // --- draw ---
+    setAllocPhase(ALLOC_PHASE_DRAW);
+    if (dynamicResolution) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        dynamicRes.beginScene(width, height);
+    }
     glClearColor(currentScene.backgroundColor.r, currentScene.backgroundColor.g, currentScene.backgroundColor.b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(shaderProgram);
-    drawRobot(shaderProgram, cubeVAO, view, projection);
 
+    // Depth pre-pass: lay down the nearest depth first, so the lighting pass
+    // (GL_EQUAL, no depth writes) shades each covered pixel once
+    if (depthPrepass) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawOpaque(true);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_EQUAL);
+    }
+
+    fragmentCounter.begin();
+    drawOpaque(false);
+    if (depthPrepass) {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+    // Impostors discard transparent texels, so they are depth tested normally after the opaque pass
+    if (crowd.size() > 0) {
+        frameStats().add(STAT_DRAW_CALLS, lodRenderer.drawImpostors(view, projection, camPos, currentScene));
+        streamBuffer.endFrame();
+    }
+    fragmentCounter.end();
+
+    if (dynamicResolution) {
+        dynamicRes.endScene();
+        frameStats().add(STAT_RES_SCALE, dynamicRes.scale() * 100.0);
+        frameStats().add(STAT_SCENE_GPU_MS, dynamicRes.gpuMs());
+    }
+
+    setAllocPhase(ALLOC_PHASE_PRESENT);
+    pacer.waitForDeadline();
     glfwSwapBuffers(window);
+    pacer.frameSwapped();
+    if (firstFrame) {
+        printf("First frame: %.1f ms after launch\n", (monotonicSeconds() - startupStart) * 1000.0);
+        firstFrame = false;
+    }
     glfwPollEvents();
+    frameStats().add(STAT_HEAP_ALLOCS, (double)(heapAllocationCount() - frameHeapAllocs));
+    frameStats().add(STAT_ARENA_KB, frameArenaBytesUsed() / 1024.0);
+    frameStats().endFrame(glfwGetTime());
+    if (allocGuard.endFrame()) glfwSetWindowShouldClose(window, true);
+
+    // --- crowd path benchmark: fixed time per path, then a summary ---
+    if (benchmarking && glfwGetTime() - benchStart >= options.benchPaths) {
+        int p = (int)crowdPath;
+        benchMs[p] = frameStats().totalAverageMs();
+        benchAnimMs[p] = frameStats().totalAverage(STAT_CPU_ANIM_MS);
+        benchDraws[p] = frameStats().totalAverage(STAT_DRAW_CALLS);
+        frameStats().resetTotals();
+        benchStart = glfwGetTime();
+
+        if (p + 1 < (int)CrowdRenderPath::PATH_COUNT) {
+            crowdPath = (CrowdRenderPath)(p + 1);
+            frameStats().setLabel(crowdRenderPathName(crowdPath));
+        } else {
+            printf("Crowd path benchmark, %d robots, %s\n", crowd.size(), (const char*)glGetString(GL_RENDERER));
+            for (int i = 0; i < (int)CrowdRenderPath::PATH_COUNT; ++i) {
+                printf("  %-9s %8.2f ms/frame  %8.2f ms cpu anim  %8.0f draw calls\n",
+                       crowdRenderPathName((CrowdRenderPath)i), benchMs[i], benchAnimMs[i], benchDraws[i]);
+            }
+            glfwSetWindowShouldClose(window, true);
+        }
+    }
 
     }
+    setAllocPhase(ALLOC_PHASE_STARTUP);
 
     // Cleanup
+    vatRenderer.destroy();
+    paletteRenderer.destroy();
+    batchedRenderer.destroy();
+    lodRenderer.destroy();
+    streamBuffer.destroy();
+    pacingTest.destroy();
+    dynamicRes.destroy();
+    fragmentCounter.destroy();
     glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteProgram(shaderProgram);
+    shaderWatcher.stop();
+    robotShader.destroy();
+    robotDepthShader.destroy();
+    sceneMesh.reset();   // released by shutdown, while the context exists
+    assets.shutdown();
+    destroyShaderVariants();
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    allocGuard.printSummary();
+    return allocGuard.failed() ? 1 : 0;
 }
 
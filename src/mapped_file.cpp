@@ -0,0 +1,108 @@
+#include "mapped_file.h"
+#include <fstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile()
+    : bytes(""), length(0), opened(false), mapped(false)
+{
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+    : bytes(""), length(0), opened(false), mapped(false)
+{
+    take(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+    if (this != &other) {
+        close();
+        take(other);
+    }
+    return *this;
+}
+
+void MappedFile::take(MappedFile& other) {
+    bytes = other.bytes;
+    length = other.length;
+    opened = other.opened;
+    mapped = other.mapped;
+    buffer.swap(other.buffer);   // the heap block, and so bytes, stays where it is
+    other.bytes = "";
+    other.length = 0;
+    other.opened = false;
+    other.mapped = false;
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    // An empty file cannot be mapped, but opens fine
+    if (info.st_size > 0) {
+        void* region = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED) {
+            bytes = (const char*)region;
+            length = (size_t)info.st_size;
+            mapped = true;
+        }
+    }
+    ::close(fd);   // the mapping stays valid
+    if (mapped || info.st_size == 0) {
+        opened = true;
+        return true;
+    }
+#endif
+
+    // No mmap: read the whole file once
+    ifstream file(path.c_str(), ios::binary | ios::ate);
+    if (!file) return false;
+    streamoff size = file.tellg();
+    if (size < 0) return false;
+    buffer.resize((size_t)size);
+    file.seekg(0);
+    if (size > 0 && !file.read(&buffer[0], size)) {
+        buffer.clear();
+        return false;
+    }
+    bytes = buffer.empty() ? "" : &buffer[0];
+    length = buffer.size();
+    opened = true;
+    return true;
+}
+
+void MappedFile::wrap(const char* data, size_t size) {
+    close();
+    bytes = data;
+    length = size;
+    opened = true;
+}
+
+void MappedFile::close() {
+#ifdef MAPPED_FILE_MMAP
+    if (mapped) munmap((void*)bytes, length);
+#endif
+    vector<char>().swap(buffer);
+    bytes = "";
+    length = 0;
+    opened = false;
+    mapped = false;
+}
@@ -0,0 +1,137 @@
+#include "mesh.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char MESH_MAGIC[4] = {'R', 'M', 'S', 'H'};
+static const uint64_t MESH_ALIGNMENT = 64;
+
+static uint64_t alignUp(uint64_t value) {
+    return (value + MESH_ALIGNMENT - 1) & ~(MESH_ALIGNMENT - 1);
+}
+
+void MeshData::computeBounds() {
+    boundsMin = glm::vec3(0.0f);
+    boundsMax = glm::vec3(0.0f);
+    for (size_t v = 0; v < vertexCount(); ++v) {
+        glm::vec3 p(vertices[v * MESH_VERTEX_FLOATS], vertices[v * MESH_VERTEX_FLOATS + 1],
+                    vertices[v * MESH_VERTEX_FLOATS + 2]);
+        boundsMin = v == 0 ? p : glm::min(boundsMin, p);
+        boundsMax = v == 0 ? p : glm::max(boundsMax, p);
+    }
+}
+
+static bool writePadded(FILE* out, const void* data, size_t size, uint64_t paddedSize) {
+    static const char zeros[MESH_ALIGNMENT] = {};
+    if (size > 0 && fwrite(data, 1, size, out) != size) return false;
+    size_t padding = (size_t)(paddedSize - size);
+    return padding == 0 || fwrite(zeros, 1, padding, out) == padding;
+}
+
+bool writeMeshFile(const string& path, const MeshData& mesh) {
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_MAGIC, 4);
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = (uint32_t)mesh.vertexCount();
+    header.indexCount = (uint32_t)mesh.indices.size();
+    header.vertexStride = MESH_VERTEX_FLOATS * sizeof(float);
+    vector<MeshLod> lods = mesh.lods;
+    if (lods.empty()) {
+        MeshLod all = {0, header.indexCount, 0.0f, 0};
+        lods.push_back(all);
+    }
+    header.lodCount = (uint32_t)lods.size();
+    for (int a = 0; a < 3; ++a) {
+        header.boundsMin[a] = mesh.boundsMin[a];
+        header.boundsMax[a] = mesh.boundsMax[a];
+    }
+    const size_t vertexBytes = mesh.vertices.size() * sizeof(float);
+    const size_t indexBytes = mesh.indices.size() * sizeof(uint32_t);
+    const size_t lodBytes = lods.size() * sizeof(MeshLod);
+    header.vertexOffset = alignUp(sizeof(header) + lodBytes);
+    header.indexOffset = alignUp(header.vertexOffset + vertexBytes);
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cerr << "Error: cannot write " << path << endl;
+        return false;
+    }
+    bool ok = fwrite(&header, 1, sizeof(header), out) == sizeof(header)
+           && writePadded(out, lods.data(), lodBytes, header.vertexOffset - sizeof(header))
+           && writePadded(out, mesh.vertices.data(), vertexBytes, header.indexOffset - header.vertexOffset)
+           && writePadded(out, mesh.indices.data(), indexBytes, indexBytes);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) cerr << "Error: writing " << path << " failed" << endl;
+    return ok;
+}
+
+bool parseMeshFile(const char* data, size_t size, MeshView& view) {
+    MeshFileHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MESH_MAGIC, 4) != 0 || header.version != MESH_FILE_VERSION
+        || header.vertexStride != MESH_VERTEX_FLOATS * sizeof(float)
+        || header.indexCount % 3 != 0
+        || header.lodCount == 0 || header.lodCount > (size - sizeof(header)) / sizeof(MeshLod)
+        || header.vertexOffset % sizeof(float) != 0 || header.indexOffset % sizeof(uint32_t) != 0
+        || header.vertexOffset < sizeof(header) + (uint64_t)header.lodCount * sizeof(MeshLod)
+        || header.vertexOffset > size
+        || (uint64_t)header.vertexCount * header.vertexStride > size - header.vertexOffset
+        || header.indexOffset > size
+        || (uint64_t)header.indexCount * sizeof(uint32_t) > size - header.indexOffset) {
+        return false;
+    }
+    view.vertices = (const float*)(data + header.vertexOffset);
+    view.indices = (const uint32_t*)(data + header.indexOffset);
+    view.vertexCount = header.vertexCount;
+    view.indexCount = header.indexCount;
+    view.lods = (const MeshLod*)(data + sizeof(header));
+    view.lodCount = header.lodCount;
+    view.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    view.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    for (uint32_t i = 0; i < view.lodCount; ++i) {
+        const MeshLod& lod = view.lods[i];
+        if (lod.firstIndex % 3 != 0 || lod.indexCount % 3 != 0 || lod.firstIndex > view.indexCount
+            || lod.indexCount > view.indexCount - lod.firstIndex) {
+            return false;
+        }
+    }
+
+    // An out-of-range index would read past the vertex buffer on the GPU
+    for (uint32_t i = 0; i < view.indexCount; ++i) {
+        if (view.indices[i] >= view.vertexCount) return false;
+    }
+    return true;
+}
+
+int selectMeshLod(const MeshLod* lods, int lodCount, float distance, float pixelsPerUnit, float maxPixels) {
+    // Errors grow with the level, so walk down until the next level would be visible
+    const float maxError = maxPixels * max(distance, 1e-6f) / pixelsPerUnit;
+    int level = 0;
+    while (level + 1 < lodCount && lods[level + 1].error <= maxError) ++level;
+    return level;
+}
+
+float computeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+    if (indexCount < 3) return 0.0f;
+
+    // FIFO: a vertex is still cached while fewer than cacheSize misses happened since it entered
+    vector<uint64_t> enteredAt(vertexCount, 0);
+    vector<unsigned char> seen(vertexCount, 0);
+    uint64_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (v >= vertexCount) continue;
+        if (!seen[v] || misses - enteredAt[v] >= (uint64_t)cacheSize) {
+            seen[v] = 1;
+            enteredAt[v] = misses;
+            ++misses;
+        }
+    }
+    return (float)misses / (float)(indexCount / 3);
+}
@@ -0,0 +1,76 @@
+#include "mesh_asset.h"
+#include <algorithm>
+
+using namespace std;
+
+MeshAsset::MeshAsset() : uploaded(0), vertexArray(0) {
+    view = MeshView();
+    buffers[0] = buffers[1] = 0;
+}
+
+bool MeshAsset::decode(MappedFile& file) {
+    if (!parseMeshFile(file.data(), file.size(), view)) return false;
+    bytes = std::move(file);   // the view points into the mapping, which moves along
+    lods.assign(view.lods, view.lods + view.lodCount);
+    return true;
+}
+
+bool MeshAsset::upload() {
+    const size_t vertexBytes = view.vertexCount * MESH_VERTEX_FLOATS * sizeof(float);
+    const size_t indexBytes = view.indexCount * sizeof(uint32_t);
+    if (vertexArray == 0) {
+        // Allocate both buffers up front, then fill them a slice at a time
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(2, buffers);
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexBytes, NULL, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, MESH_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexBytes, NULL, GL_STATIC_DRAW);
+    } else {
+        glBindVertexArray(vertexArray);   // binds the index buffer too
+    }
+
+    // Vertices first, then indices, at most sliceBytes per step
+    size_t slice = min(BufferAsset::sliceBytes, vertexBytes + indexBytes - uploaded);
+    if (uploaded < vertexBytes) {
+        slice = min(slice, vertexBytes - uploaded);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)uploaded, (GLsizeiptr)slice,
+                        (const char*)view.vertices + uploaded);
+    } else if (slice > 0) {
+        size_t offset = uploaded - vertexBytes;
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)slice,
+                        (const char*)view.indices + offset);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploaded += slice;
+    if (uploaded < vertexBytes + indexBytes) return false;
+
+    // Only the counts and bounds are needed from here on
+    bytes.close();
+    view.vertices = NULL;
+    view.indices = NULL;
+    view.lods = NULL;
+    return true;
+}
+
+void MeshAsset::release() {
+    if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+    if (buffers[0]) glDeleteBuffers(2, buffers);
+    vertexArray = 0;
+    buffers[0] = buffers[1] = 0;
+}
+
+void MeshAsset::draw(int level) const {
+    if (lods.empty()) return;
+    const MeshLod& range = lods[level >= 0 && level < (int)lods.size() ? level : lods.size() - 1];
+    glBindVertexArray(vertexArray);
+    glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT,
+                   (void*)(range.firstIndex * sizeof(uint32_t)));
+}
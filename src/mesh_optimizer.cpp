@@ -0,0 +1,155 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount, int cacheSize,
+                         vector<uint32_t>* clusters) {
+    if (clusters) clusters->clear();
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+    const uint32_t k = (uint32_t)max(3, cacheSize);
+
+    // Triangles around each vertex, and how many of them are still to be emitted
+    vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t v : indices) ++live[v];
+    vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + live[v];
+    vector<uint32_t> adjacency(indices.size());
+    {
+        vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) adjacency[cursor[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    // A vertex is in the cache while fewer than k vertices entered after it
+    vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = k + 1;
+    vector<unsigned char> emitted(triangleCount, 0);
+    vector<uint32_t> deadEnd;
+    vector<uint32_t> candidates;
+    vector<uint32_t> out;
+    out.reserve(indices.size());
+
+    size_t scan = 0;
+    int64_t fan = 0;
+    while (fan < (int64_t)vertexCount && live[fan] == 0) ++fan;
+    if (fan == (int64_t)vertexCount) return;
+
+    while (fan >= 0) {
+        // A fan around a vertex no longer cached starts a cluster
+        if (clusters && time - cacheTime[fan] > k) clusters->push_back((uint32_t)out.size());
+
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int c = 0; c < 3; ++c) {
+                uint32_t v = indices[t * 3 + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > k) cacheTime[v] = time++;
+            }
+        }
+
+        // Next fan: the candidate that stays cached longest while its fan is emitted
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= k) priority = time - cacheTime[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        // Dead end: a recently used vertex, else the first vertex with triangles left
+        while (next < 0 && !deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) next = v;
+        }
+        while (next < 0 && scan < vertexCount) {
+            if (live[scan] > 0) next = (int64_t)scan;
+            else ++scan;
+        }
+        fan = next;
+    }
+
+    indices.swap(out);
+}
+
+void optimizeOverdraw(vector<uint32_t>& indices, const vector<uint32_t>& clusters,
+                      const float* vertices, int vertexFloats) {
+    const size_t clusterCount = clusters.size();
+    if (clusterCount < 2) return;
+
+    auto position = [&](uint32_t v) {
+        const float* p = vertices + (size_t)v * vertexFloats;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Area-weighted centroid and normal of every cluster, and of the whole mesh
+    vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f));
+    vector<glm::vec3> normal(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : indices.size();
+        float area = 0.0f;
+        for (size_t i = begin; i + 2 < end; i += 3) {
+            glm::vec3 a = position(indices[i]), b = position(indices[i + 1]), d = position(indices[i + 2]);
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(n);
+            centroid[c] += (a + b + d) * (triangleArea / 3.0f);
+            normal[c] += n;
+            area += triangleArea;
+        }
+        meshCentroid += centroid[c];
+        meshArea += area;
+        if (area > 0.0f) centroid[c] = centroid[c] / area;
+    }
+    if (meshArea > 0.0f) meshCentroid = meshCentroid / meshArea;
+
+    // Clusters that face out from far away are drawn first
+    vector<float> key(clusterCount);
+    vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float length = glm::length(normal[c]);
+        key[c] = length > 0.0f ? glm::dot(centroid[c] - meshCentroid, normal[c] / length) : 0.0f;
+        order[c] = (uint32_t)c;
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+    vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (uint32_t c : order) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : indices.size();
+        out.insert(out.end(), indices.begin() + begin, indices.begin() + end);
+    }
+    indices.swap(out);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+    const size_t vertexCount = mesh.vertexCount();
+    vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = next++;
+            const float* v = &mesh.vertices[(size_t)index * MESH_VERTEX_FLOATS];
+            vertices.insert(vertices.end(), v, v + MESH_VERTEX_FLOATS);
+        }
+        index = remap[index];
+    }
+    // Vertices no triangle uses are dropped
+    mesh.vertices.swap(vertices);
+}
@@ -0,0 +1,421 @@
+#include "mesh_simplify.h"
+#include "job_system.h"
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+
+using namespace std;
+
+// Open borders weigh this much more than the surface, so outlines keep their shape
+static const double BORDER_WEIGHT = 10.0;
+
+// Sum of weighted squared distances to a set of planes (a symmetric 4x4 matrix), plus the
+// total weight so the sum can be turned into a mean
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double weight;
+};
+
+static void addPlane(Quadric& q, const glm::vec3& normal, const glm::vec3& point, double weight) {
+    const double a = normal.x, b = normal.y, c = normal.z;
+    const double d = -(a * point.x + b * point.y + c * point.z);
+    q.a2 += weight * a * a; q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+    q.b2 += weight * b * b; q.bc += weight * b * c; q.bd += weight * b * d;
+    q.c2 += weight * c * c; q.cd += weight * c * d;
+    q.d2 += weight * d * d;
+    q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other) {
+    q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+    q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+    q.c2 += other.c2; q.cd += other.cd;
+    q.d2 += other.d2;
+    q.weight += other.weight;
+}
+
+// Mean squared distance of p to the planes of a and b together
+static double collapseError(const Quadric& a, const Quadric& b, const glm::vec3& p) {
+    Quadric q = a;
+    addQuadric(q, b);
+    const double x = p.x, y = p.y, z = p.z;
+    double sum = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+               + q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+               + q.c2 * z * z + 2.0 * q.cd * z + q.d2;
+    return q.weight > 0.0 ? max(sum, 0.0) / q.weight : 0.0;
+}
+
+// Squared distance from p to the triangle abc (closest point by region, as in Ericson's
+// Real-Time Collision Detection)
+static float pointTriangleDistance2(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    glm::vec3 closest;
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        closest = a;
+    } else {
+        const glm::vec3 bp = p - b;
+        const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        const glm::vec3 cp = p - c;
+        const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        const float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+        if (d3 >= 0.0f && d4 <= d3) {
+            closest = b;
+        } else if (d6 >= 0.0f && d5 <= d6) {
+            closest = c;
+        } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            closest = a + ab * (d1 / (d1 - d3));
+        } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            closest = a + ac * (d2 / (d2 - d6));
+        } else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+            closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        } else {
+            const float denom = va + vb + vc;
+            if (denom <= 0.0f) return glm::dot(ap, ap);   // degenerate triangle
+            closest = a + ab * (vb / denom) + ac * (vc / denom);
+        }
+    }
+    const glm::vec3 d = p - closest;
+    return glm::dot(d, d);
+}
+
+struct Collapse {
+    double error;
+    uint32_t from, to;            // from moves onto to
+    uint32_t fromStamp, toStamp;  // stale once either vertex changed
+
+    bool operator>(const Collapse& other) const { return error > other.error; }
+};
+
+// Simplification state. Works on welded positions, so vertices that differ only in their
+// normal (hard edges) move together.
+class Simplifier {
+public:
+    Simplifier(const MeshData& mesh) : mesh(mesh) {}
+
+    int run(const vector<size_t>& targets, float maxError, vector<MeshData>& levels, vector<float>& errors);
+
+private:
+    void weld();
+    void buildQuadrics();
+    void pushEdge(uint32_t a, uint32_t b);
+    bool allowed(uint32_t from, uint32_t to) const;
+    void collapse(uint32_t from, uint32_t to);
+    void snapshot(MeshData& out) const;
+    double levelError() const;
+
+    glm::vec3 normalOf(uint32_t vertex) const {
+        const float* v = &mesh.vertices[(size_t)vertex * MESH_VERTEX_FLOATS];
+        return glm::vec3(v[3], v[4], v[5]);
+    }
+
+    const MeshData& mesh;
+    vector<uint32_t> positionOf;          // original vertex -> welded position
+    vector<glm::vec3> positions;
+    vector<uint32_t> positionVertices;    // original vertices of each position...
+    vector<uint32_t> positionFirst;       // ...starting here (one extra entry at the end)
+    vector<uint32_t> triangles;           // welded positions, three per triangle
+    vector<unsigned char> dead;
+    size_t liveTriangles;
+    vector<vector<uint32_t>> vertexTriangles;
+    vector<Quadric> quadrics;
+    vector<unsigned char> removed;
+    vector<uint32_t> collapsedOnto;      // where each removed position went
+    vector<uint32_t> stamps;
+    priority_queue<Collapse, vector<Collapse>, greater<Collapse>> queue;
+};
+
+void Simplifier::weld() {
+    const uint32_t vertexCount = (uint32_t)mesh.vertexCount();
+    vector<uint32_t> order(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) order[v] = v;
+    auto at = [&](uint32_t v) { return &mesh.vertices[(size_t)v * MESH_VERTEX_FLOATS]; };
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const float* p = at(a);
+        const float* q = at(b);
+        return p[0] != q[0] ? p[0] < q[0] : p[1] != q[1] ? p[1] < q[1] : p[2] < q[2];
+    });
+
+    positionOf.resize(vertexCount);
+    positionVertices.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        const float* p = at(order[i]);
+        if (i == 0 || !equal(p, p + 3, at(order[i - 1]))) {
+            positionFirst.push_back(i);
+            positions.push_back(glm::vec3(p[0], p[1], p[2]));
+        }
+        positionOf[order[i]] = (uint32_t)positions.size() - 1;
+        positionVertices[i] = order[i];
+    }
+    positionFirst.push_back(vertexCount);
+}
+
+void Simplifier::buildQuadrics() {
+    const size_t triangleCount = mesh.triangleCount();
+    quadrics.assign(positions.size(), Quadric());
+    triangles.resize(triangleCount * 3);
+    dead.assign(triangleCount, 0);
+    liveTriangles = triangleCount;
+    vertexTriangles.assign(positions.size(), vector<uint32_t>());
+
+    vector<uint64_t> edges;   // (min position << 32 | max position), for finding borders
+    edges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        uint32_t* tri = &triangles[t * 3];
+        for (int k = 0; k < 3; ++k) tri[k] = positionOf[mesh.indices[t * 3 + k]];
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+            dead[t] = 1;
+            --liveTriangles;
+            continue;
+        }
+        glm::vec3 n = glm::cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]);
+        float length = glm::length(n);
+        for (int k = 0; k < 3; ++k) {
+            if (length > 0.0f) addPlane(quadrics[tri[k]], n / length, positions[tri[0]], 0.5 * length);
+            vertexTriangles[tri[k]].push_back((uint32_t)t);
+            uint32_t a = tri[k], b = tri[(k + 1) % 3];
+            edges.push_back((uint64_t)min(a, b) << 32 | max(a, b));
+        }
+    }
+    sort(edges.begin(), edges.end());
+
+    // An edge of only one triangle is a border: add a plane through it, perpendicular to the
+    // surface, to both ends
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) ++j;
+        uint32_t a = (uint32_t)(edges[i] >> 32), b = (uint32_t)edges[i];
+        if (j - i == 1) {
+            for (uint32_t t : vertexTriangles[a]) {
+                const uint32_t* tri = &triangles[t * 3];
+                if (tri[0] != b && tri[1] != b && tri[2] != b) continue;
+                glm::vec3 edge = positions[b] - positions[a];
+                glm::vec3 n = glm::cross(edge, glm::cross(positions[tri[1]] - positions[tri[0]],
+                                                          positions[tri[2]] - positions[tri[0]]));
+                float length = glm::length(n);
+                if (length > 0.0f) {
+                    double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+                    addPlane(quadrics[a], n / length, positions[a], weight);
+                    addPlane(quadrics[b], n / length, positions[a], weight);
+                }
+                break;
+            }
+        }
+        pushEdge(a, b);
+        i = j;
+    }
+}
+
+void Simplifier::pushEdge(uint32_t a, uint32_t b) {
+    double ab = collapseError(quadrics[a], quadrics[b], positions[b]);
+    double ba = collapseError(quadrics[a], quadrics[b], positions[a]);
+    Collapse c;
+    if (ab <= ba) {
+        c.error = ab; c.from = a; c.to = b;
+    } else {
+        c.error = ba; c.from = b; c.to = a;
+    }
+    c.fromStamp = stamps[c.from];
+    c.toStamp = stamps[c.to];
+    queue.push(c);
+}
+
+// Rejects collapses that would flip a triangle around from
+bool Simplifier::allowed(uint32_t from, uint32_t to) const {
+    for (uint32_t t : vertexTriangles[from]) {
+        if (dead[t]) continue;
+        const uint32_t* tri = &triangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) continue;   // this one disappears
+        glm::vec3 p[3], moved[3];
+        for (int k = 0; k < 3; ++k) {
+            p[k] = positions[tri[k]];
+            moved[k] = tri[k] == from ? positions[to] : p[k];
+        }
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+        if (glm::dot(before, after) <= 0.0f) return false;
+    }
+    return true;
+}
+
+void Simplifier::collapse(uint32_t from, uint32_t to) {
+    removed[from] = 1;
+    collapsedOnto[from] = to;
+    addQuadric(quadrics[to], quadrics[from]);
+    for (uint32_t t : vertexTriangles[from]) {
+        if (dead[t]) continue;
+        uint32_t* tri = &triangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            dead[t] = 1;
+            --liveTriangles;
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (tri[k] == from) tri[k] = to;
+        }
+        vertexTriangles[to].push_back(t);
+    }
+    vector<uint32_t>().swap(vertexTriangles[from]);
+    ++stamps[to];
+
+    // Drop dead triangles from to's list and requeue all of its edges
+    vector<uint32_t>& around = vertexTriangles[to];
+    around.erase(remove_if(around.begin(), around.end(), [&](uint32_t t) { return dead[t] != 0; }), around.end());
+    vector<uint32_t> neighbors;
+    for (uint32_t t : around) {
+        for (int k = 0; k < 3; ++k) {
+            if (triangles[t * 3 + k] != to) neighbors.push_back(triangles[t * 3 + k]);
+        }
+    }
+    sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    for (uint32_t n : neighbors) pushEdge(to, n);
+}
+
+// Live triangles as a mesh. A corner whose position moved takes the vertex at its new
+// position with the closest normal, so levels only use original vertices.
+void Simplifier::snapshot(MeshData& out) const {
+    vector<uint32_t> remap(mesh.vertexCount(), UINT32_MAX);
+    out.vertices.clear();
+    out.indices.clear();
+    out.lods.clear();
+    out.indices.reserve(liveTriangles * 3);
+    for (size_t t = 0; t < dead.size(); ++t) {
+        if (dead[t]) continue;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t position = triangles[t * 3 + k];
+            uint32_t vertex = mesh.indices[t * 3 + k];
+            if (positionOf[vertex] != position) {
+                glm::vec3 normal = normalOf(vertex);
+                float best = -2.0f;
+                for (uint32_t i = positionFirst[position]; i < positionFirst[position + 1]; ++i) {
+                    float d = glm::dot(normalOf(positionVertices[i]), normal);
+                    if (d > best) {
+                        best = d;
+                        vertex = positionVertices[i];
+                    }
+                }
+            }
+            if (remap[vertex] == UINT32_MAX) {
+                remap[vertex] = (uint32_t)out.vertexCount();
+                const float* v = &mesh.vertices[(size_t)vertex * MESH_VERTEX_FLOATS];
+                out.vertices.insert(out.vertices.end(), v, v + MESH_VERTEX_FLOATS);
+            }
+            out.indices.push_back(remap[vertex]);
+        }
+    }
+    out.computeBounds();
+}
+
+// RMS distance of the original positions to the current surface. A removed position is
+// measured against the live triangles around the position it was collapsed into; kept
+// positions are on both surfaces.
+double Simplifier::levelError() const {
+    if (positions.empty()) return 0.0;
+    vector<uint32_t> target(collapsedOnto);
+    double sum = 0.0;
+    for (uint32_t p = 0; p < (uint32_t)positions.size(); ++p) {
+        if (!removed[p]) continue;
+        uint32_t to = target[p];
+        while (removed[to]) to = target[to];
+        for (uint32_t q = p; removed[q]; ) {   // shorten the chain for later positions
+            uint32_t next = target[q];
+            target[q] = to;
+            q = next;
+        }
+
+        float best = -1.0f;
+        for (uint32_t t : vertexTriangles[to]) {
+            if (dead[t]) continue;
+            const uint32_t* tri = &triangles[t * 3];
+            float d = pointTriangleDistance2(positions[p], positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+            if (best < 0.0f || d < best) best = d;
+        }
+        if (best > 0.0f) sum += best;
+    }
+    return sqrt(sum / positions.size());
+}
+
+int Simplifier::run(const vector<size_t>& targets, float maxError, vector<MeshData>& levels, vector<float>& errors) {
+    levels.clear();
+    errors.clear();
+    weld();
+    removed.assign(positions.size(), 0);
+    collapsedOnto.assign(positions.size(), 0);
+    stamps.assign(positions.size(), 0);
+    buildQuadrics();
+
+    const double maxSquared = (double)maxError * maxError;
+    size_t level = 0;
+    while (level < targets.size()) {
+        if (liveTriangles <= targets[level]) {
+            levels.push_back(MeshData());
+            snapshot(levels.back());
+            errors.push_back((float)levelError());
+            ++level;
+            continue;
+        }
+        if (queue.empty()) break;
+        Collapse c = queue.top();
+        queue.pop();
+        if (removed[c.from] || removed[c.to] || stamps[c.from] != c.fromStamp || stamps[c.to] != c.toStamp) continue;
+        if (maxSquared > 0.0 && c.error > maxSquared) break;
+        if (!allowed(c.from, c.to)) continue;
+        collapse(c.from, c.to);
+    }
+    return (int)levels.size();
+}
+
+int simplifyMesh(const MeshData& mesh, const vector<size_t>& targetTriangles, float maxError,
+                 vector<MeshData>& levels, vector<float>& errors) {
+    Simplifier simplifier(mesh);
+    return simplifier.run(targetTriangles, maxError, levels, errors);
+}
+
+void buildMeshLods(MeshData& mesh, const MeshLodSettings& settings) {
+    mesh.lods.clear();
+    mesh.computeBounds();
+    const float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+
+    vector<size_t> targets;
+    size_t triangles = mesh.triangleCount();
+    for (int i = 1; i < settings.levels; ++i) {
+        triangles = (size_t)(triangles * settings.ratio);
+        if (triangles < settings.minTriangles) break;
+        targets.push_back(triangles);
+    }
+    vector<MeshData> levels;
+    vector<float> errors;
+    simplifyMesh(mesh, targets, settings.maxError * diagonal, levels, errors);
+    levels.insert(levels.begin(), mesh);
+    errors.insert(errors.begin(), 0.0f);
+
+    MeshData packed;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        MeshData& level = levels[i];
+        vector<uint32_t> clusters;
+        optimizeVertexCache(level.indices, level.vertexCount(), settings.cacheSize, i == 0 ? &clusters : NULL);
+        if (i == 0) optimizeOverdraw(level.indices, clusters, level.vertices.data(), MESH_VERTEX_FLOATS);
+        optimizeVertexFetch(level);
+
+        MeshLod lod;
+        lod.firstIndex = (uint32_t)packed.indices.size();
+        lod.indexCount = (uint32_t)level.indices.size();
+        lod.error = errors[i];
+        lod.reserved = 0;
+        packed.lods.push_back(lod);
+        const uint32_t base = (uint32_t)packed.vertexCount();
+        packed.vertices.insert(packed.vertices.end(), level.vertices.begin(), level.vertices.end());
+        for (uint32_t index : level.indices) packed.indices.push_back(base + index);
+    }
+    packed.computeBounds();
+    mesh = std::move(packed);
+}
+
+void buildMeshLods(vector<MeshData>& meshes, const MeshLodSettings& settings) {
+    jobSystem().parallelFor((int)meshes.size(), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) buildMeshLods(meshes[i], settings);
+    });
+}
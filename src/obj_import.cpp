@@ -0,0 +1,396 @@
+#include "obj_import.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static const size_t CHUNK_BYTES = 1 << 20;
+
+// A face corner: position and normal index (0-based, normal -1 if none). Negative OBJ indices
+// are relative to the chunk until its base offsets are known; flags marks which.
+struct ObjCorner {
+    int32_t position;
+    int32_t normal;
+    uint8_t flags;
+};
+
+static const uint8_t RELATIVE_POSITION = 1;
+static const uint8_t RELATIVE_NORMAL = 2;
+
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    vector<float> positions;
+    vector<float> normals;
+    vector<ObjCorner> corners;
+    size_t lines;
+    size_t errorLine;          // 1-based within the chunk, 0 = no error
+    const char* error;
+};
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline void skipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+}
+
+static inline bool atTokenEnd(const char* p, const char* end) {
+    return p >= end || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n';
+}
+
+static bool parseInt(const char*& p, const char* end, int& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p >= end || !isDigit(*p)) return false;
+    int64_t value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > INT32_MAX) return false;
+    }
+    out = negative ? -(int)value : (int)value;
+    return true;
+}
+
+// Decimal float without locale lookups or allocation; exotic spellings (inf, nan, hex)
+// go through strtod on a small stack copy
+static bool parseFloat(const char*& p, const char* end, float& out) {
+    static const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    double mantissa = 0.0;
+    int digits = 0;
+    int exponent = 0;
+    while (p < end && isDigit(*p)) {
+        mantissa = mantissa * 10.0 + (*p++ - '0');
+        ++digits;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && isDigit(*p)) {
+            mantissa = mantissa * 10.0 + (*p++ - '0');
+            --exponent;
+            ++digits;
+        }
+    }
+    if (digits == 0) {
+        char buffer[32];
+        size_t length = 0;
+        p = start;
+        while (p < end && !atTokenEnd(p, end) && length + 1 < sizeof(buffer)) buffer[length++] = *p++;
+        buffer[length] = '\0';
+        char* parsed = NULL;
+        double value = strtod(buffer, &parsed);
+        if (parsed != buffer + length || length == 0) return false;
+        out = (float)value;
+        return true;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        int e = 0;
+        if (!parseInt(p, end, e)) return false;
+        exponent += e;
+    }
+
+    double value = mantissa;
+    if (exponent > 0) value *= exponent <= 22 ? POWERS[exponent] : pow(10.0, exponent);
+    else if (exponent < 0) value /= -exponent <= 22 ? POWERS[-exponent] : pow(10.0, -exponent);
+    out = (float)(negative ? -value : value);
+    return atTokenEnd(p, end);
+}
+
+static bool parseFloats(const char*& p, const char* end, int count, vector<float>& out) {
+    for (int i = 0; i < count; ++i) {
+        skipSpaces(p, end);
+        float value;
+        if (!parseFloat(p, end, value)) return false;
+        out.push_back(value);
+    }
+    return true;
+}
+
+// One "v", "v/vt", "v//vn" or "v/vt/vn" token
+static bool parseCorner(const char*& p, const char* end, const ObjChunk& chunk, ObjCorner& corner) {
+    int index = 0;
+    if (!parseInt(p, end, index) || index == 0) return false;
+    corner.flags = 0;
+    if (index > 0) {
+        corner.position = index - 1;
+    } else {
+        corner.position = (int)(chunk.positions.size() / 3) + index;
+        corner.flags |= RELATIVE_POSITION;
+    }
+    corner.normal = -1;
+
+    if (p < end && *p == '/') {
+        ++p;
+        int texcoord = 0;
+        if (p < end && *p != '/' && !parseInt(p, end, texcoord)) return false;
+        if (p < end && *p == '/') {
+            ++p;
+            if (!parseInt(p, end, index) || index == 0) return false;
+            if (index > 0) {
+                corner.normal = index - 1;
+            } else {
+                corner.normal = (int)(chunk.normals.size() / 3) + index;
+                corner.flags |= RELATIVE_NORMAL;
+            }
+        }
+    }
+    return atTokenEnd(p, end);
+}
+
+// Polygons are fanned around their first corner as they are read
+static const char* parseFace(const char*& p, const char* end, ObjChunk& chunk) {
+    ObjCorner first, previous, corner;
+    int count = 0;
+    for (;;) {
+        skipSpaces(p, end);
+        if (p >= end || *p == '\n' || *p == '#') break;
+        if (!parseCorner(p, end, chunk, corner)) return "malformed face index";
+        if (count == 0) {
+            first = corner;
+        } else if (count >= 2) {
+            chunk.corners.push_back(first);
+            chunk.corners.push_back(previous);
+            chunk.corners.push_back(corner);
+        }
+        previous = corner;
+        ++count;
+    }
+    return count < 3 ? "face with fewer than three corners" : NULL;
+}
+
+static void parseChunk(ObjChunk& chunk) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    while (p < end) {
+        ++chunk.lines;
+        skipSpaces(p, end);
+        const char* error = NULL;
+        if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            ++p;
+            if (!parseFloats(p, end, 3, chunk.positions)) error = "malformed vertex position";
+        } else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 2;
+            if (!parseFloats(p, end, 3, chunk.normals)) error = "malformed vertex normal";
+        } else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            ++p;
+            error = parseFace(p, end, chunk);
+        }
+        if (error) {
+            chunk.errorLine = chunk.lines;
+            chunk.error = error;
+            return;
+        }
+        // The rest of the line (w, vertex colors, comments, other statements) is skipped
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        p = newline ? newline + 1 : end;
+    }
+}
+
+static inline uint64_t mixKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+// Open-addressing map from (position, normal) to vertex index
+class CornerMap {
+public:
+    explicit CornerMap(size_t expected) : count(0) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity *= 2;
+        keys.assign(capacity, EMPTY_KEY);
+        values.resize(capacity);
+    }
+
+    // Existing vertex for key, or next (and next is recorded)
+    uint32_t findOrInsert(uint64_t key, uint32_t next) {
+        if ((count + 1) * 10 > keys.size() * 7) grow();
+        size_t mask = keys.size() - 1;
+        for (size_t slot = mixKey(key) & mask;; slot = (slot + 1) & mask) {
+            if (keys[slot] == key) return values[slot];
+            if (keys[slot] == EMPTY_KEY) {
+                keys[slot] = key;
+                values[slot] = next;
+                ++count;
+                return next;
+            }
+        }
+    }
+
+private:
+    void grow() {
+        vector<uint64_t> oldKeys;
+        vector<uint32_t> oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        keys.assign(oldKeys.size() * 2, EMPTY_KEY);
+        values.resize(oldKeys.size() * 2);
+        size_t mask = keys.size() - 1;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldKeys[i] == EMPTY_KEY) continue;
+            size_t slot = mixKey(oldKeys[i]) & mask;
+            while (keys[slot] != EMPTY_KEY) slot = (slot + 1) & mask;
+            keys[slot] = oldKeys[i];
+            values[slot] = oldValues[i];
+        }
+    }
+
+    vector<uint64_t> keys;
+    vector<uint32_t> values;
+    size_t count;
+};
+
+bool importObj(const char* text, size_t size, MeshData& mesh, ObjImportStats* stats) {
+    double start = monotonicSeconds();
+
+    // --- chunks end at line boundaries ---
+    vector<ObjChunk> chunks;
+    for (const char* p = text; p < text + size; ) {
+        const char* end = p + min(CHUNK_BYTES, (size_t)(text + size - p));
+        const char* newline = end < text + size ? (const char*)memchr(end, '\n', text + size - end) : NULL;
+        end = newline ? newline + 1 : text + size;
+        ObjChunk chunk;
+        chunk.begin = p;
+        chunk.end = end;
+        chunk.lines = 0;
+        chunk.errorLine = 0;
+        chunk.error = NULL;
+        chunks.push_back(chunk);
+        p = end;
+    }
+    const int chunkCount = (int)chunks.size();
+
+    jobSystem().parallelFor(chunkCount, 1, [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) parseChunk(chunks[c]);
+    });
+
+    // --- chunk offsets; errors are reported by global line ---
+    vector<size_t> positionBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+    size_t lineBase = 0;
+    for (int c = 0; c < chunkCount; ++c) {
+        if (chunks[c].error) {
+            cerr << "Error: OBJ line " << lineBase + chunks[c].errorLine << ": " << chunks[c].error << endl;
+            return false;
+        }
+        lineBase += chunks[c].lines;
+        positionBase[c + 1] = positionBase[c] + chunks[c].positions.size() / 3;
+        normalBase[c + 1] = normalBase[c] + chunks[c].normals.size() / 3;
+        cornerBase[c + 1] = cornerBase[c] + chunks[c].corners.size();
+    }
+    const size_t positionCount = positionBase[chunkCount];
+    const size_t normalCount = normalBase[chunkCount];
+    const size_t cornerCount = cornerBase[chunkCount];
+
+    // --- resolve relative indices and gather everything, again per chunk ---
+    vector<float> positions(positionCount * 3), normals(normalCount * 3);
+    vector<ObjCorner> corners(cornerCount);
+    vector<unsigned char> badIndex(chunkCount, 0);
+    jobSystem().parallelFor(chunkCount, 1, [&](int begin, int end) {
+        for (int c = begin; c < end; ++c) {
+            ObjChunk& chunk = chunks[c];
+            if (!chunk.positions.empty()) {
+                memcpy(&positions[positionBase[c] * 3], chunk.positions.data(), chunk.positions.size() * sizeof(float));
+            }
+            if (!chunk.normals.empty()) {
+                memcpy(&normals[normalBase[c] * 3], chunk.normals.data(), chunk.normals.size() * sizeof(float));
+            }
+            for (size_t i = 0; i < chunk.corners.size(); ++i) {
+                ObjCorner corner = chunk.corners[i];
+                if (corner.flags & RELATIVE_POSITION) corner.position += (int32_t)positionBase[c];
+                if (corner.flags & RELATIVE_NORMAL) corner.normal += (int32_t)normalBase[c];
+                if (corner.position < 0 || (size_t)corner.position >= positionCount
+                    || corner.normal < -1 || (corner.normal >= 0 && (size_t)corner.normal >= normalCount)) {
+                    badIndex[c] = 1;
+                }
+                corners[cornerBase[c] + i] = corner;
+            }
+            vector<float>().swap(chunk.positions);
+            vector<float>().swap(chunk.normals);
+            vector<ObjCorner>().swap(chunk.corners);
+        }
+    });
+    for (int c = 0; c < chunkCount; ++c) {
+        if (badIndex[c]) {
+            cerr << "Error: OBJ face refers to a vertex or normal that does not exist" << endl;
+            return false;
+        }
+    }
+    double parsed = monotonicSeconds();
+
+    // --- one vertex per unique (position, normal) pair ---
+    bool missingNormals = false;
+    for (const ObjCorner& corner : corners) missingNormals |= corner.normal < 0;
+    vector<float> smoothNormals;
+    if (missingNormals) {
+        // Area-weighted: the unnormalized cross product is twice the triangle's area
+        smoothNormals.assign(positionCount * 3, 0.0f);
+        for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+            const float* a = &positions[corners[i].position * 3];
+            const float* b = &positions[corners[i + 1].position * 3];
+            const float* d = &positions[corners[i + 2].position * 3];
+            glm::vec3 n = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]),
+                                     glm::vec3(d[0] - a[0], d[1] - a[1], d[2] - a[2]));
+            for (int k = 0; k < 3; ++k) {
+                float* s = &smoothNormals[corners[i + k].position * 3];
+                s[0] += n.x; s[1] += n.y; s[2] += n.z;
+            }
+        }
+        for (size_t p = 0; p < positionCount; ++p) {
+            glm::vec3 n(smoothNormals[p * 3], smoothNormals[p * 3 + 1], smoothNormals[p * 3 + 2]);
+            float length = glm::length(n);
+            n = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            smoothNormals[p * 3] = n.x; smoothNormals[p * 3 + 1] = n.y; smoothNormals[p * 3 + 2] = n.z;
+        }
+    }
+
+    mesh.vertices.clear();
+    mesh.vertices.reserve(positionCount * MESH_VERTEX_FLOATS);
+    mesh.indices.resize(cornerCount);
+    CornerMap map(positionCount);
+    uint32_t vertexCount = 0;
+    for (size_t i = 0; i < cornerCount; ++i) {
+        const ObjCorner& corner = corners[i];
+        uint64_t key = ((uint64_t)(uint32_t)corner.position << 32) | (uint32_t)corner.normal;
+        uint32_t vertex = map.findOrInsert(key, vertexCount);
+        if (vertex == vertexCount) {
+            const float* p = &positions[corner.position * 3];
+            const float* n = corner.normal >= 0 ? &normals[corner.normal * 3] : &smoothNormals[corner.position * 3];
+            const float v[MESH_VERTEX_FLOATS] = {p[0], p[1], p[2], n[0], n[1], n[2]};
+            mesh.vertices.insert(mesh.vertices.end(), v, v + MESH_VERTEX_FLOATS);
+            ++vertexCount;
+        }
+        mesh.indices[i] = vertex;
+    }
+    mesh.computeBounds();
+
+    if (stats) {
+        stats->bytes = size;
+        stats->chunks = chunkCount;
+        stats->parseMs = (parsed - start) * 1000.0;
+        stats->dedupMs = (monotonicSeconds() - parsed) * 1000.0;
+        stats->positions = positionCount;
+        stats->normals = normalCount;
+        stats->corners = cornerCount;
+        stats->generatedNormals = missingNormals;
+    }
+    return true;
+}
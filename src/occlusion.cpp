@@ -0,0 +1,248 @@
+#include "occlusion.h"
+#include "job_system.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_USE_SSE 1
+#else
+#define OCCLUSION_USE_SSE 0
+#endif
+
+using namespace std;
+
+static const int BAND_ROWS = 8;          // rows per rasterization task
+static const float NEAR_W = 1e-3f;       // occluders/boxes reaching behind this are not used / not culled
+
+// Unit cube corner i: bit 0 = +x, bit 1 = +y, bit 2 = +z
+static glm::vec4 cubeCorner(int i) {
+    return glm::vec4((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f, 1.0f);
+}
+
+// Counter-clockwise seen from outside, so front faces have positive screen area
+static const int CUBE_TRIANGLES[12][3] = {
+    {4, 5, 7}, {4, 7, 6},   // +z
+    {1, 0, 2}, {1, 2, 3},   // -z
+    {5, 1, 3}, {5, 3, 7},   // +x
+    {0, 4, 6}, {0, 6, 2},   // -x
+    {6, 7, 3}, {6, 3, 2},   // +y
+    {0, 1, 5}, {0, 5, 4}    // -y
+};
+
+OcclusionBuffer::OcclusionBuffer()
+    : bufferWidth(0), bufferHeight(0), viewProj(1.0f), rasterizedTriangles(0)
+{
+}
+
+void OcclusionBuffer::init(int width, int height) {
+    bufferWidth = (max(4, width) + 3) & ~3;
+    bufferHeight = max(1, height);
+
+    levels.clear();
+    levelWidth.clear();
+    levelHeight.clear();
+    int w = bufferWidth, h = bufferHeight;
+    for (;;) {
+        levels.push_back(vector<float>((size_t)w * h, 1.0f));
+        levelWidth.push_back(w);
+        levelHeight.push_back(h);
+        if (w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+void OcclusionBuffer::begin(const glm::mat4& vp) {
+    viewProj = vp;
+    occluders.clear();
+    rasterizedTriangles = 0;
+    if (!levels.empty()) fill(levels[0].begin(), levels[0].end(), 1.0f);
+}
+
+void OcclusionBuffer::addOccluder(const glm::mat4& model) {
+    occluders.push_back(model);
+}
+
+void OcclusionBuffer::setupOccluder(int index, Triangle* out, int& count) const {
+    count = 0;
+    const glm::mat4 mvp = viewProj * occluders[index];
+
+    float sx[8], sy[8], sz[8];
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 clip = mvp * cubeCorner(i);
+        // Clipping is not worth it for an occluder; just skip anything crossing the near plane
+        if (clip.w < NEAR_W) return;
+        float invW = 1.0f / clip.w;
+        sx[i] = (clip.x * invW * 0.5f + 0.5f) * bufferWidth;
+        sy[i] = (clip.y * invW * 0.5f + 0.5f) * bufferHeight;
+        sz[i] = clip.z * invW * 0.5f + 0.5f;
+    }
+
+    for (int t = 0; t < 12; ++t) {
+        const int a = CUBE_TRIANGLES[t][0], b = CUBE_TRIANGLES[t][1], c = CUBE_TRIANGLES[t][2];
+        float area = (sx[b] - sx[a]) * (sy[c] - sy[a]) - (sx[c] - sx[a]) * (sy[b] - sy[a]);
+        if (area <= 0.0f) continue;
+
+        Triangle tri;
+        tri.x[0] = sx[a]; tri.x[1] = sx[b]; tri.x[2] = sx[c];
+        tri.y[0] = sy[a]; tri.y[1] = sy[b]; tri.y[2] = sy[c];
+        tri.z[0] = sz[a]; tri.z[1] = sz[b]; tri.z[2] = sz[c];
+        tri.minX = max(0, (int)floorf(min(sx[a], min(sx[b], sx[c]))));
+        tri.maxX = min(bufferWidth - 1, (int)floorf(max(sx[a], max(sx[b], sx[c]))));
+        tri.minY = max(0, (int)floorf(min(sy[a], min(sy[b], sy[c]))));
+        tri.maxY = min(bufferHeight - 1, (int)floorf(max(sy[a], max(sy[b], sy[c]))));
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY) continue;
+        out[count++] = tri;
+    }
+}
+
+void OcclusionBuffer::rasterize() {
+    if (levels.empty()) return;
+
+    const int count = (int)occluders.size();
+    triangles.resize((size_t)count * 12);
+    triangleCounts.resize(count);
+    jobSystem().parallelFor(count, 16, [&](int begin, int end) {
+        for (int o = begin; o < end; ++o) setupOccluder(o, &triangles[(size_t)o * 12], triangleCounts[o]);
+    });
+
+    rasterizedTriangles = 0;
+    for (int c : triangleCounts) rasterizedTriangles += c;
+
+    // Bands of rows are disjoint, so tasks never write the same pixel
+    const int bands = (bufferHeight + BAND_ROWS - 1) / BAND_ROWS;
+    jobSystem().parallelFor(bands, 1, [&](int begin, int end) {
+        for (int b = begin; b < end; ++b) {
+            rasterizeBand(b * BAND_ROWS, min(bufferHeight, (b + 1) * BAND_ROWS));
+        }
+    });
+
+    buildPyramid();
+}
+
+void OcclusionBuffer::rasterizeBand(int rowBegin, int rowEnd) {
+    float* depth = levels[0].data();
+
+    for (size_t o = 0; o < occluders.size(); ++o) {
+        for (int t = 0; t < triangleCounts[o]; ++t) {
+            const Triangle& tri = triangles[o * 12 + t];
+            const int y0 = max(tri.minY, rowBegin);
+            const int y1 = min(tri.maxY, rowEnd - 1);
+            if (y0 > y1) continue;
+
+            // Edge functions E(x, y) = A x + B y + C, positive inside
+            float A[3], B[3], C[3];
+            for (int e = 0; e < 3; ++e) {
+                int i = e, j = (e + 1) % 3;
+                A[e] = tri.y[i] - tri.y[j];
+                B[e] = tri.x[j] - tri.x[i];
+                C[e] = -(A[e] * tri.x[i] + B[e] * tri.y[i]);
+            }
+
+            // Depth is affine in screen space: weight each vertex by the opposite edge
+            const float invArea = 1.0f / (C[0] + C[1] + C[2]);
+            const float zA = (A[1] * tri.z[0] + A[2] * tri.z[1] + A[0] * tri.z[2]) * invArea;
+            const float zB = (B[1] * tri.z[0] + B[2] * tri.z[1] + B[0] * tri.z[2]) * invArea;
+            const float zC = (C[1] * tri.z[0] + C[2] * tri.z[1] + C[0] * tri.z[2]) * invArea;
+
+            const int x0 = tri.minX & ~3;
+            for (int y = y0; y <= y1; ++y) {
+                const float py = y + 0.5f;
+                float* row = depth + (size_t)y * bufferWidth;
+                int x = x0;
+#if OCCLUSION_USE_SSE
+                const __m128 px0 = _mm_add_ps(_mm_set1_ps((float)x0), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[0]), px0), _mm_set1_ps(B[0] * py + C[0]));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[1]), px0), _mm_set1_ps(B[1] * py + C[1]));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[2]), px0), _mm_set1_ps(B[2] * py + C[2]));
+                __m128 z  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px0), _mm_set1_ps(zB * py + zC));
+                const __m128 step0 = _mm_set1_ps(4.0f * A[0]);
+                const __m128 step1 = _mm_set1_ps(4.0f * A[1]);
+                const __m128 step2 = _mm_set1_ps(4.0f * A[2]);
+                const __m128 stepZ = _mm_set1_ps(4.0f * zA);
+                const __m128 zero = _mm_setzero_ps();
+                for (; x <= tri.maxX; x += 4) {
+                    // Strictly inside only: a pixel an occluder merely touches is not covered
+                    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(e0, zero), _mm_cmpgt_ps(e1, zero)),
+                                               _mm_cmpgt_ps(e2, zero));
+                    if (_mm_movemask_ps(inside)) {
+                        __m128 d = _mm_loadu_ps(row + x);
+                        __m128 nearer = _mm_min_ps(d, z);
+                        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, d)));
+                    }
+                    e0 = _mm_add_ps(e0, step0);
+                    e1 = _mm_add_ps(e1, step1);
+                    e2 = _mm_add_ps(e2, step2);
+                    z = _mm_add_ps(z, stepZ);
+                }
+#endif
+                for (; x <= tri.maxX; ++x) {
+                    const float px = x + 0.5f;
+                    if (A[0] * px + B[0] * py + C[0] > 0.0f &&
+                        A[1] * px + B[1] * py + C[1] > 0.0f &&
+                        A[2] * px + B[2] * py + C[2] > 0.0f) {
+                        row[x] = min(row[x], zA * px + zB * py + zC);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::buildPyramid() {
+    for (size_t l = 1; l < levels.size(); ++l) {
+        const vector<float>& src = levels[l - 1];
+        vector<float>& dst = levels[l];
+        const int sw = levelWidth[l - 1], sh = levelHeight[l - 1];
+        const int dw = levelWidth[l], dh = levelHeight[l];
+        for (int y = 0; y < dh; ++y) {
+            const int sy0 = 2 * y, sy1 = min(2 * y + 1, sh - 1);
+            for (int x = 0; x < dw; ++x) {
+                const int sx0 = 2 * x, sx1 = min(2 * x + 1, sw - 1);
+                dst[(size_t)y * dw + x] = max(max(src[(size_t)sy0 * sw + sx0], src[(size_t)sy0 * sw + sx1]),
+                                              max(src[(size_t)sy1 * sw + sx0], src[(size_t)sy1 * sw + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isOccluded(const Aabb& box) const {
+    if (levels.empty()) return false;
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 p((i & 1) ? box.max.x : box.min.x,
+                    (i & 2) ? box.max.y : box.min.y,
+                    (i & 4) ? box.max.z : box.min.z, 1.0f);
+        glm::vec4 clip = viewProj * p;
+        if (clip.w < NEAR_W) return false;
+        float invW = 1.0f / clip.w;
+        float sx = (clip.x * invW * 0.5f + 0.5f) * bufferWidth;
+        float sy = (clip.y * invW * 0.5f + 0.5f) * bufferHeight;
+        minX = min(minX, sx); maxX = max(maxX, sx);
+        minY = min(minY, sy); maxY = max(maxY, sy);
+        minZ = min(minZ, clip.z * invW * 0.5f + 0.5f);
+    }
+    if (minZ <= 0.0f) return false;
+
+    const int x0 = max(0, (int)floorf(minX)), x1 = min(bufferWidth - 1, (int)floorf(maxX));
+    const int y0 = max(0, (int)floorf(minY)), y1 = min(bufferHeight - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1) return false;
+
+    // Coarsest level at which the rectangle spans at most 2 x 2 texels
+    int level = 0;
+    while (level + 1 < (int)levels.size() &&
+           ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        ++level;
+    }
+
+    const vector<float>& hiz = levels[level];
+    const int w = levelWidth[level];
+    for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+            if (hiz[(size_t)y * w + x] >= minZ) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#include "pacing_test.h"
+#include "shader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+PacingTest::PacingTest() : program(0), vao(0), vbo(0), rectLoc(-1), colorLoc(-1) {
+}
+
+bool PacingTest::init() {
+    const float quad[] = {
+        0.0f, 0.0f,   1.0f, 0.0f,   1.0f, 1.0f,
+        1.0f, 1.0f,   0.0f, 1.0f,   0.0f, 0.0f
+    };
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    program = loadShaderProgram("shaders/pacing_vertex_shader.glsl", "shaders/pacing_fragment_shader.glsl");
+    rectLoc = glGetUniformLocation(program, "rect");
+    colorLoc = glGetUniformLocation(program, "color");
+    return program != 0;
+}
+
+void PacingTest::drawRect(float x, float y, float w, float h, float r, float g, float b) const {
+    glUniform4f(rectLoc, x, y, w, h);
+    glUniform3f(colorLoc, r, g, b);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void PacingTest::draw(const FramePacer& pacer, int width, int height, double time) const {
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+
+    // Sweeping bar, same motion as the GLFW tearing test (NDC units)
+    float position = cosf((float)time * 4.0f) * 0.75f;
+    drawRect(position - 0.25f, -0.5f, 0.5f, 1.5f, 1.0f, 1.0f, 1.0f);
+
+    // Frame interval graph along the bottom quarter, scaled so the target sits at mid-height
+    const vector<float>& history = pacer.history();
+    double target = pacer.targetFps() > 0.0 ? 1000.0 / pacer.targetFps() : 0.0;
+    if (target <= 0.0 && !history.empty()) {
+        double sum = 0.0;
+        for (float ms : history) sum += ms;
+        target = sum / history.size();
+    }
+    drawRect(-1.0f, -1.0f, 2.0f, 0.5f, 0.1f, 0.1f, 0.1f);
+    if (target > 0.0 && !history.empty()) {
+        const float barWidth = 2.0f / max((size_t)240, history.size());
+        for (size_t i = 0; i < history.size(); ++i) {
+            float h = (float)min(1.0, history[i] / (2.0 * target)) * 0.5f;
+            bool onTime = fabs(history[i] - target) <= 0.1 * target;
+            drawRect(-1.0f + i * barWidth, -1.0f, barWidth * 0.8f, h,
+                     onTime ? 0.2f : 0.9f, onTime ? 0.8f : 0.2f, 0.2f);
+        }
+        drawRect(-1.0f, -0.75f, 2.0f, 0.005f, 0.6f, 0.6f, 0.6f);
+    }
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void PacingTest::updateTitle(GLFWwindow* window, const FramePacer& pacer) const {
+    char title[256];
+    snprintf(title, sizeof(title), "Tearing detector (interval %i%s, %0.1f Hz, target %0.1f Hz)",
+             pacer.swapInterval(),
+             (pacer.supportsSwapTear() && pacer.swapInterval() < 0) ? " (swap tear)" : "",
+             pacer.measuredFps(), pacer.targetFps());
+    glfwSetWindowTitle(window, title);
+}
+
+void PacingTest::destroy() {
+    glDeleteProgram(program);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    program = vao = vbo = 0;
+}
@@ -0,0 +1,161 @@
+#include "palette.h"
+#include "cube.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// Merged robot mesh vertex: cube vertex plus the part it belongs to
+struct PaletteVertex {
+    float position[3];
+    float normal[3];
+    GLint part;
+};
+
+PaletteCrowdRenderer::PaletteCrowdRenderer()
+    : program(0), depthProgram(0), vao(0), meshVBO(0), paletteTexture(0),
+      vertexCount(0), partCount(0), robotCount(0), paletteBase(0)
+{
+}
+
+bool PaletteCrowdRenderer::init(const StreamBuffer& stream) {
+    static_assert(MAX_ROBOT_PARTS <= MAX_PARTS, "palette shader color table too small");
+
+    // One cube per part of the active rig, tagged with the part index
+    partCount = robotPartCount();
+    vector<PaletteVertex> mesh;
+    const float* cube = getCubeVertices();
+    for (int p = 0; p < partCount; ++p) {
+        for (int v = 0; v < CUBE_VERTEX_COUNT; ++v) {
+            const float* src = cube + v * CUBE_VERTEX_FLOATS;
+            PaletteVertex pv;
+            for (int k = 0; k < 3; ++k) {
+                pv.position[k] = src[k];
+                pv.normal[k] = src[3 + k];
+            }
+            pv.part = p;
+            mesh.push_back(pv);
+        }
+    }
+    vertexCount = (int)mesh.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &meshVBO);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+    glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(PaletteVertex), mesh.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PaletteVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PaletteVertex), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(2, 1, GL_INT, sizeof(PaletteVertex), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (stream.capacity() / (GLsizeiptr)sizeof(glm::vec4) > maxTexels) {
+        cerr << "Warning: stream buffer exceeds the texture buffer limit (" << maxTexels
+             << " texels); palettes past it will read zeros" << endl;
+    }
+
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, stream.buffer());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    updatePrograms();
+    const GLuint programs[2] = {program, depthProgram};
+    for (GLuint p : programs) {
+        glUseProgram(p);
+        setUniform(p, "palette", 0);
+        setUniform(p, "partCount", partCount);
+        glUniform3fv(glGetUniformLocation(p, "partColors"), partCount, &robotPartColor(0)[0]);
+    }
+
+    return program != 0 && depthProgram != 0;
+}
+
+void PaletteCrowdRenderer::update(const Crowd& crowd, const FrameVector<int>& visible, StreamBuffer& stream) {
+    double start = monotonicSeconds();
+
+    StreamAllocation alloc = stream.allocate((GLsizeiptr)visible.size() * partCount * 3 * sizeof(glm::vec4),
+                                             sizeof(glm::vec4));
+    if (!alloc.ptr) {
+        robotCount = 0;
+        return;
+    }
+    robotCount = (int)visible.size();
+    paletteBase = (int)(alloc.offset / (GLintptr)sizeof(glm::vec4));
+    glm::vec4* rows = (glm::vec4*)alloc.ptr;
+
+    jobSystem().parallelFor(robotCount, 64, [&](int begin, int end) {
+        glm::mat4 parts[MAX_ROBOT_PARTS];
+        for (int k = begin; k < end; ++k) {
+            int i = visible[k];
+            computeRobotParts(crowd.poses[i], crowd.rootMatrix(i), parts);
+            for (int p = 0; p < partCount; ++p) {
+                packMatrixRows(parts[p], &rows[((size_t)k * partCount + p) * 3]);
+            }
+        }
+    });
+
+    stream.commit(alloc);
+    frameStats().add(STAT_CPU_ANIM_MS, (monotonicSeconds() - start) * 1000.0);
+}
+
+void PaletteCrowdRenderer::draw(const glm::mat4& view,
+                                const glm::mat4& proj,
+                                const glm::vec3& camPos,
+                                const Scene& scene) const
+{
+    if (robotCount == 0) return;
+
+    glUseProgram(program);
+    setUniform(program, "view", view);
+    setUniform(program, "projection", proj);
+    setUniform(program, "camPos", camPos);
+    setUniform(program, "lightPos", scene.lightPosition);
+    setUniform(program, "lightCol", scene.lightColor);
+    setUniform(program, "paletteBase", paletteBase);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, robotCount);
+    glBindVertexArray(0);
+}
+
+void PaletteCrowdRenderer::drawDepth(const glm::mat4& view, const glm::mat4& proj) const {
+    if (robotCount == 0) return;
+
+    glUseProgram(depthProgram);
+    setUniform(depthProgram, "view", view);
+    setUniform(depthProgram, "projection", proj);
+    setUniform(depthProgram, "paletteBase", paletteBase);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, robotCount);
+    glBindVertexArray(0);
+}
+
+void PaletteCrowdRenderer::updatePrograms() {
+    // Both programs belong to the shader variant cache
+    program = shaderVariant("shaders/palette_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_VERTEX_COLOR);
+    depthProgram = shaderVariant("shaders/palette_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_DEPTH_ONLY);
+}
+
+void PaletteCrowdRenderer::destroy() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &meshVBO);
+    glDeleteTextures(1, &paletteTexture);
+    program = depthProgram = vao = meshVBO = paletteTexture = 0;
+    vertexCount = robotCount = 0;
+}
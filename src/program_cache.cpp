@@ -0,0 +1,170 @@
+#include "program_cache.h"
+#include "gl_caps.h"
+#include "hash.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+using namespace std;
+
+static bool gEnabled = false;
+static string gDirectory;
+static uint64_t gDriverHash = 0;
+static ProgramLoadStats gStats;
+
+static const char CACHE_MAGIC[4] = {'G', 'L', 'P', 'B'};
+static const uint32_t CACHE_VERSION = 1;
+
+// File header; the binary follows
+struct CacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static bool makeDirectory(const string& path) {
+#ifdef _WIN32
+    int rc = _mkdir(path.c_str());
+#else
+    int rc = mkdir(path.c_str(), 0755);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+static string cachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return gDirectory + "/" + name;
+}
+
+static uint64_t hashString(const char* s, uint64_t seed) {
+    // Separator keeps ("ab", "c") and ("a", "bc") apart
+    uint64_t h = hashBytes(s, s ? strlen(s) : 0, seed);
+    return hashBytes("\n", 1, h);
+}
+
+bool initProgramCache(const char* directory) {
+    gEnabled = false;
+    if (!directory || !directory[0]) return false;
+
+    if (!glCaps().programBinary) {
+        cout << "Program cache: disabled (no GL_ARB_get_program_binary)" << endl;
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        cout << "Program cache: disabled (driver exposes no binary formats)" << endl;
+        return false;
+    }
+    if (!makeDirectory(directory)) {
+        cerr << "Warning: cannot create program cache directory " << directory << endl;
+        return false;
+    }
+
+    gDirectory = directory;
+    gDriverHash = hashString((const char*)glGetString(GL_VENDOR), hashBytes(&CACHE_VERSION, sizeof(CACHE_VERSION)));
+    gDriverHash = hashString((const char*)glGetString(GL_RENDERER), gDriverHash);
+    gDriverHash = hashString((const char*)glGetString(GL_VERSION), gDriverHash);
+    gEnabled = true;
+    cout << "Program cache: " << gDirectory << endl;
+    return true;
+}
+
+bool programCacheEnabled() {
+    return gEnabled;
+}
+
+uint64_t programCacheKey(const string& vertexSource, const string& fragmentSource, const string& defines) {
+    uint64_t h = hashString(vertexSource.c_str(), gDriverHash);
+    h = hashString(fragmentSource.c_str(), h);
+    return hashString(defines.c_str(), h);
+}
+
+GLuint loadCachedProgram(uint64_t key) {
+    if (!gEnabled) return 0;
+
+    string path = cachePath(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return 0;
+
+    CacheHeader header;
+    vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+           && header.version == CACHE_VERSION
+           && header.key == key;
+    if (ok) {
+        binary.resize(header.length);
+        ok = header.length > 0 && fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    GLint linked = GL_FALSE;
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        // Truncated file or a binary from a driver build the key did not capture
+        if (program) glDeleteProgram(program);
+        remove(path.c_str());
+        ++gStats.rejected;
+        return 0;
+    }
+    return program;
+}
+
+void storeCachedProgram(uint64_t key, GLuint program) {
+    if (!gEnabled) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return;
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = (uint32_t)written;
+
+    // Write then rename, so a concurrent launch never reads a partial file
+    string path = cachePath(key);
+    string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        cerr << "Warning: could not write program cache entry " << path << endl;
+    }
+}
+
+void recordProgramLoad(double ms, bool fromCache) {
+    ++gStats.programs;
+    if (fromCache) ++gStats.cacheHits;
+    gStats.ms += ms;
+}
+
+const ProgramLoadStats& programLoadStats() {
+    return gStats;
+}
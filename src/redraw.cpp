@@ -0,0 +1,104 @@
+#include "redraw.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+using namespace std;
+
+RedrawScheduler::RedrawScheduler()
+    : enabled(false), inputPending(true), keysHeld(0), lastState(0),
+      previousFramebufferSize(NULL), reportInterval(5.0), windowStart(-1.0),
+      cpuStart(0.0), iterations(0), redraws(0)
+{
+    fill(keyDown, keyDown + GLFW_KEY_LAST + 1, false);
+}
+
+void RedrawScheduler::setReportInterval(double seconds) {
+    reportInterval = seconds > 0.0 ? seconds : 5.0;
+}
+
+void RedrawScheduler::attach(GLFWwindow* window) {
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    glfwSetWindowFocusCallback(window, focusCallback);
+    previousFramebufferSize = glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+}
+
+bool RedrawScheduler::shouldDraw(uint64_t stateHash, bool animating) {
+    bool draw = !enabled || animating || inputPending || keysHeld > 0 || stateHash != lastState;
+    inputPending = false;
+    lastState = stateHash;
+
+    ++iterations;
+    if (draw) ++redraws;
+    if (enabled) report(glfwGetTime());
+    return draw;
+}
+
+void RedrawScheduler::waitForEvents() {
+    double now = glfwGetTime();
+    double untilReport = windowStart < 0.0 ? reportInterval : windowStart + reportInterval - now;
+    glfwWaitEventsTimeout(max(0.01, untilReport));
+}
+
+void RedrawScheduler::report(double now) {
+    double cpu = (double)clock() / CLOCKS_PER_SEC;
+    if (windowStart < 0.0) {
+        windowStart = now;
+        cpuStart = cpu;
+        iterations = redraws = 0;
+        return;
+    }
+
+    double elapsed = now - windowStart;
+    if (elapsed < reportInterval) return;
+
+    printf("[on-demand] %.1f redraws/s, %.1f wakeups/s, cpu %.1f%%\n",
+           redraws / elapsed, iterations / elapsed, 100.0 * (cpu - cpuStart) / elapsed);
+    fflush(stdout);
+    windowStart = now;
+    cpuStart = cpu;
+    iterations = redraws = 0;
+}
+
+void RedrawScheduler::keyCallback(GLFWwindow* window, int key, int, int action, int) {
+    RedrawScheduler* self = (RedrawScheduler*)glfwGetWindowUserPointer(window);
+    self->inputPending = true;
+    if (key < 0 || key > GLFW_KEY_LAST) return;
+    if (action == GLFW_PRESS && !self->keyDown[key]) {
+        self->keyDown[key] = true;
+        ++self->keysHeld;
+    } else if (action == GLFW_RELEASE && self->keyDown[key]) {
+        self->keyDown[key] = false;
+        --self->keysHeld;
+    }
+}
+
+void RedrawScheduler::mouseButtonCallback(GLFWwindow* window, int, int, int) {
+    ((RedrawScheduler*)glfwGetWindowUserPointer(window))->inputPending = true;
+}
+
+void RedrawScheduler::scrollCallback(GLFWwindow* window, double, double) {
+    ((RedrawScheduler*)glfwGetWindowUserPointer(window))->inputPending = true;
+}
+
+void RedrawScheduler::refreshCallback(GLFWwindow* window) {
+    ((RedrawScheduler*)glfwGetWindowUserPointer(window))->inputPending = true;
+}
+
+void RedrawScheduler::focusCallback(GLFWwindow* window, int) {
+    // Keys released while another window had focus never report their release
+    RedrawScheduler* self = (RedrawScheduler*)glfwGetWindowUserPointer(window);
+    fill(self->keyDown, self->keyDown + GLFW_KEY_LAST + 1, false);
+    self->keysHeld = 0;
+    self->inputPending = true;
+}
+
+void RedrawScheduler::framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    RedrawScheduler* self = (RedrawScheduler*)glfwGetWindowUserPointer(window);
+    self->inputPending = true;
+    if (self->previousFramebufferSize) self->previousFramebufferSize(window, width, height);
+}
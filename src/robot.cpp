@@ -1,27 +1,17 @@
 #include "robot.h"
+#include "robot_description.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 using glm::mat4;
 using glm::vec3;
 
 // Joint state
-struct RobotJoints {
-    float neck = 0.0f;
-    float shoulderL = 0.0f, elbowL = 0.0f;
-    float shoulderR = 0.0f, elbowR = 0.0f;
-    float hipL = 0.0f, kneeL = 0.0f;
-    float hipR = 0.0f, kneeR = 0.0f;
-    float torsoRotation = 0.0f;
-};
-static RobotJoints gJ;
+static RobotPose gJ;
 
 // Matrix helpers
 static mat4 I()                      { return mat4(1.0f); }
 static mat4 T(const vec3& t)         { return glm::translate(I(), t); }
 static mat4 S(const vec3& s)         { return glm::scale(I(), s); }
-static mat4 Rx(float deg)            { return glm::rotate(I(), glm::radians(deg), vec3(1,0,0)); }
-static mat4 Ry(float deg)            { return glm::rotate(I(), glm::radians(deg), vec3(0,1,0)); }
-static mat4 Rz(float deg)            { return glm::rotate(I(), glm::radians(deg), vec3(0,0,1)); }
 
 static void setMat4(GLuint program, const char* name, const mat4& M) {
     GLint loc = glGetUniformLocation(program, name);
@@ -48,151 +38,152 @@ static void drawCube(GLuint program,
     glDrawArrays(GL_TRIANGLES, 0, 36);
 }
 
-// Robot body part sizes
-static const vec3 TORSO = {1.0f, 1.6f, 0.5f};
-static const vec3 HEAD  = {0.5f, 0.5f, 0.5f};
-static const vec3 UARM  = {0.35f, 0.9f, 0.35f};
-static const vec3 FARM  = {0.30f, 0.9f, 0.30f};
-static const vec3 THIGH = {0.45f, 1.0f, 0.45f};
-static const vec3 SHIN  = {0.40f, 1.0f, 0.40f};
+// Active rig, and its part colors in one array for the renderers' color uniforms
+static RobotDescription gRobot;
+static vec3 gPartColors[MAX_ROBOT_PARTS];
 
-void updateJointsFromInput(GLFWwindow* window, float dt)
+void setRobotDescription(const RobotDescription& description)
 {
-    const float s = 60.0f * dt;
+    gRobot = description;
+    for (int p = 0; p < MAX_ROBOT_PARTS; ++p) {
+        const float* c = gRobot.links[p].color;
+        gPartColors[p] = p < gRobot.linkCount ? vec3(c[0], c[1], c[2]) : vec3(0.0f);
+    }
+}
 
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) gJ.neck    += s;
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) gJ.neck    -= s;
+// Starts out as the built-in rig
+static struct DefaultRobotInit {
+    DefaultRobotInit() { setRobotDescription(defaultRobotDescription()); }
+} gDefaultRobotInit;
 
-    // Arms
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) gJ.shoulderL += s;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) gJ.shoulderL -= s;
-    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) gJ.elbowL    += s;
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) gJ.elbowL    -= s;
+const RobotDescription& robotDescription()
+{
+    return gRobot;
+}
 
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) gJ.shoulderR += s;
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) gJ.shoulderR -= s;
-    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) gJ.elbowR    += s;
-    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) gJ.elbowR    -= s;
+int robotPartCount()
+{
+    return gRobot.linkCount;
+}
 
-    // Legs
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) gJ.hipL  += s;
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) gJ.hipL  -= s;
-    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) gJ.kneeL += s;
-    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) gJ.kneeL -= s;
+int robotJointCount()
+{
+    return gRobot.jointCount;
+}
 
-    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) gJ.hipR  += s;
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) gJ.hipR  -= s;
-    if (glfwGetKey(window, GLFW_KEY_COMMA) == GLFW_PRESS) gJ.kneeR += s;
-    if (glfwGetKey(window, GLFW_KEY_PERIOD) == GLFW_PRESS) gJ.kneeR -= s;
+// Clamp the angles of joints with limits
+static float limitAngle(const RobotLink& link, float deg)
+{
+    return link.lower <= link.upper ? glm::clamp(deg, link.lower, link.upper) : deg;
 }
 
-void drawRobot(GLuint program,
-               GLuint cubeVAO,
-               const mat4& view,
-               const mat4& proj)
+static void clampToLimits(RobotPose& pose)
 {
-    mat4 torsoBase = T({0, 1.0f, 0}) * Ry(gJ.torsoRotation);
+    for (int i = 0; i < gRobot.linkCount; ++i) {
+        const RobotLink& link = gRobot.links[i];
+        if (link.joint >= 0) pose[link.joint] = limitAngle(link, pose[link.joint]);
+    }
+}
 
-    // Torso
-    mat4 torsoM = torsoBase * S(TORSO);
-    drawCube(program, cubeVAO, torsoM, view, proj, {0.75f, 0.75f, 0.85f});
+void updateJointsFromInput(GLFWwindow* window, float dt)
+{
+    const float s = 60.0f * dt;
 
-    // Head
-    mat4 neckBase = torsoBase * T({0, TORSO.y * 0.5f, 0});
-    mat4 headM = neckBase * Ry(gJ.neck) * T({0, HEAD.y * 0.5f, 0}) * S(HEAD);
-    drawCube(program, cubeVAO, headM, view, proj, {0.9f, 0.8f, 0.7f});
+    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) gJ[JOINT_NECK] += s;
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) gJ[JOINT_NECK] -= s;
 
     // Arms
-    const float shoulderY = TORSO.y * 0.35f;
-    const float shoulderX = (TORSO.x * 0.5f) + (UARM.x * 0.5f) * 0.9f;
-
-    // Left arm
-    {
-        mat4 shoulder = torsoBase * T({-shoulderX, shoulderY, 0});
-        mat4 upper = shoulder
-                   * Rz(gJ.shoulderL)
-                   * T({0, -UARM.y * 0.5f, 0})
-                   * S(UARM);
-        drawCube(program, cubeVAO, upper, view, proj, {0.8f, 0.3f, 0.3f});
-
-        mat4 elbowBase = shoulder * Rz(gJ.shoulderL) * T({0, -UARM.y, 0});
-        mat4 fore = elbowBase
-                  * Rz(gJ.elbowL)
-                  * T({0, -FARM.y * 0.5f, 0})
-                  * S(FARM);
-        drawCube(program, cubeVAO, fore, view, proj, {0.85f, 0.4f, 0.4f});
-    }
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) gJ[JOINT_SHOULDER_L] += s;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) gJ[JOINT_SHOULDER_L] -= s;
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) gJ[JOINT_ELBOW_L]    += s;
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) gJ[JOINT_ELBOW_L]    -= s;
 
-    // Right arm
-    {
-        mat4 shoulder = torsoBase * T({+shoulderX, shoulderY, 0});
-        mat4 upper = shoulder
-                   * Rz(-gJ.shoulderR)
-                   * T({0, -UARM.y * 0.5f, 0})
-                   * S(UARM);
-        drawCube(program, cubeVAO, upper, view, proj, {0.3f, 0.3f, 0.8f});
-
-        mat4 elbowBase = shoulder * Rz(-gJ.shoulderR) * T({0, -UARM.y, 0});
-        mat4 fore = elbowBase
-                  * Rz(-gJ.elbowR)
-                  * T({0, -FARM.y * 0.5f, 0})
-                  * S(FARM);
-        drawCube(program, cubeVAO, fore, view, proj, {0.4f, 0.4f, 0.85f});
-    }
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) gJ[JOINT_SHOULDER_R] += s;
+    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) gJ[JOINT_SHOULDER_R] -= s;
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) gJ[JOINT_ELBOW_R]    += s;
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) gJ[JOINT_ELBOW_R]    -= s;
 
     // Legs
-    const float hipY = 1.0f - TORSO.y * 0.5f;
-    const float hipX = TORSO.x * 0.3f;
-
-    // Left leg
-    {
-        mat4 hip = T({-hipX, hipY, 0});
-        mat4 thigh = hip
-                   * Rx(gJ.hipL)
-                   * T({0, -THIGH.y * 0.5f, 0})
-                   * S(THIGH);
-        drawCube(program, cubeVAO, thigh, view, proj, {0.3f, 0.7f, 0.3f});
-
-        mat4 kneeBase = hip * Rx(gJ.hipL) * T({0, -THIGH.y, 0});
-        mat4 shin = kneeBase
-                  * Rx(gJ.kneeL)
-                  * T({0, -SHIN.y * 0.5f, 0})
-                  * S(SHIN);
-        drawCube(program, cubeVAO, shin, view, proj, {0.35f, 0.8f, 0.35f});
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) gJ[JOINT_HIP_L]  += s;
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) gJ[JOINT_HIP_L]  -= s;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) gJ[JOINT_KNEE_L] += s;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) gJ[JOINT_KNEE_L] -= s;
+
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) gJ[JOINT_HIP_R]  += s;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) gJ[JOINT_HIP_R]  -= s;
+    if (glfwGetKey(window, GLFW_KEY_COMMA) == GLFW_PRESS) gJ[JOINT_KNEE_R] += s;
+    if (glfwGetKey(window, GLFW_KEY_PERIOD) == GLFW_PRESS) gJ[JOINT_KNEE_R] -= s;
+
+    clampToLimits(gJ);
+}
+
+// Forward kinematics over the active rig: a link's frame is its parent's frame, moved to the
+// joint and turned about the joint axis; the part is the link's box in that frame
+void computeRobotParts(const RobotPose& pose, const mat4& root, mat4 parts[MAX_ROBOT_PARTS])
+{
+    mat4 frames[MAX_ROBOT_PARTS];
+    for (int i = 0; i < gRobot.linkCount; ++i) {
+        const int l = gRobot.order[i];
+        const RobotLink& link = gRobot.links[l];
+        mat4 frame = (link.parent < 0 ? root : frames[link.parent]) * T(vec3(link.origin[0], link.origin[1], link.origin[2]));
+        if (link.joint >= 0) {
+            frame = frame * glm::rotate(I(), glm::radians(limitAngle(link, pose[link.joint])),
+                                        vec3(link.axis[0], link.axis[1], link.axis[2]));
+        }
+        frames[l] = frame;
+        parts[l] = frame
+                 * T(vec3(link.visualOffset[0], link.visualOffset[1], link.visualOffset[2]))
+                 * S(vec3(link.visualSize[0], link.visualSize[1], link.visualSize[2]));
     }
+}
+
+const vec3& robotPartColor(int part)
+{
+    return gPartColors[part];
+}
+
+const RobotPose& getRobotPose()
+{
+    return gJ;
+}
+
+void drawRobotPose(GLuint program,
+                   GLuint cubeVAO,
+                   const RobotPose& pose,
+                   const mat4& root,
+                   const mat4& view,
+                   const mat4& proj)
+{
+    mat4 parts[MAX_ROBOT_PARTS];
+    computeRobotParts(pose, root, parts);
 
-    // Right leg
-    {
-        mat4 hip = T({+hipX, hipY, 0});
-        mat4 thigh = hip
-                   * Rz(-gJ.hipR)
-                   * T({0, -THIGH.y * 0.5f, 0})
-                   * S(THIGH);
-        drawCube(program, cubeVAO, thigh, view, proj, {0.2f, 0.65f, 0.2f});
-
-        mat4 kneeBase = hip * Rz(-gJ.hipR) * T({0, -THIGH.y, 0});
-        mat4 shin = kneeBase
-                  * Rz(-gJ.kneeR)
-                  * T({0, -SHIN.y * 0.5f, 0})
-                  * S(SHIN);
-        drawCube(program, cubeVAO, shin, view, proj, {0.25f, 0.7f, 0.25f});
+    for (int i = 0; i < gRobot.linkCount; ++i) {
+        drawCube(program, cubeVAO, parts[i], view, proj, robotPartColor(i));
     }
 }
 
+void drawRobot(GLuint program,
+               GLuint cubeVAO,
+               const mat4& view,
+               const mat4& proj)
+{
+    drawRobotPose(program, cubeVAO, gJ, I(), view, proj);
+}
+
 void setLeftLeg(float hipDeg, float kneeDeg) {
-    gJ.hipL  = hipDeg;
-    gJ.kneeL = kneeDeg;
+    gJ[JOINT_HIP_L]  = hipDeg;
+    gJ[JOINT_KNEE_L] = kneeDeg;
 }
 
 void setArms(float leftShoulderDeg, float rightShoulderDeg) {
-    gJ.shoulderL = leftShoulderDeg;
-    gJ.shoulderR = rightShoulderDeg;
+    gJ[JOINT_SHOULDER_L] = leftShoulderDeg;
+    gJ[JOINT_SHOULDER_R] = rightShoulderDeg;
 }
 
 void setHead(float neckDeg) {
-    gJ.neck = neckDeg;
+    gJ[JOINT_NECK] = neckDeg;
 }
 
 void setTorsoRotation(float rotationDeg) {
-    gJ.torsoRotation = rotationDeg;
+    gJ[JOINT_TORSO] = rotationDeg;
 }
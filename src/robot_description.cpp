@@ -0,0 +1,523 @@
+#include "robot_description.h"
+#include "embedded_assets.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+using namespace std;
+
+static const char* JOINT_NAMES[JOINT_COUNT] = {
+    "neck", "shoulder_l", "elbow_l", "shoulder_r", "elbow_r",
+    "hip_l", "knee_l", "hip_r", "knee_r", "torso",
+};
+
+const char* robotJointName(int joint) {
+    const RobotDescription& robot = robotDescription();
+    return joint >= 0 && joint < robot.jointCount ? robot.jointNames[joint] : "fixed";
+}
+
+// Every description starts with the standard channels
+static void addStandardChannels(RobotDescription& robot) {
+    for (int c = 0; c < JOINT_COUNT; ++c) {
+        snprintf(robot.jointNames[c], sizeof(robot.jointNames[c]), "%s", JOINT_NAMES[c]);
+    }
+    robot.jointCount = JOINT_COUNT;
+}
+
+static int findChannel(const RobotDescription& robot, const string& name) {
+    for (int c = 0; c < robot.jointCount; ++c) {
+        if (name == robot.jointNames[c]) return c;
+    }
+    return -1;
+}
+
+// --- built-in rig ---
+
+static void setVec(float out[3], float x, float y, float z) {
+    out[0] = x; out[1] = y; out[2] = z;
+}
+
+static void addLink(RobotDescription& robot, const char* name, int parent, int joint,
+                    float ox, float oy, float oz, float ax, float ay, float az,
+                    float offsetY, float sx, float sy, float sz, float r, float g, float b) {
+    RobotLink& link = robot.links[robot.linkCount];
+    memset(&link, 0, sizeof(link));
+    snprintf(link.name, sizeof(link.name), "%s", name);
+    link.parent = parent;
+    link.joint = joint;
+    setVec(link.origin, ox, oy, oz);
+    setVec(link.axis, ax, ay, az);
+    link.lower = 1.0f;    // no limits
+    link.upper = -1.0f;
+    setVec(link.visualOffset, 0.0f, offsetY, 0.0f);
+    setVec(link.visualSize, sx, sy, sz);
+    setVec(link.color, r, g, b);
+    robot.order[robot.linkCount] = robot.linkCount;
+    ++robot.linkCount;
+}
+
+static RobotDescription makeDefaultRobot() {
+    RobotDescription robot;
+    memset(&robot, 0, sizeof(robot));
+    snprintf(robot.name, sizeof(robot.name), "default");
+    addStandardChannels(robot);
+
+    // Shoulders sit 35% up the torso, just outside it; hips hang from the root, not the torso
+    const float shoulderX = 0.5f + 0.175f * 0.9f;
+    addLink(robot, "torso",       -1, JOINT_TORSO,      0.0f, 1.0f, 0.0f,       0, 1, 0,  0.0f,   1.0f, 1.6f, 0.5f,    0.75f, 0.75f, 0.85f);
+    addLink(robot, "head",         0, JOINT_NECK,       0.0f, 0.8f, 0.0f,       0, 1, 0,  0.25f,  0.5f, 0.5f, 0.5f,    0.9f,  0.8f,  0.7f);
+    addLink(robot, "upper_arm_l",  0, JOINT_SHOULDER_L, -shoulderX, 0.56f, 0.0f, 0, 0, 1, -0.45f, 0.35f, 0.9f, 0.35f, 0.8f,  0.3f,  0.3f);
+    addLink(robot, "forearm_l",    2, JOINT_ELBOW_L,    0.0f, -0.9f, 0.0f,      0, 0, 1, -0.45f, 0.30f, 0.9f, 0.30f,  0.85f, 0.4f,  0.4f);
+    addLink(robot, "upper_arm_r",  0, JOINT_SHOULDER_R, shoulderX, 0.56f, 0.0f, 0, 0, -1, -0.45f, 0.35f, 0.9f, 0.35f, 0.3f,  0.3f,  0.8f);
+    addLink(robot, "forearm_r",    4, JOINT_ELBOW_R,    0.0f, -0.9f, 0.0f,      0, 0, -1, -0.45f, 0.30f, 0.9f, 0.30f, 0.4f,  0.4f,  0.85f);
+    addLink(robot, "thigh_l",     -1, JOINT_HIP_L,      -0.3f, 0.2f, 0.0f,      1, 0, 0, -0.5f,  0.45f, 1.0f, 0.45f,  0.3f,  0.7f,  0.3f);
+    addLink(robot, "shin_l",       6, JOINT_KNEE_L,     0.0f, -1.0f, 0.0f,      1, 0, 0, -0.5f,  0.40f, 1.0f, 0.40f,  0.35f, 0.8f,  0.35f);
+    addLink(robot, "thigh_r",     -1, JOINT_HIP_R,      0.3f, 0.2f, 0.0f,       0, 0, -1, -0.5f, 0.45f, 1.0f, 0.45f,  0.2f,  0.65f, 0.2f);
+    addLink(robot, "shin_r",       8, JOINT_KNEE_R,     0.0f, -1.0f, 0.0f,      0, 0, -1, -0.5f, 0.40f, 1.0f, 0.40f,  0.25f, 0.7f,  0.25f);
+    return robot;
+}
+
+const RobotDescription& defaultRobotDescription() {
+    static const RobotDescription robot = makeDefaultRobot();
+    return robot;
+}
+
+// --- JSON ---
+
+// Just enough JSON for description files: parsed into a tree, numbers as doubles
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+    double number = 0.0;
+    string text;
+    vector<JsonValue> items;
+    vector<pair<string, JsonValue>> members;
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return NULL;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* text, size_t size) : p(text), begin(text), end(text + size), error(NULL) {}
+
+    bool parse(JsonValue& out) {
+        if (!value(out, 0)) return false;
+        skipSpace();
+        return p == end || fail("trailing characters");
+    }
+
+    // Line of the error, for messages
+    int line() const {
+        int n = 1;
+        for (const char* c = begin; c < p; ++c) n += *c == '\n';
+        return n;
+    }
+    const char* message() const { return error; }
+
+private:
+    bool fail(const char* why) {
+        if (!error) error = why;
+        return false;
+    }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+    }
+
+    bool literal(const char* word) {
+        size_t length = strlen(word);
+        if ((size_t)(end - p) < length || memcmp(p, word, length) != 0) return fail("unexpected character");
+        p += length;
+        return true;
+    }
+
+    bool quoted(string& out) {
+        ++p;   // opening quote
+        while (p < end && *p != '"') {
+            char c = *p++;
+            if (c == '\\') {
+                if (p >= end) break;
+                c = *p++;
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case '"': case '\\': case '/': break;
+                    default: return fail("unsupported escape in string");
+                }
+            }
+            out += c;
+        }
+        if (p >= end) return fail("unterminated string");
+        ++p;
+        return true;
+    }
+
+    bool value(JsonValue& out, int depth) {
+        if (depth > 64) return fail("nested too deeply");
+        skipSpace();
+        if (p >= end) return fail("unexpected end of file");
+        switch (*p) {
+            case '{': {
+                out.type = JsonValue::OBJECT;
+                ++p;
+                skipSpace();
+                if (p < end && *p == '}') { ++p; return true; }
+                for (;;) {
+                    skipSpace();
+                    if (p >= end || *p != '"') return fail("expected a key");
+                    out.members.push_back(make_pair(string(), JsonValue()));
+                    if (!quoted(out.members.back().first)) return false;
+                    skipSpace();
+                    if (p >= end || *p != ':') return fail("expected ':'");
+                    ++p;
+                    if (!value(out.members.back().second, depth + 1)) return false;
+                    skipSpace();
+                    if (p < end && *p == ',') { ++p; continue; }
+                    if (p < end && *p == '}') { ++p; return true; }
+                    return fail("expected ',' or '}'");
+                }
+            }
+            case '[': {
+                out.type = JsonValue::ARRAY;
+                ++p;
+                skipSpace();
+                if (p < end && *p == ']') { ++p; return true; }
+                for (;;) {
+                    out.items.push_back(JsonValue());
+                    if (!value(out.items.back(), depth + 1)) return false;
+                    skipSpace();
+                    if (p < end && *p == ',') { ++p; continue; }
+                    if (p < end && *p == ']') { ++p; return true; }
+                    return fail("expected ',' or ']'");
+                }
+            }
+            case '"':
+                out.type = JsonValue::STRING;
+                return quoted(out.text);
+            case 't':
+                out.type = JsonValue::BOOLEAN;
+                out.number = 1.0;
+                return literal("true");
+            case 'f':
+                out.type = JsonValue::BOOLEAN;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default: {
+                // strtod needs a terminated string; numbers are short
+                char buffer[64];
+                size_t length = 0;
+                while (p + length < end && length + 1 < sizeof(buffer) && strchr("+-.0123456789eE", p[length])) {
+                    buffer[length] = p[length];
+                    ++length;
+                }
+                buffer[length] = '\0';
+                char* parsed = NULL;
+                out.type = JsonValue::NUMBER;
+                out.number = strtod(buffer, &parsed);
+                if (length == 0 || parsed != buffer + length) return fail("malformed number");
+                p += length;
+                return true;
+            }
+        }
+    }
+
+    const char* p;
+    const char* begin;
+    const char* end;
+    const char* error;
+};
+
+// --- description ---
+
+// Reads an optional [x, y, z]; false if present but not three numbers
+static bool readVec3(const JsonValue& object, const char* key, float out[3]) {
+    const JsonValue* value = object.find(key);
+    if (!value) return true;
+    if (value->type != JsonValue::ARRAY || value->items.size() != 3) return false;
+    for (int i = 0; i < 3; ++i) {
+        if (value->items[i].type != JsonValue::NUMBER) return false;
+        out[i] = (float)value->items[i].number;
+    }
+    return true;
+}
+
+static bool readNumber(const JsonValue& object, const char* key, float& out) {
+    const JsonValue* value = object.find(key);
+    if (!value) return true;
+    if (value->type != JsonValue::NUMBER) return false;
+    out = (float)value->number;
+    return true;
+}
+
+static const string* readString(const JsonValue& object, const char* key) {
+    const JsonValue* value = object.find(key);
+    return value && value->type == JsonValue::STRING ? &value->text : NULL;
+}
+
+static int findLink(const RobotDescription& robot, const string& name) {
+    for (int i = 0; i < robot.linkCount; ++i) {
+        if (name == robot.links[i].name) return i;
+    }
+    return -1;
+}
+
+// Fills robot from the parsed tree; returns the problem, or NULL
+static const char* compileRobot(const JsonValue& root, RobotDescription& robot, string& subject) {
+    if (root.type != JsonValue::OBJECT) return "expected an object";
+    const string* name = readString(root, "name");
+    if (name) snprintf(robot.name, sizeof(robot.name), "%s", name->c_str());
+
+    const JsonValue* links = root.find("links");
+    if (!links || links->type != JsonValue::ARRAY || links->items.empty()) return "no \"links\" array";
+    if (links->items.size() > (size_t)MAX_ROBOT_PARTS) return "too many links (at most 32)";
+    for (const JsonValue& item : links->items) {
+        const string* linkName = readString(item, "name");
+        if (!linkName || linkName->empty()) return "a link has no \"name\"";
+        subject = *linkName;
+        if (linkName->size() >= sizeof(robot.links[0].name)) return "link name is too long";
+        if (findLink(robot, *linkName) >= 0) return "duplicate link name";
+
+        RobotLink& link = robot.links[robot.linkCount++];
+        memset(&link, 0, sizeof(link));
+        snprintf(link.name, sizeof(link.name), "%s", linkName->c_str());
+        link.parent = -1;
+        link.joint = -1;
+        link.axis[2] = 1.0f;
+        link.lower = 1.0f;
+        link.upper = -1.0f;
+        setVec(link.color, 0.8f, 0.8f, 0.8f);
+        const JsonValue* visual = item.find("visual");
+        if (visual) {
+            if (!readVec3(*visual, "size", link.visualSize) || !readVec3(*visual, "origin", link.visualOffset)
+                || !readVec3(*visual, "color", link.color)) {
+                return "visual size, origin and color must be [x, y, z]";
+            }
+        }
+    }
+
+    const JsonValue* joints = root.find("joints");
+    if (joints && joints->type != JsonValue::ARRAY) return "\"joints\" must be an array";
+    vector<bool> attached(robot.linkCount, false);
+    for (size_t j = 0; joints && j < joints->items.size(); ++j) {
+        const JsonValue& item = joints->items[j];
+        const string* jointName = readString(item, "name");
+        subject = jointName ? *jointName : "joint " + to_string(j);
+
+        const string* childName = readString(item, "child");
+        int child = childName ? findLink(robot, *childName) : -1;
+        if (child < 0) return "joint has no valid \"child\" link";
+        if (attached[child]) return "link has more than one parent joint";
+        attached[child] = true;
+        RobotLink& link = robot.links[child];
+
+        // No parent: attached to the robot's root
+        const string* parentName = readString(item, "parent");
+        if (parentName && !parentName->empty()) {
+            link.parent = findLink(robot, *parentName);
+            if (link.parent < 0) return "joint \"parent\" is not a link";
+            if (link.parent == child) return "link is its own parent";
+        }
+
+        const string* type = readString(item, "type");
+        bool fixed = type && *type == "fixed";
+        if (type && !fixed && *type != "revolute") return "joint type must be \"revolute\" or \"fixed\"";
+        if (!fixed) {
+            // The RobotPose angle driving the joint: "channel", or the joint's own name. A name
+            // that is not a standard channel gets a channel of its own; joints naming the same
+            // channel move together.
+            const string* channel = readString(item, "channel");
+            if (!channel) channel = jointName;
+            if (!channel || channel->empty()) return "revolute joint needs a \"name\" or \"channel\"";
+            link.joint = findChannel(robot, *channel);
+            if (link.joint < 0) {
+                if (robot.jointCount >= MAX_ROBOT_JOINTS) return "too many joint channels (at most 32)";
+                if (channel->size() >= sizeof(robot.jointNames[0])) return "channel name is too long";
+                link.joint = robot.jointCount++;
+                snprintf(robot.jointNames[link.joint], sizeof(robot.jointNames[0]), "%s", channel->c_str());
+            }
+        }
+        if (!readVec3(item, "origin", link.origin) || !readVec3(item, "axis", link.axis)) {
+            return "joint origin and axis must be [x, y, z]";
+        }
+        float length = sqrtf(link.axis[0] * link.axis[0] + link.axis[1] * link.axis[1] + link.axis[2] * link.axis[2]);
+        if (length <= 0.0f) return "joint axis is zero";
+        for (float& a : link.axis) a /= length;
+
+        const JsonValue* limit = item.find("limit");
+        if (limit) {
+            if (!readNumber(*limit, "lower", link.lower) || !readNumber(*limit, "upper", link.upper)
+                || !limit->find("lower") || !limit->find("upper") || link.lower > link.upper) {
+                return "joint limit needs \"lower\" <= \"upper\" (degrees)";
+            }
+        }
+    }
+
+    // Evaluation order by depth; a chain longer than the link count is a cycle
+    vector<int> depth(robot.linkCount, 0);
+    for (int i = 0; i < robot.linkCount; ++i) {
+        for (int p = robot.links[i].parent; p >= 0; p = robot.links[p].parent) {
+            if (++depth[i] > robot.linkCount) {
+                subject = robot.links[i].name;
+                return "joints form a cycle";
+            }
+        }
+    }
+    int next = 0;
+    for (int d = 0; d <= robot.linkCount; ++d) {
+        for (int i = 0; i < robot.linkCount; ++i) {
+            if (depth[i] == d) robot.order[next++] = i;
+        }
+    }
+    return NULL;
+}
+
+bool parseRobotDescription(const char* text, size_t size, const string& source, RobotDescription& out) {
+    JsonValue root;
+    JsonParser parser(text, size);
+    if (!parser.parse(root)) {
+        cerr << "Error: " << source << ":" << parser.line() << ": " << parser.message() << endl;
+        return false;
+    }
+
+    RobotDescription robot;
+    memset(&robot, 0, sizeof(robot));
+    string stem = source.substr(source.find_last_of('/') + 1);
+    snprintf(robot.name, sizeof(robot.name), "%s", stem.substr(0, stem.find('.')).c_str());
+    addStandardChannels(robot);
+    string subject;
+    const char* problem = compileRobot(root, robot, subject);
+    if (problem) {
+        cerr << "Error: " << source << ": " << (subject.empty() ? "" : subject + ": ") << problem << endl;
+        return false;
+    }
+    out = robot;
+    return true;
+}
+
+// --- compiled cache ---
+
+static const char CACHE_MAGIC[4] = {'R', 'S', 'K', 'L'};
+static const uint32_t CACHE_VERSION = 2;
+
+// File header; one RobotDescription follows
+struct RobotCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t descriptionSize;   // sizeof(RobotDescription), so a layout change misses
+    uint32_t reserved;
+};
+
+static bool makeDirectory(const string& path) {
+#ifdef _WIN32
+    int rc = _mkdir(path.c_str());
+#else
+    int rc = mkdir(path.c_str(), 0755);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+// A cached blob is only trusted if computeRobotParts can walk it: order lists every link
+// once with parents first, joints name existing channels, and the names are terminated
+static bool validDescription(const RobotDescription& robot) {
+    if (robot.linkCount < 1 || robot.linkCount > MAX_ROBOT_PARTS) return false;
+    if (robot.jointCount < JOINT_COUNT || robot.jointCount > MAX_ROBOT_JOINTS) return false;
+    if (robot.name[sizeof(robot.name) - 1] != '\0') return false;
+    for (int c = 0; c < robot.jointCount; ++c) {
+        if (robot.jointNames[c][sizeof(robot.jointNames[c]) - 1] != '\0') return false;
+    }
+    bool placed[MAX_ROBOT_PARTS] = {};
+    for (int i = 0; i < robot.linkCount; ++i) {
+        const int index = robot.order[i];
+        if (index < 0 || index >= robot.linkCount || placed[index]) return false;
+        const RobotLink& link = robot.links[index];
+        if (link.joint < -1 || link.joint >= robot.jointCount || link.parent < -1 || link.parent >= robot.linkCount
+            || (link.parent >= 0 && !placed[link.parent]) || link.name[sizeof(link.name) - 1] != '\0') {
+            return false;
+        }
+        placed[index] = true;
+    }
+    return true;
+}
+
+static bool readCache(const string& path, uint64_t sourceHash, RobotDescription& out) {
+    MappedFile file;
+    if (!file.open(path) || file.size() != sizeof(RobotCacheHeader) + sizeof(RobotDescription)) return false;
+    RobotCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION
+        || header.sourceHash != sourceHash || header.descriptionSize != sizeof(RobotDescription)) {
+        return false;
+    }
+    RobotDescription robot;
+    memcpy(&robot, file.data() + sizeof(header), sizeof(robot));
+    if (!validDescription(robot)) return false;
+    out = robot;
+    return true;
+}
+
+static void writeCache(const string& path, uint64_t sourceHash, const RobotDescription& robot) {
+    RobotCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.descriptionSize = sizeof(RobotDescription);
+
+    // Write then rename, so a concurrent launch never reads a partial file
+    string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(&robot, sizeof(robot), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        cerr << "Warning: could not write robot cache entry " << path << endl;
+    }
+}
+
+bool loadRobotDescription(const string& path, const string& cacheDirectory,
+                          RobotDescription& out, bool* fromCache) {
+    if (fromCache) *fromCache = false;
+    MappedFile source;
+    if (!mapAsset(path, source)) {
+        cerr << "Error: cannot read robot description " << path << endl;
+        return false;
+    }
+
+    // Keyed on the contents, so an edited file simply misses
+    uint64_t sourceHash = hashBytes(source.data(), source.size());
+    string cachePath;
+    if (!cacheDirectory.empty()) {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.skel", (unsigned long long)sourceHash);
+        cachePath = cacheDirectory + "/" + name;
+        if (readCache(cachePath, sourceHash, out)) {
+            if (fromCache) *fromCache = true;
+            return true;
+        }
+    }
+
+    if (!parseRobotDescription(source.data(), source.size(), path, out)) return false;
+    if (!cachePath.empty() && makeDirectory(cacheDirectory)) writeCache(cachePath, sourceHash, out);
+    return true;
+}
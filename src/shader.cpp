@@ -1,29 +1,15 @@
 #include <glad/glad.h>
+#include "shader.h"
+#include "program_cache.h"
+#include "frame_stats.h"
+#include "shader_preprocessor.h"
+#include <map>
+#include <mutex>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 
 using namespace std;
 
-string loadShader(const char* filePath) {
-    string shaderCode;
-    ifstream shaderFile;
-
-    shaderFile.exceptions(ifstream::failbit| ifstream::badbit);
-    try {
-        shaderFile.open(filePath);
-        stringstream shaderStream;
-        shaderStream << shaderFile.rdbuf();
-        shaderFile.close();
-        shaderCode = shaderStream.str();
-    }
-    catch (ifstream::failure& e){
-        cerr << "Error: Fail to read shader" << filePath << "/n";
-    }
-    return shaderCode;
-}
-
 GLuint compileShader(const char* shaderSource, GLenum shaderType){
     GLuint shader = glCreateShader(shaderType);
     glShaderSource(shader, 1, &shaderSource, NULL);
@@ -43,6 +29,9 @@ GLuint CreateShaderProgram(GLuint vertexShader, GLuint fragmentShader) {
     GLuint program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
+    if (programCacheEnabled()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(program);
 
     GLint success;
@@ -58,19 +47,105 @@ GLuint CreateShaderProgram(GLuint vertexShader, GLuint fragmentShader) {
     return program;
 }
 
-GLuint loadShaderProgram(const char* vertexPath, const char* fragmentPath){
-    string vertexCode = loadShader(vertexPath);
-    string fragmentCode = loadShader(fragmentPath);
+GLuint buildShaderProgram(const PreprocessedShader& vertex, const PreprocessedShader& fragment, bool* fromCache) {
+    if (fromCache) *fromCache = false;
+
+    // A cached binary skips compiling and linking
+    uint64_t key = 0;
+    if (programCacheEnabled()) {
+        key = programCacheKey(vertex.source, fragment.source, "");
+        GLuint cached = loadCachedProgram(key);
+        if (cached) {
+            if (fromCache) *fromCache = true;
+            return cached;
+        }
+    }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    GLuint vertexShader = compileShader(vertex.source.c_str(), GL_VERTEX_SHADER);
+    GLuint fragmentShader = compileShader(fragment.source.c_str(), GL_FRAGMENT_SHADER);
 
-    GLuint vertexShader = compileShader(vShaderCode, GL_VERTEX_SHADER);
-    GLuint fragmentShader = compileShader(fShaderCode, GL_FRAGMENT_SHADER);
+    // Compiler messages name files by index
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) printShaderFiles(vertex);
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) printShaderFiles(fragment);
 
     GLuint program = CreateShaderProgram(vertexShader, fragmentShader);
 
-    cout << "Shader completed" << endl;
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked && programCacheEnabled()) storeCachedProgram(key, program);
+    return program;
+}
+
+// Sources preprocessed by prepareShaderProgram, waiting for their loadShaderProgram
+typedef pair<pair<string, string>, string> PreparedKey;
+static map<PreparedKey, pair<PreprocessedShader, PreprocessedShader> > gPrepared;
+static mutex gPreparedMutex;
+
+bool prepareShaderProgram(const char* vertexPath, const char* fragmentPath, const string& defines) {
+    PreprocessedShader vertex, fragment;
+    if (!preprocessShader(vertexPath, defines, vertex) || !preprocessShader(fragmentPath, defines, fragment)) {
+        return false;
+    }
+    lock_guard<std::mutex> lock(gPreparedMutex);
+    gPrepared[PreparedKey(make_pair(string(vertexPath), string(fragmentPath)), defines)] = make_pair(vertex, fragment);
+    return true;
+}
+
+static bool takePrepared(const char* vertexPath, const char* fragmentPath, const string& defines,
+                         PreprocessedShader& vertex, PreprocessedShader& fragment) {
+    lock_guard<std::mutex> lock(gPreparedMutex);
+    map<PreparedKey, pair<PreprocessedShader, PreprocessedShader> >::iterator it =
+        gPrepared.find(PreparedKey(make_pair(string(vertexPath), string(fragmentPath)), defines));
+    if (it == gPrepared.end()) return false;
+    vertex.source.swap(it->second.first.source);
+    vertex.files.swap(it->second.first.files);
+    fragment.source.swap(it->second.second.source);
+    fragment.files.swap(it->second.second.files);
+    gPrepared.erase(it);
+    return true;
+}
+
+GLuint loadShaderProgram(const char* vertexPath, const char* fragmentPath, const string& defines){
+    double start = monotonicSeconds();
+    PreprocessedShader vertex, fragment;
+    if (!takePrepared(vertexPath, fragmentPath, defines, vertex, fragment)
+        && (!preprocessShader(vertexPath, defines, vertex) || !preprocessShader(fragmentPath, defines, fragment))) {
+        return 0;
+    }
+
+    bool fromCache = false;
+    GLuint program = buildShaderProgram(vertex, fragment, &fromCache);
+    recordProgramLoad((monotonicSeconds() - start) * 1000.0, fromCache);
+
+    cout << (fromCache ? "Shader completed (cached)" : "Shader completed") << endl;
 
     return program;
-}
\ No newline at end of file
+}
+
+void setUniform(GLuint program, const char* name, const glm::mat4& value) {
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]);
+}
+
+void setUniform(GLuint program, const char* name, const glm::vec3& value) {
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glUniform3fv(loc, 1, &value[0]);
+}
+
+void setUniform(GLuint program, const char* name, const glm::vec2& value) {
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glUniform2fv(loc, 1, &value[0]);
+}
+
+void setUniform(GLuint program, const char* name, float value) {
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glUniform1f(loc, value);
+}
+
+void setUniform(GLuint program, const char* name, int value) {
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glUniform1i(loc, value);
+}
@@ -0,0 +1,130 @@
+#include "shader_preprocessor.h"
+#include "mapped_file.h"
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+static const int MAX_INCLUDE_DEPTH = 16;
+
+bool loadShaderFile(const string& path, string& source) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    source.assign(file.data(), file.size());
+    return true;
+}
+
+static string directoryOf(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? string() : path.substr(0, slash + 1);
+}
+
+// "a/b/../c" -> "a/c", so one file reached through two paths is still included once
+static string normalizePath(const string& path) {
+    vector<string> parts;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == string::npos) end = path.size();
+        string part = path.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") parts.pop_back();
+            else parts.push_back(part);
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+    string out = !path.empty() && path[0] == '/' ? "/" : "";
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i > 0) out += '/';
+        out += parts[i];
+    }
+    return out;
+}
+
+static bool startsWithDirective(const string& line, const char* directive, size_t& after) {
+    size_t i = line.find_first_not_of(" \t");
+    if (i == string::npos || line[i] != '#') return false;
+    i = line.find_first_not_of(" \t", i + 1);
+    string word = directive;
+    if (i == string::npos || line.compare(i, word.size(), word) != 0) return false;
+    after = i + word.size();
+    return after == line.size() || line[after] == ' ' || line[after] == '\t' || line[after] == '"';
+}
+
+static bool expand(const string& path, int depth, const ShaderFileLoader& loader,
+                   PreprocessedShader& out, string& text, string& version)
+{
+    string source;
+    if (!loader(path, source)) {
+        cerr << "Error: cannot read shader " << path << endl;
+        return false;
+    }
+    int fileIndex = (int)out.files.size();
+    out.files.push_back(path);
+
+    istringstream lines(source);
+    string line;
+    int lineNumber = 0;
+    while (getline(lines, line)) {
+        ++lineNumber;
+        size_t after = 0;
+        if (startsWithDirective(line, "version", after)) {
+            if (depth > 0) {
+                cerr << "Error: " << path << ":" << lineNumber << ": #version in an included file" << endl;
+                return false;
+            }
+            version = line;   // emitted first by preprocessShader
+            text += '\n';
+            continue;
+        }
+        if (!startsWithDirective(line, "include", after)) {
+            text += line;
+            text += '\n';
+            continue;
+        }
+
+        size_t open = line.find('"', after);
+        size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+        if (close == string::npos) {
+            cerr << "Error: " << path << ":" << lineNumber << ": expected #include \"file\"" << endl;
+            return false;
+        }
+        string included = normalizePath(directoryOf(path) + line.substr(open + 1, close - open - 1));
+        bool seen = false;
+        for (const string& f : out.files) seen = seen || f == included;
+        if (!seen) {
+            if (depth + 1 >= MAX_INCLUDE_DEPTH) {
+                cerr << "Error: " << path << ":" << lineNumber << ": includes nested too deeply" << endl;
+                return false;
+            }
+            text += "#line 1 " + to_string(out.files.size()) + "\n";
+            if (!expand(included, depth + 1, loader, out, text, version)) return false;
+        }
+        text += "#line " + to_string(lineNumber + 1) + " " + to_string(fileIndex) + "\n";
+    }
+    return true;
+}
+
+bool preprocessShader(const string& path, const string& defines,
+                      PreprocessedShader& out, const ShaderFileLoader& loader)
+{
+    out.source.clear();
+    out.files.clear();
+
+    // #version must stay the first line; the defines follow it
+    string version, body;
+    if (!expand(normalizePath(path), 0, loader, out, body, version)) return false;
+    if (version.empty()) version = "#version 330 core";
+    out.source = version + "\n" + defines;
+    if (!defines.empty() && defines[defines.size() - 1] != '\n') out.source += '\n';
+    out.source += "#line 1 0\n" + body;
+    return true;
+}
+
+void printShaderFiles(const PreprocessedShader& shader) {
+    for (size_t i = 0; i < shader.files.size(); ++i) {
+        cerr << "  source " << i << ": " << shader.files[i] << endl;
+    }
+}
@@ -0,0 +1,394 @@
+#include "shader_reload.h"
+#include "shader.h"
+#include "gl_caps.h"
+#include "frame_stats.h"
+#include "program_cache.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+ShaderWatcher::ShaderWatcher()
+    : inotifyFd(-1), running(false)
+{
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    stop();
+}
+
+bool ShaderWatcher::start(const string& dir, const string& logicalDirectory) {
+#ifdef __linux__
+    stop();
+    rootDirectory = dir;
+    logicalRoot = logicalDirectory;
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        cerr << "Warning: inotify unavailable, shader hot reload disabled" << endl;
+        return false;
+    }
+    addWatches(dir);
+    if (watches.empty()) {
+        cerr << "Warning: cannot watch " << dir << ", shader hot reload disabled" << endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    running = true;
+    worker = thread(&ShaderWatcher::run, this);
+    cout << "Watching " << dir << " for shader changes" << endl;
+    return true;
+#else
+    (void)dir;
+    (void)logicalDirectory;
+    cerr << "Warning: shader hot reload needs inotify (Linux)" << endl;
+    return false;
+#endif
+}
+
+void ShaderWatcher::addWatches(const string& path) {
+#ifdef __linux__
+    // Editors either rewrite the file (close after write) or rename a new one over it
+    int wd = inotify_add_watch(inotifyFd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) return;
+    watches.push_back(make_pair(wd, path));
+
+    // Included files usually live in subdirectories
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        string child = path + "/" + entry->d_name;
+        struct stat info;
+        if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) addWatches(child);
+    }
+    closedir(dir);
+#else
+    (void)path;
+#endif
+}
+
+void ShaderWatcher::stop() {
+    running = false;
+    if (worker.joinable()) worker.join();
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+    inotifyFd = -1;
+    watches.clear();
+}
+
+void ShaderWatcher::run() {
+#ifdef __linux__
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (running) {
+        // Short timeout so stop() never waits long
+        pollfd pfd = {inotifyFd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        // Collect a burst of events, then read each file once
+        vector<string> paths;
+        for (;;) {
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) break;
+            for (char* p = buffer; p < buffer + length; ) {
+                const inotify_event* event = (const inotify_event*)p;
+                p += sizeof(inotify_event) + event->len;
+                if (event->len == 0) continue;
+                for (const pair<int, string>& w : watches) {
+                    if (w.first != event->wd) continue;
+                    string path = w.second + "/" + event->name;
+                    if (find(paths.begin(), paths.end(), path) == paths.end()) paths.push_back(path);
+                }
+            }
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+        for (const string& path : paths) readFile(path);
+        if (!paths.empty()) glfwPostEmptyEvent();   // wake an on-demand loop
+    }
+#endif
+}
+
+void ShaderWatcher::readFile(const string& path) {
+    if (path.size() < 5 || path.compare(path.size() - 5, 5, ".glsl") != 0) return;
+
+    ChangedShader change;
+    change.path = logicalRoot + path.substr(rootDirectory.size());
+    if (!loadShaderFile(path, change.source)) return;
+
+    lock_guard<std::mutex> lock(mutex);
+    for (ChangedShader& c : changes) {
+        if (c.path == change.path) {
+            c.source = change.source;
+            return;
+        }
+    }
+    changes.push_back(change);
+}
+
+vector<ChangedShader> ShaderWatcher::takeChanges() {
+    vector<ChangedShader> out;
+    lock_guard<std::mutex> lock(mutex);
+    out.swap(changes);
+    return out;
+}
+
+ReloadableProgram::ReloadableProgram()
+    : program(0), pending(0), rebuildStart(0.0), prepareMs(0.0)
+{
+    pendingShaders[0] = pendingShaders[1] = 0;
+}
+
+bool ReloadableProgram::load(const char* vertexFile, const char* fragmentFile, const string& programDefines) {
+    return prepare(vertexFile, fragmentFile, programDefines) && build();
+}
+
+bool ReloadableProgram::prepare(const char* vertexFile, const char* fragmentFile, const string& programDefines) {
+    double start = monotonicSeconds();
+    vertexPath = vertexFile;
+    fragmentPath = fragmentFile;
+    defines = programDefines;
+    files.clear();
+    bool prepared = preprocess(vertex, fragment);
+    prepareMs = (monotonicSeconds() - start) * 1000.0;
+    return prepared;
+}
+
+bool ReloadableProgram::build() {
+    double start = monotonicSeconds();
+    bool fromCache = false;
+    program = buildShaderProgram(vertex, fragment, &fromCache);
+    recordProgramLoad(prepareMs + (monotonicSeconds() - start) * 1000.0, fromCache);
+
+    // The link log was printed already; a program that did not link must not be used
+    GLint linked = GL_FALSE;
+    if (program) glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        cerr << "Error: building " << vertexPath << " + " << fragmentPath << " failed" << endl;
+        if (program) glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+    cout << (fromCache ? "Shader completed (cached)" : "Shader completed") << endl;
+    return true;
+}
+
+bool ReloadableProgram::preprocess(PreprocessedShader& vs, PreprocessedShader& fs) {
+    // Files read once are served from memory afterwards
+    map<string, string>& known = files;
+    ShaderFileLoader loader = [&known](const string& path, string& source) {
+        map<string, string>::const_iterator it = known.find(path);
+        if (it != known.end()) {
+            source = it->second;
+            return true;
+        }
+        if (!loadAsset(path, source)) return false;
+        known[path] = source;
+        return true;
+    };
+    return preprocessShader(vertexPath, defines, vs, loader)
+        && preprocessShader(fragmentPath, defines, fs, loader);
+}
+
+void ReloadableProgram::onShadersChanged(const vector<ChangedShader>& changed) {
+    bool ours = false;
+    for (const ChangedShader& c : changed) {
+        if (files.count(c.path)) {
+            files[c.path] = c.source;
+            ours = true;
+        }
+    }
+    if (!ours) return;
+
+    // A newer edit replaces a rebuild still in flight
+    discardPending();
+    rebuildStart = monotonicSeconds();
+    if (!preprocess(pendingVertex, pendingFragment)) {
+        cerr << "Error: reloading " << vertexPath << " + " << fragmentPath
+             << " failed, keeping the previous program" << endl;
+        return;
+    }
+
+    const char* sources[2] = {pendingVertex.source.c_str(), pendingFragment.source.c_str()};
+    const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    pending = glCreateProgram();
+    for (int i = 0; i < 2; ++i) {
+        pendingShaders[i] = glCreateShader(types[i]);
+        glShaderSource(pendingShaders[i], 1, &sources[i], NULL);
+        glCompileShader(pendingShaders[i]);
+        glAttachShader(pending, pendingShaders[i]);
+    }
+    // With parallel compile this returns at once; update() polls for completion
+    glLinkProgram(pending);
+}
+
+bool ReloadableProgram::update() {
+    if (!pending) return false;
+
+    if (glCaps().parallelShaderCompile) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(pending, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done) return false;
+    }
+
+    char infoLog[1024];
+    for (int i = 0; i < 2; ++i) {
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glGetShaderInfoLog(pendingShaders[i], sizeof(infoLog), NULL, infoLog);
+            cerr << "Error: reloading " << (i == 0 ? vertexPath : fragmentPath)
+                 << " failed, keeping the previous program\n" << infoLog << endl;
+            printShaderFiles(i == 0 ? pendingVertex : pendingFragment);
+            discardPending();
+            return false;
+        }
+    }
+    GLint linked = GL_FALSE;
+    glGetProgramiv(pending, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glGetProgramInfoLog(pending, sizeof(infoLog), NULL, infoLog);
+        cerr << "Error: relinking " << vertexPath << " + " << fragmentPath
+             << " failed, keeping the previous program\n" << infoLog << endl;
+        discardPending();
+        return false;
+    }
+
+    // A program that failed its first build has no uniform values to hand over
+    if (program) {
+        copyUniforms(program, pending);
+        glDeleteProgram(program);
+    }
+    program = pending;
+    vertex = pendingVertex;
+    fragment = pendingFragment;
+    pending = 0;
+    for (int i = 0; i < 2; ++i) {
+        glDeleteShader(pendingShaders[i]);
+        pendingShaders[i] = 0;
+    }
+    printf("Reloaded %s + %s (%.1f ms)\n", vertexPath.c_str(), fragmentPath.c_str(),
+           (monotonicSeconds() - rebuildStart) * 1000.0);
+    return true;
+}
+
+void ReloadableProgram::discardPending() {
+    if (pending) glDeleteProgram(pending);
+    for (int i = 0; i < 2; ++i) {
+        if (pendingShaders[i]) glDeleteShader(pendingShaders[i]);
+        pendingShaders[i] = 0;
+    }
+    pending = 0;
+}
+
+void ReloadableProgram::destroy() {
+    discardPending();
+    glDeleteProgram(program);
+    program = 0;
+}
+
+// Components and kind of a plain uniform type; 0 components for types not copied (blocks, images)
+enum UniformKind { UNIFORM_FLOAT, UNIFORM_INT, UNIFORM_UINT, UNIFORM_MATRIX };
+
+static int uniformComponents(GLenum type, UniformKind& kind) {
+    switch (type) {
+        case GL_FLOAT:             kind = UNIFORM_FLOAT;  return 1;
+        case GL_FLOAT_VEC2:        kind = UNIFORM_FLOAT;  return 2;
+        case GL_FLOAT_VEC3:        kind = UNIFORM_FLOAT;  return 3;
+        case GL_FLOAT_VEC4:        kind = UNIFORM_FLOAT;  return 4;
+        case GL_INT: case GL_BOOL: kind = UNIFORM_INT;    return 1;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: kind = UNIFORM_INT; return 2;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: kind = UNIFORM_INT; return 3;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: kind = UNIFORM_INT; return 4;
+        case GL_UNSIGNED_INT:      kind = UNIFORM_UINT;   return 1;
+        case GL_FLOAT_MAT3:        kind = UNIFORM_MATRIX; return 9;
+        case GL_FLOAT_MAT4:        kind = UNIFORM_MATRIX; return 16;
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+                                   kind = UNIFORM_INT;    return 1;
+        default:                   return 0;
+    }
+}
+
+static map<string, GLenum> activeUniforms(GLuint program) {
+    map<string, GLenum> uniforms;
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        char name[256];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+        // Arrays are reported as "name[0]"; list every element
+        string base = name;
+        size_t bracket = base.find('[');
+        if (bracket != string::npos) base.resize(bracket);
+        if (size <= 1 && bracket == string::npos) {
+            uniforms[base] = type;
+        } else {
+            for (GLint e = 0; e < size; ++e) {
+                uniforms[base + "[" + to_string(e) + "]"] = type;
+            }
+        }
+    }
+    return uniforms;
+}
+
+void copyUniforms(GLuint from, GLuint to) {
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+
+    map<string, GLenum> target = activeUniforms(to);
+    map<string, GLenum> source = activeUniforms(from);
+    glUseProgram(to);
+    for (map<string, GLenum>::const_iterator it = source.begin(); it != source.end(); ++it) {
+        map<string, GLenum>::const_iterator match = target.find(it->first);
+        if (match == target.end() || match->second != it->second) continue;
+        UniformKind kind = UNIFORM_FLOAT;
+        int components = uniformComponents(it->second, kind);
+        GLint src = glGetUniformLocation(from, it->first.c_str());
+        GLint dst = glGetUniformLocation(to, it->first.c_str());
+        if (components == 0 || src < 0 || dst < 0) continue;
+
+        GLfloat f[16];
+        GLint i[4];
+        GLuint u[1];
+        switch (kind) {
+            case UNIFORM_FLOAT:
+                glGetUniformfv(from, src, f);
+                if (components == 1) glUniform1fv(dst, 1, f);
+                else if (components == 2) glUniform2fv(dst, 1, f);
+                else if (components == 3) glUniform3fv(dst, 1, f);
+                else glUniform4fv(dst, 1, f);
+                break;
+            case UNIFORM_INT:
+                glGetUniformiv(from, src, i);
+                if (components == 1) glUniform1iv(dst, 1, i);
+                else if (components == 2) glUniform2iv(dst, 1, i);
+                else if (components == 3) glUniform3iv(dst, 1, i);
+                else glUniform4iv(dst, 1, i);
+                break;
+            case UNIFORM_UINT:
+                glGetUniformuiv(from, src, u);
+                glUniform1uiv(dst, 1, u);
+                break;
+            case UNIFORM_MATRIX:
+                glGetUniformfv(from, src, f);
+                if (components == 9) glUniformMatrix3fv(dst, 1, GL_FALSE, f);
+                else glUniformMatrix4fv(dst, 1, GL_FALSE, f);
+                break;
+        }
+    }
+    glUseProgram((GLuint)previous);
+}
@@ -0,0 +1,98 @@
+#include "shader_variants.h"
+#include "shader.h"
+#include <map>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+static const char* const VARIANT_NAMES[VARIANT_BIT_COUNT] = {
+    "DEPTH_ONLY",
+    "VERTEX_COLOR",
+    "NO_SPECULAR",
+};
+
+typedef pair<pair<string, string>, unsigned> VariantKey;
+
+// Sources may be prepared on a worker before the GL thread builds the program
+struct Variant {
+    ReloadableProgram program;
+    bool prepared = false;
+    bool built = false;     // tried once; a variant that failed stays 0 until a reload fixes it
+};
+
+static map<VariantKey, Variant> gVariants;
+static mutex gVariantsMutex;   // prepareShaderVariant runs on workers
+
+string shaderVariantDefines(unsigned bits) {
+    string defines;
+    for (int i = 0; i < VARIANT_BIT_COUNT; ++i) {
+        defines += "#define ";
+        defines += VARIANT_NAMES[i];
+        defines += (bits & (1u << i)) ? " 1\n" : " 0\n";
+    }
+    return defines;
+}
+
+GLuint shaderVariant(const char* vertexPath, const char* fragmentPath, unsigned bits) {
+    lock_guard<mutex> lock(gVariantsMutex);
+    Variant& variant = gVariants[VariantKey(make_pair(string(vertexPath), string(fragmentPath)), bits)];
+    if (!variant.built) {
+        variant.built = true;
+        if (!variant.prepared) {
+            variant.prepared = variant.program.prepare(vertexPath, fragmentPath, shaderVariantDefines(bits));
+        }
+        if (variant.prepared) variant.program.build();
+    }
+    return variant.program.id();
+}
+
+bool prepareShaderVariant(const char* vertexPath, const char* fragmentPath, unsigned bits) {
+    ReloadableProgram program;
+    if (!program.prepare(vertexPath, fragmentPath, shaderVariantDefines(bits))) return false;
+
+    lock_guard<mutex> lock(gVariantsMutex);
+    Variant& variant = gVariants[VariantKey(make_pair(string(vertexPath), string(fragmentPath)), bits)];
+    if (!variant.built) {
+        variant.program = std::move(program);
+        variant.prepared = true;
+    }
+    return true;
+}
+
+void reloadShaderVariants(const vector<ChangedShader>& changed) {
+    lock_guard<mutex> lock(gVariantsMutex);
+    for (map<VariantKey, Variant>::iterator it = gVariants.begin(); it != gVariants.end(); ++it) {
+        if (it->second.built) it->second.program.onShadersChanged(changed);
+    }
+}
+
+bool updateShaderVariants() {
+    lock_guard<mutex> lock(gVariantsMutex);
+    bool changed = false;
+    for (map<VariantKey, Variant>::iterator it = gVariants.begin(); it != gVariants.end(); ++it) {
+        if (it->second.program.update()) changed = true;
+    }
+    return changed;
+}
+
+bool shaderVariantsRebuilding() {
+    lock_guard<mutex> lock(gVariantsMutex);
+    for (map<VariantKey, Variant>::const_iterator it = gVariants.begin(); it != gVariants.end(); ++it) {
+        if (it->second.program.rebuilding()) return true;
+    }
+    return false;
+}
+
+int shaderVariantCount() {
+    lock_guard<mutex> lock(gVariantsMutex);
+    return (int)gVariants.size();
+}
+
+void destroyShaderVariants() {
+    lock_guard<mutex> lock(gVariantsMutex);
+    for (map<VariantKey, Variant>::iterator it = gVariants.begin(); it != gVariants.end(); ++it) {
+        it->second.program.destroy();
+    }
+    gVariants.clear();
+}
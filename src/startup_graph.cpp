@@ -0,0 +1,95 @@
+#include "startup_graph.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include <cstdio>
+
+using namespace std;
+
+StartupGraph::Task StartupGraph::add(const char* name, StartupThread thread, function<bool()> fn,
+                                     initializer_list<Task> dependencies) {
+    Task task = (Task)nodes.size();
+    Node node;
+    node.name = name;
+    node.thread = thread;
+    node.fn = fn;
+    node.waitingFor = 0;
+    node.skipped = false;
+    node.startMs = node.endMs = 0.0;
+    nodes.push_back(node);
+
+    // Dependencies are earlier tasks, so the graph cannot have cycles
+    for (Task dependency : dependencies) {
+        if (dependency < 0 || dependency >= task) continue;
+        nodes[dependency].dependents.push_back(task);
+        ++nodes[task].waitingFor;
+    }
+    return task;
+}
+
+bool StartupGraph::run() {
+    runStart = monotonicSeconds();
+    finished = 0;
+    failed = false;
+    inlineWorkers = jobSystem().threadCount() <= 1;
+
+    unique_lock<std::mutex> lock(mutex);
+    for (Task t = 0; t < (Task)nodes.size(); ++t) {
+        if (nodes[t].waitingFor == 0) dispatch(t);
+    }
+
+    // The main thread runs MAIN tasks as they become ready and otherwise waits
+    for (;;) {
+        wake.wait(lock, [this] { return !mainReady.empty() || finished == (int)nodes.size(); });
+        if (mainReady.empty()) break;
+        Task t = mainReady.front();
+        mainReady.pop_front();
+        lock.unlock();
+        execute(t);
+        lock.lock();
+    }
+    return !failed;
+}
+
+void StartupGraph::dispatch(Task t) {
+    if (nodes[t].skipped) {
+        finish(t, false);
+    } else if (nodes[t].thread == StartupThread::MAIN || inlineWorkers) {
+        mainReady.push_back(t);
+        wake.notify_all();
+    } else {
+        jobSystem().submit([this, t]() { execute(t); });
+    }
+}
+
+void StartupGraph::execute(Task t) {
+    Node& node = nodes[t];
+    node.startMs = (monotonicSeconds() - runStart) * 1000.0;
+    bool succeeded = node.fn();
+    node.endMs = (monotonicSeconds() - runStart) * 1000.0;
+
+    lock_guard<std::mutex> lock(mutex);
+    finish(t, succeeded);
+}
+
+void StartupGraph::finish(Task t, bool succeeded) {
+    ++finished;
+    if (!succeeded) failed = true;
+    for (Task d : nodes[t].dependents) {
+        if (!succeeded) nodes[d].skipped = true;
+        if (--nodes[d].waitingFor == 0) dispatch(d);
+    }
+    wake.notify_all();
+}
+
+void StartupGraph::printTimings() const {
+    printf("Startup stages (ms from the start of initialization):\n");
+    for (const Node& node : nodes) {
+        const char* thread = node.thread == StartupThread::MAIN || inlineWorkers ? "main" : "worker";
+        if (node.skipped) {
+            printf("  %-20s %-6s skipped\n", node.name.c_str(), thread);
+        } else {
+            printf("  %-20s %-6s %7.1f - %7.1f  (%.1f ms)\n", node.name.c_str(), thread,
+                   node.startMs, node.endMs, node.endMs - node.startMs);
+        }
+    }
+}
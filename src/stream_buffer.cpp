@@ -0,0 +1,123 @@
+#include "stream_buffer.h"
+#include "frame_stats.h"
+#include "gl_caps.h"
+#include <iostream>
+
+using namespace std;
+
+StreamBuffer::StreamBuffer()
+    : bufferId(0), totalSize(0), segmentSize(0), persistent(false), mapped(nullptr),
+      frame(0), head(0), overflowReported(false)
+{
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) fences[i] = 0;
+}
+
+bool StreamBuffer::init(GLsizeiptr capacity, bool allowPersistent) {
+    segmentSize = capacity / FRAMES_IN_FLIGHT;
+    segmentSize -= segmentSize % 256;
+    totalSize = segmentSize * FRAMES_IN_FLIGHT;
+    persistent = allowPersistent && glCaps().bufferStorage;
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, totalSize, NULL, flags);
+        mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+        if (!mapped) {
+            cerr << "Error: persistent mapping failed, using unsynchronized mapping" << endl;
+            glDeleteBuffers(1, &bufferId);
+            glGenBuffers(1, &bufferId);
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_ARRAY_BUFFER, totalSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    cout << "Stream buffer: " << totalSize / (1024 * 1024) << " MB, " << FRAMES_IN_FLIGHT
+         << " frames in flight, " << (persistent ? "persistent" : "unsynchronized") << " mapping" << endl;
+    return bufferId != 0;
+}
+
+void StreamBuffer::destroy() {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        if (fences[i]) glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+    if (mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &bufferId);
+    bufferId = 0;
+}
+
+void StreamBuffer::beginFrame() {
+    head = 0;
+    GLsync fence = fences[frame];
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        // The GPU is FRAMES_IN_FLIGHT frames behind: block until it releases the segment
+        double start = monotonicSeconds();
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+        }
+        frameStats().add(STAT_STREAM_STALLS, 1);
+        frameStats().add(STAT_STREAM_STALL_MS, (monotonicSeconds() - start) * 1000.0);
+    }
+    glDeleteSync(fence);
+    fences[frame] = 0;
+}
+
+StreamAllocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    StreamAllocation alloc;
+    // Align the position in the whole buffer: segments start on 256 bytes, which is not a
+    // multiple of every alignment (e.g. the 36-byte batched vertex)
+    const GLsizeiptr base = frame * segmentSize;
+    GLsizeiptr offset = (base + head + alignment - 1) / alignment * alignment - base;
+    if (offset + size > segmentSize) {
+        if (!overflowReported) {
+            cerr << "Error: stream buffer segment full (" << segmentSize << " bytes, "
+                 << offset + size << " requested); raise --stream-mb" << endl;
+            overflowReported = true;
+        }
+        return alloc;
+    }
+    head = offset + size;
+
+    alloc.offset = frame * segmentSize + offset;
+    alloc.size = size;
+    if (persistent) {
+        alloc.ptr = mapped + alloc.offset;
+    } else {
+        // The fence already guarantees the GPU is done with this range
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+        alloc.ptr = glMapBufferRange(GL_ARRAY_BUFFER, alloc.offset, size,
+                                     GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    frameStats().add(STAT_STREAM_KB, size / 1024.0);
+    return alloc;
+}
+
+void StreamBuffer::commit(const StreamAllocation& alloc) {
+    if (persistent || !alloc.ptr) return;
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::endFrame() {
+    if (head > 0) {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    frame = (frame + 1) % FRAMES_IN_FLIGHT;
+    head = 0;
+}
@@ -0,0 +1,189 @@
+#include "vat.h"
+#include "cube.h"
+#include "palette.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include <iostream>
+
+using namespace std;
+
+// Per-robot instance record, read through attributes 2 and 3
+struct VatInstance {
+    float placement[4];   // position xyz, heading (radians)
+    float clip[2];        // clip index, phase (seconds)
+};
+
+VatCrowdRenderer::VatCrowdRenderer()
+    : program(0), depthProgram(0), vao(0), cubeVBO(0),
+      matrixBuffer(0), matrixTexture(0), partCount(0), instanceCount(0)
+{
+}
+
+bool VatCrowdRenderer::init(const vector<BakedClip>& clips, const StreamBuffer& stream) {
+    if (clips.empty() || (int)clips.size() > MAX_CLIPS) {
+        cerr << "Error: VAT path supports 1.." << MAX_CLIPS << " clips" << endl;
+        return false;
+    }
+
+    // Rows 0..2 of every part matrix (the last row is always 0 0 0 1)
+    partCount = robotPartCount();
+    vector<glm::vec4> texels;
+    vector<int> clipOffset, clipFrames;
+    vector<float> clipRate;
+    for (const BakedClip& clip : clips) {
+        clipOffset.push_back((int)texels.size());
+        clipFrames.push_back((int)clip.samples.size());
+        clipRate.push_back(clip.sampleRate);
+
+        for (const RobotPose& pose : clip.samples) {
+            glm::mat4 parts[MAX_ROBOT_PARTS];
+            computeRobotParts(pose, glm::mat4(1.0f), parts);
+            for (int p = 0; p < partCount; ++p) {
+                glm::vec4 packed[3];
+                packMatrixRows(parts[p], packed);
+                texels.insert(texels.end(), packed, packed + 3);
+            }
+        }
+    }
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if ((GLint)texels.size() > maxTexels) {
+        cerr << "Error: VAT needs " << texels.size() << " texels, driver allows " << maxTexels << endl;
+        return false;
+    }
+
+    glGenBuffers(1, &matrixBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, matrixBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &matrixTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, matrixBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    cout << "VAT: " << texels.size() * sizeof(glm::vec4) << " bytes of part matrices for "
+         << clips.size() << " clips" << endl;
+
+    // Cube geometry plus an instanced record stream advancing once per robot
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &cubeVBO);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, CUBE_VERTEX_COUNT * CUBE_VERTEX_FLOATS * sizeof(float),
+                 getCubeVertices(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Instance records live in the stream buffer; the offset is re-pointed every frame
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(VatInstance), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, partCount);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VatInstance), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, partCount);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // Clip table and part colors never change, so set them once; reloads copy them over
+    updatePrograms();
+    const GLuint programs[2] = {program, depthProgram};
+    for (GLuint p : programs) {
+        glUseProgram(p);
+        glUniform1iv(glGetUniformLocation(p, "clipOffset"), (GLsizei)clips.size(), clipOffset.data());
+        glUniform1iv(glGetUniformLocation(p, "clipFrames"), (GLsizei)clips.size(), clipFrames.data());
+        glUniform1fv(glGetUniformLocation(p, "clipRate"), (GLsizei)clips.size(), clipRate.data());
+        setUniform(p, "partCount", partCount);
+        glUniform3fv(glGetUniformLocation(p, "partColors"), partCount, &robotPartColor(0)[0]);
+        setUniform(p, "partMatrices", 0);
+    }
+
+    return true;
+}
+
+void VatCrowdRenderer::update(const Crowd& crowd, const FrameVector<int>& visible, StreamBuffer& stream) {
+    instanceCount = 0;
+    StreamAllocation alloc = stream.allocate((GLsizeiptr)visible.size() * sizeof(VatInstance),
+                                             sizeof(VatInstance));
+    if (!alloc.ptr) return;
+
+    VatInstance* records = (VatInstance*)alloc.ptr;
+    for (size_t k = 0; k < visible.size(); ++k) {
+        const CrowdRobot& r = crowd.robots[visible[k]];
+        VatInstance v;
+        v.placement[0] = r.position.x;
+        v.placement[1] = r.position.y;
+        v.placement[2] = r.position.z;
+        v.placement[3] = glm::radians(r.heading);
+        v.clip[0] = (float)r.clip;
+        v.clip[1] = r.phase;
+        records[k] = v;
+    }
+    stream.commit(alloc);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(VatInstance), (void*)alloc.offset);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(VatInstance), (void*)(alloc.offset + 4 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    instanceCount = (int)visible.size();
+}
+
+void VatCrowdRenderer::draw(const glm::mat4& view,
+                            const glm::mat4& proj,
+                            const glm::vec3& camPos,
+                            const Scene& scene,
+                            float time) const
+{
+    if (instanceCount == 0) return;
+
+    glUseProgram(program);
+    setUniform(program, "view", view);
+    setUniform(program, "projection", proj);
+    setUniform(program, "camPos", camPos);
+    setUniform(program, "lightPos", scene.lightPosition);
+    setUniform(program, "lightCol", scene.lightColor);
+    setUniform(program, "time", time);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instanceCount * partCount);
+    glBindVertexArray(0);
+}
+
+void VatCrowdRenderer::drawDepth(const glm::mat4& view, const glm::mat4& proj, float time) const {
+    if (instanceCount == 0) return;
+
+    glUseProgram(depthProgram);
+    setUniform(depthProgram, "view", view);
+    setUniform(depthProgram, "projection", proj);
+    setUniform(depthProgram, "time", time);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, matrixTexture);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instanceCount * partCount);
+    glBindVertexArray(0);
+}
+
+void VatCrowdRenderer::updatePrograms() {
+    // Both programs belong to the shader variant cache
+    program = shaderVariant("shaders/vat_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_VERTEX_COLOR);
+    depthProgram = shaderVariant("shaders/vat_vertex_shader.glsl", "shaders/fragment_shader.glsl", VARIANT_DEPTH_ONLY);
+}
+
+void VatCrowdRenderer::destroy() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &cubeVBO);
+    glDeleteTextures(1, &matrixTexture);
+    glDeleteBuffers(1, &matrixBuffer);
+    program = depthProgram = vao = cubeVBO = matrixTexture = matrixBuffer = 0;
+    instanceCount = 0;
+}
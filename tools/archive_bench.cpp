@@ -0,0 +1,160 @@
+// Benchmark of the packed asset archive against loose files: opening and reading every asset
+// of a synthetic set (shader-, clip- and mesh-sized files), with a warm and a cold page cache.
+// Usage: archive_bench [files] (default 2000)
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "asset_archive.h"
+#include "frame_stats.h"
+#include "mapped_file.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static float randf(unsigned int& state) {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / 16777216.0f;
+}
+
+// Mostly small files (shaders, scene definitions), some clips, a few large meshes
+static size_t assetSize(unsigned int& seed) {
+    float r = randf(seed);
+    if (r < 0.6f) return 512 + (size_t)(randf(seed) * 8 * 1024);
+    if (r < 0.95f) return 16 * 1024 + (size_t)(randf(seed) * 96 * 1024);
+    return 512 * 1024 + (size_t)(randf(seed) * 1536 * 1024);
+}
+
+static bool writeFile(const string& path, const vector<char>& bytes) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    return fclose(out) == 0 && ok;
+}
+
+// Touch every byte, as decoding or a GPU upload would
+static uint64_t checksum(const char* data, size_t size) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        sum += word;
+    }
+    for (; i < size; ++i) sum += (unsigned char)data[i];
+    return sum;
+}
+
+// Drop a file's pages from the page cache, so the next read goes to the disk
+static void evict(const string& path) {
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? max(1, atoi(argv[1])) : 2000;
+
+    char directory[] = "/tmp/archive_bench_XXXXXX";
+    if (!mkdtemp(directory)) {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return 1;
+    }
+    const string root = directory;
+
+    // --- synthetic asset set, written as loose files and packed ---
+    unsigned int seed = 12345;
+    vector<AssetArchiveInput> inputs(count);
+    size_t totalBytes = 0;
+    for (int i = 0; i < count; ++i) {
+        vector<char> bytes(assetSize(seed));
+        for (size_t b = 0; b < bytes.size(); ++b) bytes[b] = (char)(seed = seed * 1664525u + 1013904223u);
+        char name[64];
+        snprintf(name, sizeof(name), "asset_%05d.bin", i);
+        inputs[i].path = string("assets/") + name;
+        inputs[i].file = root + "/" + name;
+        if (!writeFile(inputs[i].file, bytes)) {
+            fprintf(stderr, "Cannot write %s\n", inputs[i].file.c_str());
+            return 1;
+        }
+        totalBytes += bytes.size();
+    }
+    const string archivePath = root + "/assets.pak";
+    double packStart = monotonicSeconds();
+    if (!writeAssetArchive(archivePath, inputs)) return 1;
+    double packMs = (monotonicSeconds() - packStart) * 1000.0;
+
+    AssetArchive probe;
+    if (!probe.open(archivePath)) return 1;
+    printf("Archive benchmark: %d files, %.1f MB (archive %.1f MB, packed in %.1f ms)\n",
+           count, totalBytes / 1048576.0, probe.fileSize() / 1048576.0, packMs);
+    probe.close();
+
+    // --- load everything: one open + map per file, or one for the archive ---
+    uint64_t looseSum = 0, archiveSum = 0;
+    int missing = 0;
+    auto loadLoose = [&]() {
+        for (const AssetArchiveInput& input : inputs) {
+            MappedFile file;
+            if (!file.open(input.file)) {
+                ++missing;
+                continue;
+            }
+            looseSum += checksum(file.data(), file.size());
+        }
+    };
+    auto loadArchive = [&]() {
+        AssetArchive archive;
+        if (!archive.open(archivePath)) return;
+        for (const AssetArchiveInput& input : inputs) {
+            const char* data = NULL;
+            size_t size = 0;
+            if (!archive.find(input.path, data, size)) {
+                ++missing;
+                continue;
+            }
+            archiveSum += checksum(data, size);
+        }
+    };
+
+    const int repeats = 5;
+    for (int cold = 0; cold < 2; ++cold) {
+        double looseMs = 1e30, archiveMs = 1e30;
+        for (int r = 0; r < repeats; ++r) {
+            if (cold) {
+                for (const AssetArchiveInput& input : inputs) evict(input.file);
+            }
+            double start = monotonicSeconds();
+            loadLoose();
+            looseMs = min(looseMs, (monotonicSeconds() - start) * 1000.0);
+
+            if (cold) evict(archivePath);
+            start = monotonicSeconds();
+            loadArchive();
+            archiveMs = min(archiveMs, (monotonicSeconds() - start) * 1000.0);
+        }
+        printf("  %s cache   loose %8.2f ms   archive %8.2f ms   (%.2fx, best of %d)\n",
+               cold ? "cold" : "warm", looseMs, archiveMs, looseMs / archiveMs, repeats);
+    }
+    printf("  opens per load: loose %d, archive 1; lookups %s\n", count,
+           missing == 0 && looseSum == archiveSum ? "match" : "MISMATCH");
+
+    // --- clean up ---
+    for (const AssetArchiveInput& input : inputs) remove(input.file.c_str());
+    remove(archivePath.c_str());
+    rmdir(directory);
+    return missing == 0 && looseSum == archiveSum ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// Benchmark of the crowd BVH: build, refit and queries over a large robot fleet.
+// Usage: bvh_bench [robots] (default 100000)
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bvh.h"
+#include "culling.h"
+#include "frame_stats.h"
+#include "job_system.h"
+
+using namespace std;
+
+static float randf(unsigned int& state) {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / 16777216.0f;
+}
+
+// Robot-sized box at a ground position (about the extent of a baked clip's bounds)
+static Aabb robotBox(const glm::vec3& p) {
+    Aabb box;
+    box.min = p + glm::vec3(-0.7f, 0.0f, -0.5f);
+    box.max = p + glm::vec3(0.7f, 2.6f, 0.5f);
+    return box;
+}
+
+static void placeRobots(vector<glm::vec3>& homes, vector<Aabb>& boxes, int count) {
+    const int columns = (int)ceilf(sqrtf((float)count));
+    homes.resize(count);
+    boxes.resize(count);
+    for (int i = 0; i < count; ++i) {
+        homes[i] = glm::vec3((i % columns - 0.5f * columns) * 2.0f, 0.0f, -3.0f - (i / columns) * 2.0f);
+        boxes[i] = robotBox(homes[i]);
+    }
+}
+
+// Every robot walks in a straight line at its own speed, so the tree slowly degrades
+static void moveRobots(const vector<glm::vec3>& homes, const vector<glm::vec3>& velocity,
+                       float t, vector<Aabb>& boxes) {
+    for (size_t i = 0; i < homes.size(); ++i) boxes[i] = robotBox(homes[i] + velocity[i] * t);
+}
+
+// Reference slab test for checking raycast(); negative on a miss
+static float rayBox(const Aabb& box, const glm::vec3& origin, const glm::vec3& dir, float maxDistance) {
+    float tmin = 0.0f, tmax = maxDistance;
+    for (int a = 0; a < 3; ++a) {
+        float inv = 1.0f / (fabsf(dir[a]) > 1e-12f ? dir[a] : 1e-12f);
+        float t0 = (box.min[a] - origin[a]) * inv;
+        float t1 = (box.max[a] - origin[a]) * inv;
+        if (t0 > t1) swap(t0, t1);
+        tmin = max(tmin, t0);
+        tmax = min(tmax, t1);
+        if (tmin > tmax) return -1.0f;
+    }
+    return tmin;
+}
+
+template <typename Fn>
+static double timeMs(int repeats, Fn fn) {
+    double start = monotonicSeconds();
+    for (int r = 0; r < repeats; ++r) fn();
+    return (monotonicSeconds() - start) * 1000.0 / repeats;
+}
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? max(1, atoi(argv[1])) : 100000;
+    printf("BVH benchmark: %d robots, %d threads\n", count, jobSystem().threadCount());
+
+    vector<glm::vec3> homes;
+    vector<Aabb> boxes;
+    placeRobots(homes, boxes, count);
+
+    // --- build ---
+    Bvh bvh;
+    bvh.parallel = false;
+    double serialMs = timeMs(5, [&] { bvh.build(boxes); });
+    bvh.parallel = true;
+    double parallelMs = timeMs(5, [&] { bvh.build(boxes); });
+    printf("  build       serial %8.2f ms   parallel %8.2f ms   (%d nodes, SAH %.1f)\n",
+           serialMs, parallelMs, bvh.nodeCount(), bvh.sahCost());
+
+    // --- refit while robots move ---
+    unsigned int seed = 12345;
+    vector<glm::vec3> velocity(count);
+    for (int i = 0; i < count; ++i) {
+        velocity[i] = glm::vec3(randf(seed) - 0.5f, 0.0f, randf(seed) - 0.5f) * 2.0f;
+    }
+
+    const int frames = 120;
+    const float dt = 1.0f / 60.0f;
+    double moveMs = 0.0, serialRefitMs = 0.0, refitMs = 0.0, rebuildMs = 0.0;
+    int rebuilt = 0;
+    Bvh reference;
+    for (int f = 1; f <= frames; ++f) {
+        double start = monotonicSeconds();
+        moveRobots(homes, velocity, f * dt, boxes);
+        moveMs += (monotonicSeconds() - start) * 1000.0;
+
+        for (int i = 0; i < count; ++i) bvh.updatePrimitive(i, boxes[i]);
+        bvh.parallel = (f % 2) == 0;
+        start = monotonicSeconds();
+        rebuilt += bvh.refit();
+        (bvh.parallel ? refitMs : serialRefitMs) += (monotonicSeconds() - start) * 1000.0;
+
+        start = monotonicSeconds();
+        reference.build(boxes);
+        rebuildMs += (monotonicSeconds() - start) * 1000.0;
+        resetFrameArenas();
+    }
+    bvh.parallel = true;
+    printf("  refit       serial %8.2f ms   parallel %8.2f ms   (%d subtrees rebuilt over %d frames)\n",
+           serialRefitMs / (frames / 2), refitMs / (frames / 2), rebuilt, frames);
+    printf("  full build  every frame %8.2f ms   move %.2f ms\n", rebuildMs / frames, moveMs / frames);
+    printf("  SAH after %.1f s: refit %.1f, fresh build %.1f\n", frames * dt, bvh.sahCost(), reference.sahCost());
+
+    // --- frustum queries vs. the linear SIMD test ---
+    vector<float> cx(count), cy(count), cz(count), ex(count), ey(count), ez(count);
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 c = (boxes[i].min + boxes[i].max) * 0.5f;
+        glm::vec3 e = (boxes[i].max - boxes[i].min) * 0.5f;
+        cx[i] = c.x; cy[i] = c.y; cz[i] = c.z;
+        ex[i] = e.x; ey[i] = e.y; ez[i] = e.z;
+    }
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    const int views = 64;
+    vector<Frustum> frusta(views);
+    for (int v = 0; v < views; ++v) {
+        glm::vec3 eye(randf(seed) * 100.0f - 50.0f, 3.0f, -randf(seed) * 100.0f);
+        float yaw = randf(seed) * 6.2831853f;
+        glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(cosf(yaw), -0.1f, sinf(yaw)), glm::vec3(0, 1, 0));
+        frusta[v] = extractFrustum(proj * view);
+    }
+
+    vector<int> hits;
+    vector<unsigned char> mask(count);
+    size_t treeVisible = 0, linearVisible = 0;
+    double treeMs = timeMs(1, [&] {
+        for (int v = 0; v < views; ++v) {
+            hits.clear();
+            bvh.queryFrustum(frusta[v], hits);
+            treeVisible += hits.size();
+        }
+    });
+    double linearMs = timeMs(1, [&] {
+        for (int v = 0; v < views; ++v) {
+            linearVisible += cullBoxes(frusta[v], cx.data(), cy.data(), cz.data(),
+                                       ex.data(), ey.data(), ez.data(), count, mask.data());
+        }
+    });
+    printf("  frustum     bvh %8.3f ms   linear SIMD %8.3f ms   (%.0f visible per view, linear %.0f)\n",
+           treeMs / views, linearMs / views, (double)treeVisible / views, (double)linearVisible / views);
+
+    // --- box queries ---
+    const int boxQueries = 1000;
+    size_t boxHits = 0;
+    double boxMs = timeMs(1, [&] {
+        for (int q = 0; q < boxQueries; ++q) {
+            glm::vec3 c = homes[(int)(randf(seed) * (count - 1))];
+            Aabb region;
+            region.min = c - glm::vec3(5.0f);
+            region.max = c + glm::vec3(5.0f);
+            hits.clear();
+            bvh.queryBox(region, hits);
+            boxHits += hits.size();
+        }
+    });
+    printf("  box         %8.4f ms per query   (%.1f robots each)\n", boxMs / boxQueries, (double)boxHits / boxQueries);
+
+    // --- rays, checked against brute force on a subset ---
+    const int rays = 10000;
+    vector<glm::vec3> origins(rays), dirs(rays);
+    for (int r = 0; r < rays; ++r) {
+        origins[r] = glm::vec3(randf(seed) * 100.0f - 50.0f, 1.0f + randf(seed) * 3.0f, -randf(seed) * 100.0f);
+        float yaw = randf(seed) * 6.2831853f;
+        dirs[r] = glm::normalize(glm::vec3(cosf(yaw), -0.05f, sinf(yaw)));
+    }
+    int rayHits = 0;
+    double rayMs = timeMs(1, [&] {
+        for (int r = 0; r < rays; ++r) {
+            if (bvh.raycast(origins[r], dirs[r], 1000.0f, nullptr) >= 0) ++rayHits;
+        }
+    });
+
+    int mismatches = 0;
+    for (int r = 0; r < 100; ++r) {
+        float treeT = 0.0f;
+        int treeHit = bvh.raycast(origins[r], dirs[r], 1000.0f, &treeT);
+        float bestT = 1000.0f;
+        int bestHit = -1;
+        for (int i = 0; i < count; ++i) {
+            float t = rayBox(boxes[i], origins[r], dirs[r], bestT);
+            if (t >= 0.0f && t < bestT) {
+                bestT = t;
+                bestHit = i;
+            }
+        }
+        if ((treeHit < 0) != (bestHit < 0) || (treeHit >= 0 && fabsf(treeT - bestT) > 1e-4f)) ++mismatches;
+    }
+    printf("  ray         %8.4f ms per ray   (%d of %d hit, %d mismatches vs brute force)\n",
+           rayMs / rays, rayHits, rays, mismatches);
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Build step: turns files (shaders, small assets) into a header of constexpr byte arrays that
+// src/embedded_assets.cpp compiles into the executable.
+// Usage: embed_files <output.h> <base directory> <files...>
+// Each file is keyed by its path relative to the base directory, e.g. "shaders/vertex_shader.glsl".
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static string logicalPath(const string& base, string path) {
+    for (char& c : path) {
+        if (c == '\\') c = '/';
+    }
+    string prefix = base;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/') prefix += '/';
+    if (path.compare(0, prefix.size(), prefix) == 0) path = path.substr(prefix.size());
+    return path;
+}
+
+static bool readFile(const string& path, string& contents) {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) return false;
+    stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: embed_files <output.h> <base directory> <files...>\n");
+        return 1;
+    }
+    const string base = argv[2];
+
+    ostringstream out;
+    out << "// Generated by tools/embed_files from the files below. Do not edit.\n\n";
+
+    vector<string> names;
+    size_t totalBytes = 0;
+    for (int i = 3; i < argc; ++i) {
+        string contents;
+        if (!readFile(argv[i], contents)) {
+            fprintf(stderr, "embed_files: cannot read %s\n", argv[i]);
+            return 1;
+        }
+        names.push_back(logicalPath(base, argv[i]));
+        totalBytes += contents.size();
+
+        // Bytes as character literals ('\x80' is a char, where 0x80 would be a narrowing
+        // error), plus a terminating zero so text assets can be used as C strings
+        out << "// " << names.back() << "\n";
+        out << "static constexpr char EMBEDDED_ASSET_" << (i - 3) << "[] = {";
+        char hex[10];
+        for (size_t b = 0; b < contents.size(); ++b) {
+            if (b % 16 == 0) out << "\n    ";
+            snprintf(hex, sizeof(hex), "'\\x%02x',", (unsigned char)contents[b]);
+            out << hex;
+        }
+        out << "\n    '\\0'\n};\n\n";
+    }
+
+    out << "static constexpr EmbeddedAsset EMBEDDED_ASSET_TABLE[] = {\n";
+    for (size_t i = 0; i < names.size(); ++i) {
+        out << "    {\"" << names[i] << "\", EMBEDDED_ASSET_" << i << ", sizeof(EMBEDDED_ASSET_" << i << ") - 1},\n";
+    }
+    if (names.empty()) out << "    {\"\", \"\", 0},\n";
+    out << "};\n";
+    out << "static constexpr int EMBEDDED_ASSET_COUNT = " << names.size() << ";\n";
+
+    ofstream file(argv[1], ios::binary);
+    if (!file) {
+        fprintf(stderr, "embed_files: cannot write %s\n", argv[1]);
+        return 1;
+    }
+    file << out.str();
+    printf("Embedded %d files (%zu bytes) into %s\n", (int)names.size(), totalBytes, argv[1]);
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Benchmark of software occlusion culling on a crowd standing in rows, CPU only.
+// Usage: occlusion_bench [robots] [--dump depth.pgm]   (default 2500 robots)
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "bvh.h"
+#include "culling.h"
+#include "frame_stats.h"
+#include "job_system.h"
+#include "occlusion.h"
+
+using namespace std;
+
+static const int MAX_OCCLUDERS = 128;
+
+// Robot extents relative to its ground point, close to the rig in robot.cpp
+static const glm::vec3 ROBOT_MIN(-1.1f, -1.8f, -0.5f);
+static const glm::vec3 ROBOT_MAX(1.1f, 2.3f, 0.5f);
+static const glm::vec3 TORSO_CENTER(0.0f, 1.0f, 0.0f);
+static const glm::vec3 TORSO_INNER(0.8f, 1.6f, 0.4f);
+
+static bool writePgm(const char* path, const OcclusionBuffer& buffer) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    fprintf(f, "P5\n%d %d\n255\n", buffer.width(), buffer.height());
+    for (int y = buffer.height() - 1; y >= 0; --y) {
+        for (int x = 0; x < buffer.width(); ++x) {
+            float d = buffer.depth()[(size_t)y * buffer.width() + x];
+            // Stretch the non-linear depth so near occluders are distinguishable
+            unsigned char v = (unsigned char)(255.0f * powf(min(max(d, 0.0f), 1.0f), 64.0f));
+            fputc(v, f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int count = 2500;
+    const char* dumpPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) dumpPath = argv[++i];
+        else count = max(1, atoi(argv[i]));
+    }
+
+    // Rows of robots in front of the camera, as in the app's --crowd grid
+    const int columns = (int)ceilf(sqrtf((float)count));
+    vector<glm::vec3> positions(count);
+    vector<Aabb> boxes(count);
+    for (int i = 0; i < count; ++i) {
+        positions[i] = glm::vec3((i % columns - 0.5f * (columns - 1)) * 2.0f, 0.0f, -3.0f - (i / columns) * 2.0f);
+        boxes[i].min = positions[i] + ROBOT_MIN;
+        boxes[i].max = positions[i] + ROBOT_MAX;
+    }
+    Bvh bvh;
+    bvh.build(boxes);
+
+    OcclusionBuffer occlusion;
+    occlusion.init(256, 128);
+    printf("Occlusion benchmark: %d robots, %d x %d depth buffer, %d threads\n",
+           count, occlusion.width(), occlusion.height(), jobSystem().threadCount());
+
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    const int frames = 200;
+    double rasterMs = 0.0, testMs = 0.0;
+    size_t inFrustum = 0, occluded = 0, triangles = 0;
+    vector<int> visible;
+    vector<float> distance;
+    vector<int> order;
+    vector<unsigned char> hidden;
+
+    for (int f = 0; f < frames; ++f) {
+        // Eye height camera behind the first row, panning slowly
+        float yaw = -1.5707963f + 0.4f * sinf(f * 0.05f);
+        glm::vec3 eye(0.0f, 1.5f, 2.0f);
+        glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(cosf(yaw), -0.05f, sinf(yaw)), glm::vec3(0, 1, 0));
+        glm::mat4 viewProj = proj * view;
+
+        visible.clear();
+        bvh.queryFrustum(extractFrustum(viewProj), visible);
+        const int n = (int)visible.size();
+
+        double start = monotonicSeconds();
+        occlusion.begin(viewProj);
+        distance.resize(n);
+        order.resize(n);
+        for (int k = 0; k < n; ++k) {
+            distance[k] = glm::length(positions[visible[k]] - eye);
+            order[k] = k;
+        }
+        const int occluders = min(n, MAX_OCCLUDERS);
+        if (occluders > 0) {
+            nth_element(order.begin(), order.begin() + (occluders - 1), order.end(),
+                        [&](int a, int b) { return distance[a] < distance[b]; });
+        }
+        for (int k = 0; k < occluders; ++k) {
+            glm::mat4 m = glm::translate(glm::mat4(1.0f), positions[visible[order[k]]] + TORSO_CENTER);
+            occlusion.addOccluder(glm::scale(m, TORSO_INNER));
+        }
+        occlusion.rasterize();
+        double mid = monotonicSeconds();
+
+        hidden.assign(n, 0);
+        jobSystem().parallelFor(n, 256, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) hidden[k] = occlusion.isOccluded(boxes[visible[k]]) ? 1 : 0;
+        });
+        double done = monotonicSeconds();
+
+        rasterMs += (mid - start) * 1000.0;
+        testMs += (done - mid) * 1000.0;
+        inFrustum += n;
+        triangles += occlusion.triangleCount();
+        for (unsigned char h : hidden) occluded += h;
+    }
+
+    printf("  rasterize   %8.3f ms   (%.0f occluder triangles)\n", rasterMs / frames, (double)triangles / frames);
+    printf("  box tests   %8.3f ms   (%.0f robots in the frustum)\n", testMs / frames, (double)inFrustum / frames);
+    printf("  total       %8.3f ms   %.0f robots occluded per frame (%.1f%%)\n",
+           (rasterMs + testMs) / frames, (double)occluded / frames,
+           inFrustum ? 100.0 * occluded / inFrustum : 0.0);
+
+    if (dumpPath) {
+        if (writePgm(dumpPath, occlusion)) printf("Depth buffer of the last frame written to %s\n", dumpPath);
+        else fprintf(stderr, "Error: could not write %s\n", dumpPath);
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Build step: packs shaders, meshes, clips and scene files into one asset archive
+// (see asset_archive.h) that the program maps with --archive.
+// Usage: pack_assets <output.pak> <base directory> <files...>
+// Each file is looked up by its path relative to the base directory, e.g. "shaders/vertex_shader.glsl".
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "asset_archive.h"
+
+using namespace std;
+
+static string logicalPath(const string& base, string path) {
+    for (char& c : path) {
+        if (c == '\\') c = '/';
+    }
+    string prefix = base;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/') prefix += '/';
+    if (path.compare(0, prefix.size(), prefix) == 0) path = path.substr(prefix.size());
+    return path;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: pack_assets <output.pak> <base directory> <files...>\n");
+        return 1;
+    }
+
+    vector<AssetArchiveInput> inputs;
+    for (int i = 3; i < argc; ++i) {
+        AssetArchiveInput input;
+        input.file = argv[i];
+        input.path = logicalPath(argv[2], argv[i]);
+        inputs.push_back(input);
+    }
+    if (!writeAssetArchive(argv[1], inputs)) return 1;
+
+    AssetArchive archive;
+    if (!archive.open(argv[1])) return 1;
+    printf("Packed %d files into %s (%zu bytes)\n", archive.entryCount(), argv[1], archive.fileSize());
+    return 0;
+}